@@ -0,0 +1,202 @@
+// Bypass ramps, crossfades and tail silence detection: the vectorized kernels
+// (see AudioKernels.h) against the scalar loops which VST2Plugin::doProcessing()
+// and VST3Plugin::doProcess() used before. The loops process all channels of
+// a plugin, like the plugin backends do.
+//
+// usage: bench_kernels [channels] [block size] [iterations]
+
+#include "AudioKernels.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+using namespace vst;
+
+namespace {
+
+/*////////////////// reference loops ///////////////////*/
+
+template<typename T>
+void refRampCopy(const T *in, T *out, int n, T mix, T advance){
+    for (int j = 0; j < n; ++j, mix += advance){
+        out[j] = in[j] * mix;
+    }
+}
+
+template<typename T>
+void refRampScale(T *out, int n, T mix, T advance){
+    for (int j = 0; j < n; ++j, mix += advance){
+        out[j] *= mix;
+    }
+}
+
+template<typename T>
+void refRampAdd(const T *in, T *out, int n, T mix, T advance){
+    for (int j = 0; j < n; ++j, mix += advance){
+        out[j] += in[j] * (1.f - mix);
+    }
+}
+
+template<typename T>
+void refCrossfade(const T *in, T *out, int n, T mix, T advance){
+    for (int j = 0; j < n; ++j, mix += advance){
+        out[j] = out[j] * mix + in[j] * (1.f - mix);
+    }
+}
+
+template<typename T>
+void refAdd(const T *in, T *out, int n){
+    for (int j = 0; j < n; ++j){
+        out[j] += in[j];
+    }
+}
+
+template<typename T>
+bool refIsSilent(const T *buf, int n, T threshold){
+    T sum = 0;
+    for (int i = 0; i < n; ++i){
+        T f = buf[i];
+        sum += f * f;
+    }
+    return (sum / n) < (threshold * threshold);
+}
+
+/*////////////////// benchmark ///////////////////*/
+
+struct Setup {
+    int channels;
+    int blockSize;
+    int iterations;
+};
+
+template<typename T>
+struct Buffers {
+    std::vector<std::vector<T>> input;
+    std::vector<std::vector<T>> output;
+
+    Buffers(const Setup& s, T amplitude)
+        : input(s.channels, std::vector<T>(s.blockSize)),
+          output(s.channels, std::vector<T>(s.blockSize)) {
+        for (int i = 0; i < s.channels; ++i){
+            for (int j = 0; j < s.blockSize; ++j){
+                input[i][j] = amplitude * (T)sin(0.01 * (i * s.blockSize + j));
+            }
+        }
+        reset();
+    }
+    // keep the values bounded
+    void reset(){
+        for (size_t i = 0; i < output.size(); ++i){
+            output[i] = input[i];
+        }
+    }
+};
+
+double seconds(){
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count() * 1e-9;
+}
+
+// 'fn' processes one channel; returns nanoseconds per sample.
+// we take the fastest block, so that other processes have less influence.
+template<typename T, typename Fn>
+double measure(const Setup& s, Buffers<T>& b, const Fn& fn){
+    double best = 1e9;
+    for (int k = 0; k < s.iterations; ++k){
+        b.reset();
+        auto start = seconds();
+        for (int i = 0; i < s.channels; ++i){
+            fn(b.input[i].data(), b.output[i].data(), s.blockSize);
+        }
+        best = std::min(best, seconds() - start);
+    }
+    return best * 1e9 / ((double)s.channels * s.blockSize);
+}
+
+template<typename T>
+double maxError(const Buffers<T>& a, const Buffers<T>& b){
+    double result = 0;
+    for (size_t i = 0; i < a.output.size(); ++i){
+        for (size_t j = 0; j < a.output[i].size(); ++j){
+            result = std::max<double>(result, fabs(a.output[i][j] - b.output[i][j]));
+        }
+    }
+    return result;
+}
+
+template<typename T, typename Ref, typename Kernel>
+void compare(const char *name, const Setup& s, T amplitude, const Ref& ref, const Kernel& kernel){
+    Buffers<T> a(s, amplitude);
+    Buffers<T> b(s, amplitude);
+    auto refTime = measure(s, a, ref);
+    auto kernelTime = measure(s, b, kernel);
+    printf("%-12s %-7s %8.3f %8.3f %7.2fx %10.2g\n", name, sizeof(T) == 4 ? "float" : "double",
+           refTime, kernelTime, refTime / kernelTime, maxError(a, b));
+}
+
+template<typename T>
+void run(const Setup& s){
+    const T start = 0;
+    const T step = 1.0 / s.blockSize;
+    const T threshold = 0.0001;
+    compare<T>("rampCopy", s, 1, [&](const T *in, T *out, int n){
+        refRampCopy(in, out, n, start, step);
+    }, [&](const T *in, T *out, int n){
+        audio::rampCopy(in, out, n, start, step);
+    });
+    compare<T>("rampScale", s, 1, [&](const T *, T *out, int n){
+        refRampScale(out, n, start, step);
+    }, [&](const T *, T *out, int n){
+        audio::rampScale(out, n, start, step);
+    });
+    compare<T>("rampAdd", s, 1, [&](const T *in, T *out, int n){
+        refRampAdd(in, out, n, start, step);
+    }, [&](const T *in, T *out, int n){
+        audio::rampAdd(in, out, n, start, step);
+    });
+    compare<T>("crossfade", s, 1, [&](const T *in, T *out, int n){
+        refCrossfade(in, out, n, start, step);
+    }, [&](const T *in, T *out, int n){
+        audio::crossfade(in, out, n, start, step);
+    });
+    compare<T>("add", s, 1, [&](const T *in, T *out, int n){
+        refAdd(in, out, n);
+    }, [&](const T *in, T *out, int n){
+        audio::add(in, out, n);
+    });
+    // the result is written to the first sample, so it can be checked like the others.
+    // "tail": the whole block has to be scanned; "loud": the kernel can stop early.
+    const char *names[] = { "silent/tail", "silent/loud" };
+    const T amplitudes[] = { (T)0.00005, 1 };
+    for (int k = 0; k < 2; ++k){
+        compare<T>(names[k], s, amplitudes[k], [&](const T *in, T *out, int n){
+            out[0] = refIsSilent(in, n, threshold);
+        }, [&](const T *in, T *out, int n){
+            out[0] = audio::isSilent(in, n, threshold);
+        });
+    }
+}
+
+} // namespace
+
+int main(int argc, const char *argv[]){
+    Setup s;
+    s.channels = argc > 1 ? atoi(argv[1]) : 64;
+    s.blockSize = argc > 2 ? atoi(argv[2]) : 64;
+    s.iterations = argc > 3 ? atoi(argv[3]) : 20000;
+    if (s.channels <= 0 || s.blockSize <= 0 || s.iterations <= 0){
+        fprintf(stderr, "bad arguments\n");
+        return EXIT_FAILURE;
+    }
+    printf("%d channels, block size %d, %d iterations, kernels: %s\n",
+           s.channels, s.blockSize, s.iterations, audio::kernelName());
+    printf("%-12s %-7s %8s %8s %8s %10s\n", "", "", "ns/smp", "ns/smp", "", "max.");
+    printf("%-12s %-7s %8s %8s %8s %10s\n", "kernel", "type", "(loop)", "(kernel)", "speedup", "error");
+    run<float>(s);
+    run<double>(s);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,245 @@
+// VST3 parameter changes per block: ParameterChanges/ParamValueQueue (see VST3Plugin.h)
+// against the previous implementation with a linear search over the queues in use
+// and sorted insertion of the points. Each block adds the changes (parameters interleaved,
+// like doSetParameter() for audio rate automation), reads every point back and calls clear().
+// The cost per change should stay the same for any number of changes.
+//
+// usage: bench_paramqueue [max. number of parameters]
+
+#include "VST3Plugin.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using namespace vst;
+
+namespace {
+
+/*////////////////// reference implementation ///////////////////*/
+
+class LinearQueue {
+ public:
+    static const int maxNumPoints = ParamValueQueue::maxNumPoints;
+
+    LinearQueue(){
+        values_.reserve(maxNumPoints);
+    }
+    void setParameterId(Vst::ParamID id){
+        values_.clear();
+        id_ = id;
+    }
+    Vst::ParamID getParameterId() { return id_; }
+    int32 getPointCount() { return values_.size(); }
+    tresult getPoint(int32 index, int32& sampleOffset, Vst::ParamValue& value){
+        if (index >= 0 && index < (int32)values_.size()){
+            value = values_[index].value;
+            sampleOffset = values_[index].sampleOffset;
+            return kResultTrue;
+        }
+        return kResultFalse;
+    }
+    tresult addPoint(int32 sampleOffset, Vst::ParamValue value, int32& index){
+        // iterate in reverse because we likely add values in "chronological" order
+        for (auto it = values_.end(); it-- != values_.begin(); ){
+            if (sampleOffset > it->sampleOffset){
+                if (values_.size() < maxNumPoints){
+                    it = values_.emplace(it + 1, value, sampleOffset);
+                    index = it - values_.begin();
+                } else {
+                    values_.back() = Value(value, sampleOffset);
+                    index = values_.size() - 1;
+                }
+                return kResultOk;
+            } else if (sampleOffset == it->sampleOffset){
+                it->value = value;
+                index = it - values_.begin();
+                return kResultOk;
+            }
+        }
+        if (values_.size() < maxNumPoints){
+            values_.emplace(values_.begin(), value, sampleOffset);
+        } else {
+            values_.front() = Value(value, sampleOffset);
+        }
+        index = 0;
+        return kResultOk;
+    }
+ private:
+    struct Value {
+        Value(Vst::ParamValue v, int32 offset) : value(v), sampleOffset(offset) {}
+        Vst::ParamValue value;
+        int32 sampleOffset;
+    };
+    std::vector<Value> values_;
+    Vst::ParamID id_ = Vst::kNoParamId;
+};
+
+class LinearChanges {
+ public:
+    void setMaxNumParameters(int n){
+        parameterChanges_.resize(n);
+    }
+    int32 getParameterCount() { return useCount_; }
+    LinearQueue* getParameterData(int32 index){
+        return index >= 0 && index < useCount_ ? &parameterChanges_[index] : nullptr;
+    }
+    LinearQueue* addParameterData(const Vst::ParamID& id, int32& index){
+        for (int i = 0; i < useCount_; ++i){
+            if (parameterChanges_[i].getParameterId() == id){
+                index = i;
+                return &parameterChanges_[i];
+            }
+        }
+        if (useCount_ < (int)parameterChanges_.size()){
+            index = useCount_++;
+            parameterChanges_[index].setParameterId(id);
+            return &parameterChanges_[index];
+        }
+        index = 0;
+        return nullptr;
+    }
+    void clear(){
+        useCount_ = 0;
+    }
+ private:
+    std::vector<LinearQueue> parameterChanges_;
+    int useCount_ = 0;
+};
+
+/*////////////////// benchmark ///////////////////*/
+
+// returns microseconds per block
+template<typename Changes>
+double run(const std::vector<Vst::ParamID>& ids, int numParams, int numPoints,
+           bool shuffle, int blocks){
+    Changes changes;
+    changes.setMaxNumParameters(ids.size());
+    std::vector<int32> offsets(numPoints);
+    for (int i = 0; i < numPoints; ++i){
+        offsets[i] = i * 2;
+    }
+    if (shuffle){
+        std::shuffle(offsets.begin(), offsets.end(), std::mt19937(1));
+    }
+    double sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int b = 0; b < blocks; ++b){
+        for (int p = 0; p < numPoints; ++p){
+            for (int k = 0; k < numParams; ++k){
+                int32 index;
+                changes.addParameterData(ids[k], index)->addPoint(offsets[p], k * 0.001 + p, index);
+            }
+        }
+        // the plugin reads everything
+        int n = changes.getParameterCount();
+        for (int i = 0; i < n; ++i){
+            auto queue = changes.getParameterData(i);
+            int m = queue->getPointCount();
+            for (int j = 0; j < m; ++j){
+                int32 offset;
+                Vst::ParamValue value;
+                queue->getPoint(j, offset, value);
+                sink += value + offset;
+            }
+        }
+        changes.clear();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (sink == 0.5){
+        printf(" "); // keep the loop
+    }
+    return elapsed.count() * 1e6 / blocks;
+}
+
+// both implementations must produce the same points (unless a queue is full)
+bool verify(const std::vector<Vst::ParamID>& ids){
+    std::mt19937 rng(7);
+    LinearChanges a;
+    ParameterChanges b;
+    a.setMaxNumParameters(ids.size());
+    b.setMaxNumParameters(ids.size());
+    for (int block = 0; block < 50; ++block){
+        int n = rng() % 500;
+        for (int i = 0; i < n; ++i){
+            auto id = ids[rng() % ids.size()];
+            int32 offset = rng() % 100;
+            Vst::ParamValue value = rng() % 1000;
+            int32 i1, i2;
+            a.addParameterData(id, i1)->addPoint(offset, value, i1);
+            b.addParameterData(id, i2)->addPoint(offset, value, i2);
+        }
+        if (a.getParameterCount() != b.getParameterCount()){
+            return false;
+        }
+        for (int i = 0; i < a.getParameterCount(); ++i){
+            auto qa = a.getParameterData(i);
+            auto qb = b.getParameterData(i);
+            int count = qa->getPointCount();
+            if (qa->getParameterId() != qb->getParameterId() || count != qb->getPointCount()){
+                return false;
+            }
+            if (count >= LinearQueue::maxNumPoints){
+                continue;
+            }
+            for (int j = 0; j < count; ++j){
+                int32 o1 = 0, o2 = 0;
+                Vst::ParamValue v1 = 0, v2 = 0;
+                qa->getPoint(j, o1, v1);
+                qb->getPoint(j, o2, v2);
+                if (o1 != o2 || v1 != v2){
+                    return false;
+                }
+            }
+        }
+        a.clear();
+        b.clear();
+    }
+    return true;
+}
+
+void compare(const std::vector<Vst::ParamID>& ids, int numParams, int numPoints, bool shuffle){
+    int changes = numParams * numPoints;
+    int blocks = std::max(20, 2000000 / changes);
+    double a = run<LinearChanges>(ids, numParams, numPoints, shuffle, blocks);
+    double b = run<ParameterChanges>(ids, numParams, numPoints, shuffle, blocks);
+    printf("%-8d %-7d %-8d %12.2f %12.2f %10.1f %10.1f\n", numParams, numPoints, changes,
+           a, b, a * 1e3 / changes, b * 1e3 / changes);
+}
+
+} // namespace
+
+int main(int argc, const char *argv[]){
+    int maxParams = argc > 1 ? atoi(argv[1]) : 1024;
+    if (maxParams < 16){
+        fprintf(stderr, "need at least 16 parameters\n");
+        return EXIT_FAILURE;
+    }
+    // VST3 parameter IDs are often hashes
+    std::vector<Vst::ParamID> ids(maxParams);
+    std::mt19937 rng(3);
+    for (auto& id : ids){
+        do {
+            id = rng();
+        } while (id == Vst::kNoParamId);
+    }
+    if (!verify(ids)){
+        fprintf(stderr, "results differ!\n");
+        return EXIT_FAILURE;
+    }
+    printf("%-8s %-7s %-8s %12s %12s %10s %10s\n", "params", "points", "changes",
+           "old (us)", "new (us)", "old ns/ch", "new ns/ch");
+    for (int points : { 1, 16, 64 }){
+        for (int params = 16; params <= maxParams; params *= 4){
+            compare(ids, params, points, false);
+        }
+    }
+    printf("out of order points:\n");
+    for (int params = 16; params <= maxParams; params *= 4){
+        compare(ids, params, 64, true);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+// Memory footprint of a synthetic plugin database with and without string interning
+// (see InternedString). The string fields of PluginInfo are mirrored by a simple struct
+// which is instantiated with std::string ("before") resp. InternedString ("after").
+// Finally, the database is added to a PluginManager to check that clear() frees the pool.
+//
+// usage: bench_stringpool [number of plugins]
+
+#include "Interface.h"
+#include "PluginManager.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <memory>
+#ifdef __GLIBC__
+# include <malloc.h>
+#endif
+
+using namespace vst;
+
+namespace {
+
+const int PLUGINS_PER_MODULE = 10;
+const int NUM_VENDORS = 200;
+const int NUM_PARAMS = 30;
+
+const char *categories[] = { "Fx|Delay", "Fx|Reverb", "Fx|EQ", "Fx|Dynamics",
+                             "Fx|Distortion", "Fx|Modulation", "Instrument|Synth",
+                             "Instrument|Sampler", "Fx|Analyzer", "Fx|Filter" };
+const char *labels[] = { "dB", "%", "Hz", "ms", "", "s", "semitones", "cents" };
+
+// heap memory in use
+size_t heapSize(){
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    return mallinfo2().uordblks;
+#else
+    return 0; // not available
+#endif
+}
+
+// the string fields of PluginInfo
+template<typename S>
+struct StringInfo {
+    struct Param {
+        S name;
+        S label;
+        uint32_t id = 0;
+    };
+    S path;
+    std::string name; // not interned
+    S vendor;
+    S category;
+    S version;
+    S sdkVersion;
+    std::vector<Param> parameters;
+};
+
+std::string modulePath(int i){
+    return "/usr/lib/vst3/Vendor" + std::to_string(i % NUM_VENDORS)
+            + "/Module" + std::to_string(i / PLUGINS_PER_MODULE) + ".vst3";
+}
+
+template<typename T>
+void fill(T& info, int i){
+    info.path = modulePath(i);
+    info.name = "Plugin " + std::to_string(i);
+    info.vendor = "Vendor " + std::to_string((i / PLUGINS_PER_MODULE) % NUM_VENDORS);
+    info.category = categories[i % (sizeof(categories) / sizeof(categories[0]))];
+    info.version = "1.0." + std::to_string(i % 5);
+    info.sdkVersion = "VST 3.7.1";
+}
+
+template<typename S>
+std::vector<std::unique_ptr<StringInfo<S>>> makeStrings(int n){
+    std::vector<std::unique_ptr<StringInfo<S>>> result;
+    for (int i = 0; i < n; ++i){
+        auto info = std::make_unique<StringInfo<S>>();
+        fill(*info, i);
+        for (int j = 0; j < NUM_PARAMS; ++j){
+            typename StringInfo<S>::Param param;
+            param.name = "Param " + std::to_string(j);
+            param.label = labels[j % (sizeof(labels) / sizeof(labels[0]))];
+            param.id = j;
+            info->parameters.push_back(std::move(param));
+        }
+        result.push_back(std::move(info));
+    }
+    return result;
+}
+
+void makePlugins(PluginManager& manager, int n){
+    for (int i = 0; i < n; ++i){
+        auto info = std::make_shared<PluginInfo>();
+        fill(*info, i);
+        for (int j = 0; j < NUM_PARAMS; ++j){
+            PluginInfo::Param param;
+            param.name = "Param " + std::to_string(j);
+            param.label = labels[j % (sizeof(labels) / sizeof(labels[0]))];
+            param.id = j;
+            info->addParameter(std::move(param));
+        }
+        manager.addPlugin(info->name, info);
+    }
+}
+
+void report(const char *what, size_t bytes, int n){
+    if (bytes > 0){
+        printf("%-12s %8.2f MB (%.0f bytes per plugin)\n",
+               what, bytes / 1000000.0, (double)bytes / n);
+    } else {
+        printf("%-12s n/a\n", what);
+    }
+}
+
+} // namespace
+
+int main(int argc, const char *argv[]){
+    int n = argc > 1 ? atoi(argv[1]) : 10000;
+    if (n <= 0){
+        fprintf(stderr, "bad number of plugins\n");
+        return EXIT_FAILURE;
+    }
+    printf("synthetic database: %d plugins, %d parameters each\n", n, NUM_PARAMS);
+
+    auto start = heapSize();
+    auto plain = makeStrings<std::string>(n);
+    report("plain:", heapSize() - start, n);
+    plain.clear();
+
+    start = heapSize();
+    auto interned = makeStrings<InternedString>(n);
+    report("interned:", heapSize() - start, n);
+    printf("string pool: %d strings, %d bytes\n",
+           (int)InternedString::poolCount(), (int)InternedString::poolSize());
+    interned.clear();
+
+    start = heapSize();
+    PluginManager manager;
+    makePlugins(manager, n);
+    report("database:", heapSize() - start, n);
+    // pooled strings must be freed together with the plugin descriptions
+    manager.clear();
+    printf("after clear(): %d strings, %d bytes\n",
+           (int)InternedString::poolCount(), (int)InternedString::poolSize());
+    return InternedString::poolCount() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -244,8 +244,12 @@ static PluginManager gPluginManager;
 // so that 64-bit and 32-bit installations can co-exist!
 #if (defined(_WIN32) && !defined(_WIN64)) || defined(__i386__)
 #define SETTINGS_FILE "cache32.ini"
+#define CACHE_FILE "cache32.bin"
+#define JOURNAL_FILE "cache32.journal"
 #else
 #define SETTINGS_FILE "cache.ini"
+#define CACHE_FILE "cache.bin"
+#define JOURNAL_FILE "cache.journal"
 #endif
 
 static std::string getSettingsDir(){
@@ -258,16 +262,50 @@ static std::string getSettingsDir(){
 
 static SharedMutex gFileLock;
 
-static void readIniFile(){
-    SharedLock lock(gFileLock);
+// NOTE: runs on the worker thread, so errors are collected and posted later
+static void readIniFile(std::vector<std::string>& errors){
+    auto dir = getSettingsDir();
+    bool convert = false;
+    {
+        SharedLock lock(gFileLock);
+        // try the binary cache file first
+        try {
+            gPluginManager.readBinary(dir + "/" CACHE_FILE);
+        } catch (const Error& e){
+            LOG_VERBOSE("couldn't read binary cache file: " << e.what());
+            // fall back to the INI file
+            if (pathExists(dir + "/" SETTINGS_FILE)){
+                try {
+                    gPluginManager.read(dir + "/" SETTINGS_FILE);
+                    convert = true;
+                } catch (const Error& e){
+                    errors.push_back(std::string("couldn't read settings file: ") + e.what());
+                }
+            }
+        }
+        // replay changes which haven't been compacted yet
+        try {
+            gPluginManager.readJournal(dir + "/" JOURNAL_FILE);
+        } catch (const Error& e){
+            errors.push_back(std::string("couldn't read journal file: ") + e.what());
+        }
+    }
+    if (!convert){
+        return;
+    }
+    // convert to binary cache file
+    Lock lock(gFileLock);
     try {
-        gPluginManager.read(getSettingsDir() + "/" SETTINGS_FILE);
+        gPluginManager.writeBinary(dir + "/" CACHE_FILE);
     } catch (const Error& e){
-        error("couldn't read settings file:");
-        error("%s", e.what());
+        errors.push_back(std::string("couldn't write binary cache file: ") + e.what());
     }
 }
 
+struct t_load_data : t_command_data<t_load_data> {
+    std::vector<std::string> errors;
+};
+
 static void writeIniFile(){
     Lock lock(gFileLock);
     try {
@@ -277,7 +315,23 @@ static void writeIniFile(){
                 throw Error("couldn't create directory");
             }
         }
-        gPluginManager.write(dir + "/" SETTINGS_FILE);
+        // only append the changes to the journal; the cache files are rewritten
+        // in the background once the journal has grown too large.
+        bool compact = !pathExists(dir + "/" CACHE_FILE);
+        try {
+            auto size = gPluginManager.writeJournal(dir + "/" JOURNAL_FILE);
+            if (size > PluginManager::maxJournalSize){
+                compact = true;
+            }
+        } catch (const Error& e){
+            error("couldn't write journal file:");
+            error("%s", e.what());
+            compact = true;
+        }
+        if (compact){
+            gPluginManager.compact(dir + "/" CACHE_FILE, dir + "/" SETTINGS_FILE,
+                                   dir + "/" JOURNAL_FILE);
+        }
     } catch (const Error& e){
         error("couldn't write settings file:");
         error("%s", e.what());
@@ -300,112 +354,26 @@ public:
     }
 };
 
-// for asynchronous searching, we want to show the name of the plugin before
-// the result, especially if the plugin takes a long time to load (e.g. shell plugins).
-// The drawback is that we either have to post the result on a seperate line or post
-// on the normal log level. For now, we do the latter.
-// NOTE: when probing plugins in parallel, we obviously can't do this, we have to
-// show the name and result at the same time. This is shouldn't be much of a problem
-// as there will be more activity.
+// log function for the search engine (see PluginSearch).
+// Pd's posting methods have a size limit, so we post each line seperately!
 template<bool async>
-class PdLog {
-public:
-    template <typename... T>
-    PdLog(PdLogLevel level, const char *fmt, T... args)
-        : PdLog(level)
-    {
-        if (async){
-            // post immediately
-            sys_lock();
-            if (level >= PD_NORMAL){
-                startpost(fmt, args...);
-                force_ = true; // force newline on destruction!
-            } else {
-                verbose(level, fmt, args...);
-            }
-            sys_unlock();
-        } else {
-            // defer posting
-            char buf[MAXPDSTRING];
-            snprintf(buf, MAXPDSTRING, fmt, args...);
-            ss_ << buf;
-        }
-    }
-    PdLog(PdLogLevel level)
-        : level_(level){}
-    PdLog(PdLog&& other)
-        : ss_(std::move(other.ss_)), level_(other.level_)
-    {
-        force_ = other.force_;
-        other.force_ = false; // make sure that moved from object doesn't print
-    }
-    ~PdLog(){
-        flush();
-    }
-    PdLog& flush(){
-        auto str = ss_.str();
-        PdScopedLock<async> lock;
-        if (!str.empty()){
-            if (async){
-                post("%s", ss_.str().c_str());
-            } else {
-                verbose(level_, "%s", ss_.str().c_str());
-            }
-            ss_ = std::stringstream(); // reset stream
-        } else if (force_){
-            endpost();
-        }
-        return *this;
-    }
-    PdLog& operator <<(const std::string& s){
-        ss_ << s;
-        return *this;
-    }
-    PdLog& operator <<(const Error& e){
-        flush();
-
-        PdScopedLock<async> lock;
-        verbose(PD_ERROR, "%s", e.what());
-        return *this;
-    }
-    PdLog& operator <<(const ProbeResult& result){
-        switch (result.error.code()){
-        case Error::NoError:
-            *this << "ok!";
-            break;
-        case Error::Crash:
-            *this << "crashed!";
-            break;
-        case Error::SystemError:
-            *this << "error! " << result.error.what();
-            break;
-        case Error::ModuleError:
-            *this << "couldn't load! " << result.error.what();
+static void postSearchLog(PluginSearch::LogLevel level, const std::string& msg){
+    PdScopedLock<async> lock;
+    std::stringstream ss(msg);
+    std::string line;
+    while (std::getline(ss, line)){
+        switch (level){
+        case PluginSearch::LogLevel::Error:
+            error("%s", line.c_str());
             break;
-        case Error::PluginError:
-            *this << "failed! " << result.error.what();
+        case PluginSearch::LogLevel::Normal:
+            verbose(PD_NORMAL, "%s", line.c_str());
             break;
         default:
-            *this << "unexpected error! " << result.error.what();
+            verbose(PD_DEBUG, "%s", line.c_str());
             break;
         }
-        return *this;
     }
-private:
-    std::stringstream ss_;
-    PdLogLevel level_;
-    bool force_ = false;
-};
-
-template<typename T>
-void consume(T&& obj){
-    T dummy(std::move(obj));
-}
-
-template<bool async = false, typename... T>
-void postBug(const char *fmt, T... args){
-    PdScopedLock<async> lock;
-    bug(fmt, args...);
 }
 
 template<bool async = false, typename... T>
@@ -414,249 +382,52 @@ void postError(const char *fmt, T... args){
     error(fmt, args...);
 }
 
-
-// load factory and probe plugins
-template<bool async>
-static IFactory::ptr loadFactory(const std::string& path){
-    IFactory::ptr factory;
-
-    if (gPluginManager.findFactory(path)){
-        postBug<async>("loadFactory");
-        return nullptr;
-    }
-    if (gPluginManager.isException(path)){
-        PdLog<async> log(PD_DEBUG, "'%s' is black-listed", path.c_str());
-        return nullptr;
-    }
-
-    try {
-        factory = IFactory::load(path);
-    } catch (const Error& e){
-        PdLog<async> log(PD_ERROR, "couldn't load '%s': %s", path.c_str(), e.what());
-        gPluginManager.addException(path);
-        return nullptr;
-    }
-
-    return factory;
-}
-
-// VST2: plug-in name
-// VST3: plug-in name + ".vst3"
-static std::string makeKey(const PluginInfo& desc){
-    std::string key;
-    auto ext = ".vst3";
-    auto onset = std::max<size_t>(0, desc.path.size() - strlen(ext));
-    if (desc.path.find(ext, onset) != std::string::npos){
-        key = desc.name + ext;
-    } else {
-        key = desc.name;
+// map bashed parameter names (if they differ)
+static void addParamAliases(const PluginInfo& plugin){
+    auto tables = plugin.pinTables();
+    int num = tables->parameters.size();
+    for (int j = 0; j < num; ++j){
+        auto& name = tables->parameters[j].name;
+        std::string key = name;
+        bash_name(key);
+        if (key != name){
+            const_cast<PluginInfo&>(plugin).addParamAlias(j, key);
+        }
     }
-    return key;
 }
 
-static void addFactory(const std::string& path, IFactory::ptr factory){
-    if (factory->numPlugins() == 1){
-        auto plugin = factory->getPlugin(0);
-        // factories with a single plugin can also be aliased by their file path(s)
-        gPluginManager.addPlugin(plugin->path, plugin);
-        gPluginManager.addPlugin(path, plugin);
-    }
-    gPluginManager.addFactory(path, factory);
-    for (int i = 0; i < factory->numPlugins(); ++i){
-        auto plugin = factory->getPlugin(i);
-        // also map bashed parameter names
-        int num = plugin->parameters.size();
-        for (int j = 0; j < num; ++j){
-            auto key = plugin->parameters[j].name;
-            bash_name(key);
-            const_cast<PluginInfo&>(*plugin).addParamAlias(j, key);
-        }
-        // search for presets
-        const_cast<PluginInfo&>(*plugin).scanPresets();
-        // add plugin info
+// also add the bashed keys and parameter names
+static void addBashedKeys(const IFactory& factory){
+    for (int i = 0; i < factory.numPlugins(); ++i){
+        auto plugin = factory.getPlugin(i);
+        addParamAliases(*plugin);
         auto key = makeKey(*plugin);
-        gPluginManager.addPlugin(key, plugin);
-        bash_name(key); // also add bashed version!
+        bash_name(key);
         gPluginManager.addPlugin(key, plugin);
     }
 }
 
 template<bool async>
-static IFactory::ptr probePlugin(const std::string& path){
-    auto factory = loadFactory<async>(path);
-    if (!factory){
-        return nullptr;
-    }
-
-    PdLog<async> log(PD_DEBUG, "probing '%s'... ", path.c_str());
-
-    try {
-        factory->probe([&](const ProbeResult& result){
-            if (result.total > 1){
-                if (result.index == 0){
-                    consume(std::move(log)); // force
-                }
-                // Pd's posting methods have a size limit, so we log each plugin seperately!
-                PdLog<async> log1(PD_DEBUG, "\t[%d/%d] ", result.index + 1, result.total);
-                if (result.plugin && !result.plugin->name.empty()){
-                    log1 << "'" << result.plugin->name << "' ";
-                }
-                log1 << "... " << result;
-            } else {
-                log << result;
-                consume(std::move(log));
-            }
-        });
-        if (factory->valid()){
-            addFactory(path, factory);
-            return factory; // success
-        }
-    } catch (const Error& e){
-        ProbeResult result;
-        result.error = e;
-        log << e;
-    }
-    gPluginManager.addException(path);
-    return nullptr;
+static PluginSearch makeSearch(){
+    return PluginSearch(gPluginManager, postSearchLog<async>, addBashedKeys);
 }
 
-using FactoryFuture = std::function<IFactory::ptr()>;
-
 template<bool async>
-static FactoryFuture probePluginParallel(const std::string& path){
-    auto factory = loadFactory<async>(path);
-    if (!factory){
-        return []() { return nullptr;  };
-    }
-    try {
-        // start probing process
-        auto future = factory->probeAsync();
-        // return future
-        return [=]() -> IFactory::ptr {
-            PdLog<async> log(PD_DEBUG, "probing '%s'... ", path.c_str());
-            // wait for results
-            future([&](const ProbeResult& result){
-                if (result.total > 1){
-                    if (result.index == 0){
-                        consume(std::move(log)); // force
-                    }
-                    // Pd's posting methods have a size limit, so we log each plugin seperately!
-                    PdLog<async> log1(PD_DEBUG, "\t[%d/%d] ", result.index + 1, result.total);
-                    if (result.plugin && !result.plugin->name.empty()){
-                        log1 << "'" << result.plugin->name << "' ";
-                    }
-                    log1 << "... " << result;
-                } else {
-                    log << result;
-                    consume(std::move(log));
-                }
-            }); // collect result(s)
-            if (factory->valid()){
-                addFactory(path, factory);
-                return factory;
-            } else {
-                gPluginManager.addException(path);
-                return nullptr;
-            }
-        };
-    } catch (const Error& e){
-        // return future which prints the error message
-        return [=]() -> IFactory::ptr {
-            PdLog<async> log(PD_DEBUG, "probing '%s'... ", path.c_str());
-            ProbeResult result;
-            result.error = e;
-            log << result;
-            gPluginManager.addException(path);
-            return nullptr;
-        };
-    }
-}
-
-#define PROBE_PROCESSES 8
-
-template<bool async>
-static void searchPlugins(const std::string& path, bool parallel, t_search_data *data = nullptr){
-    int count = 0;
-    {
-        std::string bashPath = path;
-        sys_unbashfilename(&bashPath[0], &bashPath[0]);
-        PdLog<async> log(PD_NORMAL, "searching in '%s' ...", bashPath.c_str()); // destroy
+static void searchPlugins(const std::vector<std::string>& paths, bool parallel,
+                          t_search_data *data = nullptr){
+    // optional probe timeout and number of parallel probes for this search
+    ProbeOptions options;
+    if (data){
+        options.timeout = data->timeout;
+        options.concurrency = data->concurrency;
     }
-
-    auto addPlugin = [&](const PluginInfo& plugin, int which = 0, int n = 0){
+    makeSearch<async>().search(paths, parallel, [&](const PluginInfo::const_ptr& plugin){
         if (data){
-            auto key = makeKey(plugin);
+            auto key = makeKey(*plugin);
             bash_name(key);
             data->plugins.push_back(gensym(key.c_str()));
         }
-        // Pd's posting methods have a size limit, so we log each plugin seperately!
-        if (n > 0){
-            PdLog<async> log(PD_DEBUG, "\t[%d/%d] ", which + 1, n);
-            log << plugin.name;
-        }
-        count++;
-    };
-
-    std::vector<FactoryFuture> futures;
-
-    auto processFutures = [&](){
-        for (auto& f : futures){
-            auto factory = f();
-            if (factory){
-                int numPlugins = factory->numPlugins();
-                for (int i = 0; i < numPlugins; ++i){
-                    addPlugin(*factory->getPlugin(i));
-                }
-            }
-        }
-        futures.clear();
-    };
-
-    vst::search(path, [&](const std::string& absPath){
-        if (data && data->cancel){
-            return; // cancel search
-        }
-        LOG_DEBUG("found " << absPath);
-        std::string pluginPath = absPath;
-        sys_unbashfilename(&pluginPath[0], &pluginPath[0]);
-        // check if module has already been loaded
-        auto factory = gPluginManager.findFactory(pluginPath);
-        if (factory){
-            // just post paths of valid plugins
-            PdLog<async> log(PD_DEBUG, "%s", factory->path().c_str());
-            auto numPlugins = factory->numPlugins();
-            if (numPlugins == 1){
-                addPlugin(*factory->getPlugin(0));
-            } else {
-                consume(std::move(log)); // force
-                for (int i = 0; i < numPlugins; ++i){
-                    addPlugin(*factory->getPlugin(i), i, numPlugins);
-                }
-            }
-        } else {
-            // probe (will post results and add plugins)
-            if (parallel){
-                futures.push_back(probePluginParallel<async>(pluginPath));
-                if (futures.size() >= PROBE_PROCESSES){
-                    processFutures();
-                }
-            } else {
-                if ((factory = probePlugin<async>(pluginPath))){
-                    int numPlugins = factory->numPlugins();
-                    for (int i = 0; i < numPlugins; ++i){
-                        addPlugin(*factory->getPlugin(i));
-                    }
-                }
-            }
-        }
-    });
-    processFutures();
-
-    if (count == 1){
-        PdLog<async> log(PD_NORMAL, "found 1 plugin");
-    } else {
-        PdLog<async> log(PD_NORMAL, "found %d plugins", count);
-    }
+    }, data ? &data->cancel : nullptr, options);
 }
 
 // tell whether we've already searched the standard VST directory
@@ -793,6 +564,12 @@ void t_vsteditor::tick(t_vsteditor *x){
     t_outlet *outlet = x->e_owner->x_messout;
     x->e_tick = true; // prevent recursion
 
+    int dropped = x->e_dropped.exchange(0);
+    if (dropped > 0){
+        pd_error(x->e_owner, "%s: event queue full, dropped %d event(s)",
+                 classname(x->e_owner), dropped);
+    }
+
     // we always need to lock
     // it's more important not to block than flushing the queues on time
     if (!x->e_mutex.try_lock()){
@@ -887,14 +664,14 @@ void t_vsteditor::setup(){
         SETSYMBOL(slider+9, e_params[i].p_slider);
         SETSYMBOL(slider+10, e_params[i].p_slider);
         char buf[64];
-        snprintf(buf, sizeof(buf), "%d: %s", i, info.parameters[i].name.c_str());
+        snprintf(buf, sizeof(buf), "%d: %s", i, info.getParameter(i).name.c_str());
         substitute_whitespace(buf);
         SETSYMBOL(slider+11, gensym(buf));
         send_mess(gensym("obj"), 21, slider);
             // create display
         SETFLOAT(display, xpos + 128 + 10); // slider + space
         SETFLOAT(display+1, ypos);
-        SETSYMBOL(display+6, gensym(info.parameters[i].label.c_str()));
+        SETSYMBOL(display+6, gensym(info.getParameter(i).label.c_str()));
         SETSYMBOL(display+7, e_params[i].p_display_rcv);
         SETSYMBOL(display+8, e_params[i].p_display_snd);
         send_mess(gensym("symbolatom"), 9, display);
@@ -935,6 +712,11 @@ void t_vsteditor::param_changed(int index, float value, bool automated){
     }
 }
 
+void t_vsteditor::dropped_events(int n){
+    e_dropped += n;
+    e_needclock.store(true); // set the clock in flush_queues()
+}
+
 void t_vsteditor::flush_queues(){
     bool expected = true;
     if (e_needclock.compare_exchange_strong(expected, false)){
@@ -973,12 +755,8 @@ void t_vsteditor::set_pos(int x, int y){
 
 template<bool async>
 static void vstplugin_search_do(t_search_data *x){
-    for (auto& path : x->paths){
-        if (!x->cancel){
-            searchPlugins<async>(path, x->parallel, x); // async
-        } else {
-            break;
-        }
+    if (!x->cancel){
+        searchPlugins<async>(x->paths, x->parallel, x); // async
     }
     // sort plugin names alphabetically and case independent
     auto& plugins = x->plugins;
@@ -1013,6 +791,8 @@ static void vstplugin_search(t_vstplugin *x, t_symbol *s, int argc, t_atom *argv
     bool async = false;
     bool parallel = true; // for now, always do a parallel search
     bool update = true; // update cache file
+    float timeout = -1; // probe timeout (< 0: default)
+    int concurrency = -1; // max. number of parallel probes (< 0: default)
     std::vector<std::string> paths;
 
     if (x->x_search_data){
@@ -1027,6 +807,20 @@ static void vstplugin_search(t_vstplugin *x, t_symbol *s, int argc, t_atom *argv
                 async = true;
             } else if (!strcmp(flag, "-n")){
                 update = false;
+            } else if (!strcmp(flag, "-t")){
+                if (argc > 1 && argv[1].a_type == A_FLOAT){
+                    timeout = argv[1].a_w.w_float;
+                    argv++; argc--;
+                } else {
+                    pd_error(x, "%s: missing argument for flag '-t'", classname(x));
+                }
+            } else if (!strcmp(flag, "-j")){
+                if (argc > 1 && argv[1].a_type == A_FLOAT){
+                    concurrency = argv[1].a_w.w_float;
+                    argv++; argc--;
+                } else {
+                    pd_error(x, "%s: missing argument for flag '-j'", classname(x));
+                }
             } else {
                 pd_error(x, "%s: unknown flag '%s'", classname(x), flag);
             }
@@ -1056,6 +850,8 @@ static void vstplugin_search(t_vstplugin *x, t_symbol *s, int argc, t_atom *argv
         data->paths = std::move(paths);
         data->parallel = parallel;
         data->update = update;
+        data->timeout = timeout;
+        data->concurrency = concurrency;
         x->x_search_data = data;
         t_workqueue::get()->push(data, vstplugin_search_do<true>, vstplugin_search_done);
     } else {
@@ -1064,6 +860,8 @@ static void vstplugin_search(t_vstplugin *x, t_symbol *s, int argc, t_atom *argv
         data.paths = std::move(paths);
         data.parallel = parallel;
         data.update = update;
+        data.timeout = timeout;
+        data.concurrency = concurrency;
         vstplugin_search_do<false>(&data);
         vstplugin_search_done(&data);
     }
@@ -1076,15 +874,319 @@ static void vstplugin_search_stop(t_vstplugin *x){
     }
 }
 
+// query the plugin database, e.g. [query -p name pro vendor fabfilter synth(
+static void vstplugin_query(t_vstplugin *x, t_symbol *s, int argc, t_atom *argv){
+    static const std::pair<const char *, uint32_t> flagNames[] = {
+        { "editor", PluginInfo::HasEditor },
+        { "synth", PluginInfo::IsSynth },
+        { "single", PluginInfo::SinglePrecision },
+        { "double", PluginInfo::DoublePrecision },
+        { "midiin", PluginInfo::MidiInput },
+        { "midiout", PluginInfo::MidiOutput },
+        { "sysexin", PluginInfo::SysexInput },
+        { "sysexout", PluginInfo::SysexOutput }
+    };
+    PluginIndex::Query query;
+
+    while (argc && argv->a_type == A_SYMBOL){
+        auto flag = argv->a_w.w_symbol->s_name;
+        if (*flag == '-'){
+            if (!strcmp(flag, "-p")){
+                query.match = PluginIndex::Match::Prefix;
+            } else {
+                pd_error(x, "%s: unknown flag '%s'", classname(x), flag);
+            }
+            argv++; argc--;
+        } else {
+            break;
+        }
+    }
+
+    while (argc > 0){
+        auto key = atom_getsymbol(argv)->s_name;
+        argv++; argc--;
+        auto flag = std::find_if(std::begin(flagNames), std::end(flagNames),
+                                 [&](auto& f){ return !strcmp(f.first, key); });
+        if (flag != std::end(flagNames)){
+            query.flags |= flag->second;
+            continue;
+        }
+        if (!argc){
+            pd_error(x, "%s: missing argument for '%s'", classname(x), key);
+            return;
+        }
+        char buf[MAXPDSTRING];
+        atom_string(argv, buf, MAXPDSTRING); // might be a number
+        argv++; argc--;
+        if (!strcmp(key, "name")){
+            query.name = buf;
+        } else if (!strcmp(key, "vendor")){
+            query.vendor = buf;
+        } else if (!strcmp(key, "category")){
+            query.category = buf;
+        } else if (!strcmp(key, "type")){
+            if (!strcmp(buf, "vst2") || !strcmp(buf, "VST2")){
+                query.type = (int)PluginType::VST2;
+            } else if (!strcmp(buf, "vst3") || !strcmp(buf, "VST3")){
+                query.type = (int)PluginType::VST3;
+            } else {
+                pd_error(x, "%s: bad plugin type '%s'", classname(x), buf);
+                return;
+            }
+        } else {
+            pd_error(x, "%s: unknown query key '%s'", classname(x), key);
+            return;
+        }
+    }
+
+    auto plugins = gPluginManager.query(query);
+    for (auto& plugin : plugins){
+        // same key as in the search results
+        auto key = makeKey(*plugin);
+        bash_name(key);
+        t_atom msg[5];
+        SETSYMBOL(&msg[0], gensym(key.c_str()));
+        SETSYMBOL(&msg[1], gensym(plugin->vendor.c_str()));
+        SETSYMBOL(&msg[2], gensym(plugin->category.c_str()));
+        SETSYMBOL(&msg[3], gensym(plugin->version.c_str()));
+        SETSYMBOL(&msg[4], gensym(plugin->type() == PluginType::VST3 ? "VST3" : "VST2"));
+        outlet_anything(x->x_messout, gensym("query"), 5, msg);
+    }
+    t_atom msg;
+    SETFLOAT(&msg, plugins.size());
+    outlet_anything(x->x_messout, gensym("query_done"), 1, &msg);
+}
+
 static void vstplugin_search_clear(t_vstplugin *x, t_floatarg f){
+    Lock lock(gFileLock); // wait for readIniFile()
         // unloading plugins might crash, so we we first delete the cache file
     if (f != 0){
         removeFile(getSettingsDir() + "/" SETTINGS_FILE);
+        removeFile(getSettingsDir() + "/" CACHE_FILE);
+        removeFile(getSettingsDir() + "/" JOURNAL_FILE);
     }
         // clear the plugin description dictionary
     gPluginManager.clear();
 }
 
+/*------------------------ watcher ----------------------------*/
+
+// The watcher (if supported on the platform) observes the default search paths and the
+// preset folders of opened plugins. Changed modules are probed on the watcher thread;
+// subscribed instances are notified with "watch add <key>" resp. "watch remove <path>",
+// preset changes are broadcasted with "preset_change <key>" (see vstplugin_preset_change).
+// NOTE: the watcher is never destroyed because joining its thread while holding the
+// Pd lock might deadlock (see also t_workqueue).
+static DirectoryWatcher *gWatcher = nullptr;
+static std::mutex gWatchMutex;
+static std::unordered_map<std::string, std::string> gPresetFolders; // folder -> plugin key
+#ifdef PDINSTANCE
+static std::unordered_map<t_pdinstance *, int> gWatchInstances; // subscribed instances
+#else
+static int gWatchCount = 0; // number of subscribed objects
+#endif
+
+static bool isInFolder(const std::string& path, const std::string& folder){
+    return !path.compare(0, folder.size(), folder) && (path.size() == folder.size()
+        || path[folder.size()] == '/' || path[folder.size()] == '\\');
+}
+
+static void watchPresetFolders(const PluginInfo& info){
+    if (!gWatcher){
+        return;
+    }
+    auto key = makeKey(info);
+    for (auto type : { PresetType::User, PresetType::UserFactory,
+                       PresetType::SharedFactory, PresetType::Global }){
+        auto folder = info.getPresetFolder(type);
+        if (!folder.empty()){
+            std::lock_guard<std::mutex> lock(gWatchMutex);
+            if (gPresetFolders.emplace(folder, key).second){
+                gWatcher->watch(folder);
+            }
+        }
+    }
+}
+
+// send notifications to all subscribed instances (must be called with the Pd lock)
+static void watchNotify(const std::vector<std::pair<t_symbol *, t_symbol *>>& events){
+    auto thing = gensym(t_vstplugin::glob_recv_name)->s_thing;
+    if (thing){
+        for (auto& e : events){
+            if (e.first == gensym("preset")){
+                pd_vmess(thing, gensym("preset_change"), (char *)"s", e.second);
+            } else {
+                pd_vmess(thing, gensym("watch_change"), (char *)"ss", e.first, e.second);
+            }
+        }
+    }
+}
+
+// called on the watcher thread
+static void watchCallback(const std::vector<std::string>& paths){
+#ifdef PDINSTANCE
+    std::vector<t_pdinstance *> instances;
+    {
+        std::lock_guard<std::mutex> lock(gWatchMutex);
+        for (auto& it : gWatchInstances){
+            instances.push_back(it.first);
+        }
+    }
+    if (instances.empty()){
+        return;
+    }
+    pd_setinstance(instances.front()); // for posting
+#endif
+    std::vector<std::pair<std::string, std::string>> events;
+    std::unordered_set<std::string> modules;
+    for (auto& path : paths){
+        // preset folders
+        bool preset = false;
+        {
+            std::lock_guard<std::mutex> lock(gWatchMutex);
+            for (auto& it : gPresetFolders){
+                if (isInFolder(path, it.first)){
+                    events.emplace_back("preset", it.second);
+                    preset = true;
+                }
+            }
+        }
+        if (preset){
+            continue;
+        }
+        auto module = getModulePath(path);
+        if (!module.empty()){
+            modules.insert(module);
+        } else if (isDirectory(path)){
+            // new directory or rescan (e.g. after an event queue overflow)
+            vst::search(path, [&](const std::string& p){
+                modules.insert(p);
+            });
+            for (auto& m : gPluginManager.removeModules(path, true)){
+                events.emplace_back("remove", m);
+            }
+        } else if (!pathExists(path)){
+            // removed directory
+            for (auto& m : gPluginManager.removeModules(path)){
+                events.emplace_back("remove", m);
+            }
+        }
+    }
+    bool changed = false;
+    for (auto& module : modules){
+        if (!pathExists(module)){
+            for (auto& m : gPluginManager.removeModules(module)){
+                events.emplace_back("remove", m);
+                changed = true;
+            }
+            continue;
+        }
+        if (gPluginManager.checkModule(module)){
+            events.emplace_back("remove", module);
+            changed = true;
+        }
+        if (!gPluginManager.findFactory(module) && !gPluginManager.isException(module)){
+            auto search = makeSearch<true>();
+            auto factory = gPluginManager.findDuplicate(module);
+            if (factory){
+                search.addFactory(module, factory);
+            } else {
+                factory = search.probe(module, true);
+            }
+            if (factory){
+                for (int i = 0; i < factory->numPlugins(); ++i){
+                    events.emplace_back("add", makeKey(*factory->getPlugin(i)));
+                }
+            }
+            changed = true;
+        }
+    }
+    if (changed){
+        writeIniFile();
+    }
+    if (events.empty()){
+        return;
+    }
+    std::vector<std::pair<t_symbol *, t_symbol *>> symbols;
+#ifdef PDINSTANCE
+    for (auto instance : instances){
+        pd_setinstance(instance);
+        sys_lock();
+        symbols.clear();
+        for (auto& e : events){
+            symbols.emplace_back(gensym(e.first.c_str()), gensym(e.second.c_str()));
+        }
+        watchNotify(symbols);
+        sys_unlock();
+    }
+#else
+    sys_lock();
+    for (auto& e : events){
+        symbols.emplace_back(gensym(e.first.c_str()), gensym(e.second.c_str()));
+    }
+    watchNotify(symbols);
+    sys_unlock();
+#endif
+}
+
+// watch the default search paths while there is at least one subscriber
+static void watchDefaultPaths(bool enable){
+    for (auto& path : getDefaultSearchPaths()){
+        if (enable){
+            gWatcher->watch(path);
+        } else {
+            gWatcher->unwatch(path);
+        }
+    }
+}
+
+static void vstplugin_watch(t_vstplugin *x, t_floatarg f){
+    bool enable = f != 0;
+    if (enable == x->x_watch){
+        return;
+    }
+    if (!gWatcher){
+        try {
+            gWatcher = DirectoryWatcher::create(watchCallback).release();
+        } catch (const Error& e){
+            pd_error(x, "%s: couldn't start watcher: %s", classname(x), e.what());
+            return;
+        }
+        if (!gWatcher){
+            pd_error(x, "%s: watching plugin folders is not supported on this platform", classname(x));
+            return;
+        }
+    }
+    x->x_watch = enable;
+    std::lock_guard<std::mutex> lock(gWatchMutex);
+#ifdef PDINSTANCE
+    auto& count = gWatchInstances[pd_this];
+#else
+    auto& count = gWatchCount;
+#endif
+    if (enable){
+        if (count++ == 0){
+            watchDefaultPaths(true);
+        }
+    } else {
+        if (--count == 0){
+            watchDefaultPaths(false);
+        #ifdef PDINSTANCE
+            gWatchInstances.erase(pd_this);
+        #endif
+        }
+    }
+}
+
+static void vstplugin_watch_change(t_vstplugin *x, t_symbol *type, t_symbol *arg){
+    if (x->x_watch){
+        t_atom msg[2];
+        SETSYMBOL(&msg[0], type);
+        SETSYMBOL(&msg[1], arg);
+        outlet_anything(x->x_messout, gensym("watch"), 2, msg);
+    }
+}
+
 // resolves relative paths to an existing plugin in the canvas search paths or VST search paths.
 // returns empty string on failure!
 template<bool async>
@@ -1167,9 +1269,33 @@ static std::string resolvePath(t_canvas *c, const std::string& s){
     return result;
 }
 
+// The search only scans the plugin metadata; the parameters and programs
+// are probed when the plugin is used for the first time.
+template<bool async>
+static PluginInfo::const_ptr completePlugin(PluginInfo::const_ptr desc){
+    std::stringstream ss;
+    ss << "probing '" << desc->name << "'... ";
+    ProbeResult result;
+    try {
+        desc = gPluginManager.probeFull(desc);
+    } catch (const Error& e){
+        result.error = e;
+        desc = nullptr;
+    }
+    PluginSearch::formatResult(ss, result);
+    postSearchLog<async>(PluginSearch::LogLevel::Verbose, ss.str());
+    if (desc){
+        addParamAliases(*desc);
+        writeIniFile(); // mutex protected
+    }
+    return desc;
+}
+
 // query a plugin by its key or file path and probe if necessary.
+// NB: the plugin description might be replaced in the plugin manager at any time
+// (e.g. by completePlugin() or the watcher), so the caller must hold on to the result.
 template<bool async>
-static const PluginInfo * queryPlugin(t_vstplugin *x, const std::string& path){
+static PluginInfo::const_ptr queryPlugin(t_vstplugin *x, const std::string& path){
     // query plugin
     auto desc = gPluginManager.findPlugin(path);
     if (!desc){
@@ -1181,7 +1307,7 @@ static const PluginInfo * queryPlugin(t_vstplugin *x, const std::string& path){
                     "nor a valid file path", path.c_str());
         } else if (!(desc = gPluginManager.findPlugin(abspath))){
                 // finally probe plugin
-            if (probePlugin<async>(abspath)){
+            if (makeSearch<async>().probe(abspath)){
                 desc = gPluginManager.findPlugin(abspath);
                 // findPlugin() fails if the module contains several plugins,
                 // which means the path can't be used as a key.
@@ -1194,7 +1320,10 @@ static const PluginInfo * queryPlugin(t_vstplugin *x, const std::string& path){
             }
         }
    }
-   return desc.get();
+   if (desc && desc->isPartial()){
+       desc = completePlugin<async>(desc);
+   }
+   return desc;
 }
 
 // close
@@ -1260,13 +1389,15 @@ static void vstplugin_close(t_vstplugin *x){
 struct t_open_data : t_command_data<t_open_data> {
     t_symbol *path;
     bool editor;
+    PluginInfo::const_ptr info; // keep the queried plugin alive
     IPlugin::ptr plugin;
 };
 
 template<bool async>
 static void vstplugin_open_do(t_open_data *x){
     // get plugin info
-    const PluginInfo *info = queryPlugin<async>(x->owner, x->path->s_name);
+    x->info = queryPlugin<async>(x->owner, x->path->s_name);
+    auto info = x->info.get();
     if (!info){
         PdScopedLock<async> lock;
         pd_error(x->owner, "%s: can't open '%s'", classname(x->owner), x->path->s_name);
@@ -1302,6 +1433,8 @@ static void vstplugin_open_done(t_open_data *x){
         x->owner->x_key = gensym(makeKey(info).c_str());
         // store path symbol (to avoid reopening the same plugin)
         x->owner->x_path = x->path;
+        // get notified about preset changes
+        watchPresetFolders(info);
         // receive events from plugin
         x->owner->x_plugin->setListener(x->owner->x_editor);
         // update Pd editor
@@ -1414,10 +1547,13 @@ static void sendInfo(t_vstplugin *x, const char *what, int value){
 
 // plugin info (no args: currently loaded plugin, symbol arg: path of plugin to query)
 static void vstplugin_info(t_vstplugin *x, t_symbol *s, int argc, t_atom *argv){
+    PluginInfo::const_ptr desc; // keep the queried plugin alive
     const PluginInfo *info = nullptr;
     if (argc > 0){ // some plugin
         auto path = atom_getsymbol(argv)->s_name;
-        if (!(info = queryPlugin<false>(x, path))){
+        if ((desc = queryPlugin<false>(x, path))){
+            info = desc.get();
+        } else {
             pd_error(x, "%s: couldn't open '%s' - no such file or plugin!", classname(x), path);
             return;
         }
@@ -1707,11 +1843,11 @@ static void vstplugin_param_get(t_vstplugin *x, t_symbol *s, int argc, t_atom *a
 }
 
 // get parameter info (name + label + ...)
-static void vstplugin_param_doinfo(const PluginInfo& info, int index, t_outlet *outlet){
+static void vstplugin_param_doinfo(int index, const PluginInfo::Param& param, t_outlet *outlet){
     t_atom msg[3];
     SETFLOAT(&msg[0], index);
-    SETSYMBOL(&msg[1], gensym(info.parameters[index].name.c_str()));
-    SETSYMBOL(&msg[2], gensym(info.parameters[index].label.c_str()));
+    SETSYMBOL(&msg[1], gensym(param.name.c_str()));
+    SETSYMBOL(&msg[2], gensym(param.label.c_str()));
     // LATER add more info
     outlet_anything(outlet, gensym("param_info"), 3, msg);
 }
@@ -1722,7 +1858,7 @@ static void vstplugin_param_info(t_vstplugin *x, t_floatarg f){
     int index = f;
     auto& info = x->x_plugin->info();
     if (index >= 0 && index < info.numParameters()){
-        vstplugin_param_doinfo(info, index, x->x_messout);
+        vstplugin_param_doinfo(index, info.getParameter(index), x->x_messout);
     } else {
         pd_error(x, "%s: parameter index %d out of range!", classname(x), index);
     }
@@ -1738,10 +1874,13 @@ static void vstplugin_param_count(t_vstplugin *x){
 
 // list parameters (index + info)
 static void vstplugin_param_list(t_vstplugin *x, t_symbol *s){
+    PluginInfo::const_ptr desc; // keep the queried plugin alive
     const PluginInfo *info = nullptr;
     if (*s->s_name){
         auto path = s->s_name;
-        if (!(info = queryPlugin<false>(x, path))){
+        if ((desc = queryPlugin<false>(x, path))){
+            info = desc.get();
+        } else {
             pd_error(x, "%s: couldn't open '%s' - no such file or plugin!", classname(x), path);
             return;
         }
@@ -1749,9 +1888,11 @@ static void vstplugin_param_list(t_vstplugin *x, t_symbol *s){
         if (!x->check_plugin()) return;
         info = &x->x_plugin->info();
     }
-    int n = info->numParameters();
+    // the plugin might not be open, so we have to pin the tables
+    auto tables = info->pinTables();
+    int n = tables->parameters.size();
     for (int i = 0; i < n; ++i){
-        vstplugin_param_doinfo(*info, i, x->x_messout);
+        vstplugin_param_doinfo(i, tables->parameters[i], x->x_messout);
     }
 }
 
@@ -1890,11 +2031,14 @@ static void vstplugin_program_count(t_vstplugin *x){
 
 // list all programs (index + name)
 static void vstplugin_program_list(t_vstplugin *x,  t_symbol *s){
+    PluginInfo::const_ptr desc; // keep the queried plugin alive
     const PluginInfo *info = nullptr;
     bool local = false;
     if (*s->s_name){
         auto path = s->s_name;
-        if (!(info = queryPlugin<false>(x, path))){
+        if ((desc = queryPlugin<false>(x, path))){
+            info = desc.get();
+        } else {
             pd_error(x, "%s: couldn't open '%s' - no such file or plugin!", classname(x), path);
             return;
         }
@@ -1903,11 +2047,13 @@ static void vstplugin_program_list(t_vstplugin *x,  t_symbol *s){
         info = &x->x_plugin->info();
         local = true;
     }
-    int n = info->numPrograms();
+    // the plugin might not be open, so we have to pin the tables
+    auto tables = info->pinTables();
+    int n = tables->programs.size();
     t_atom msg[2];
     for (int i = 0; i < n; ++i){
         t_symbol *name = gensym(local ? x->x_plugin->getProgramNameIndexed(i).c_str()
-                                            : info->programs[i].c_str());
+                                            : tables->programs[i].c_str());
         SETFLOAT(&msg[0], i);
         SETSYMBOL(&msg[1], name);
         outlet_anything(x->x_messout, gensym("program_name"), 2, msg);
@@ -2165,8 +2311,9 @@ static void vstplugin_preset_doinfo(t_vstplugin *x, const PluginInfo& info, int
     // At least we always do a range check.
     auto rdlock = info.readLock();
 #endif
-    if (index >= 0 && index < info.numPresets()){
-        auto& preset = info.presets[index];
+    auto presets = info.presets(); // snapshot
+    if (index >= 0 && index < (int)presets->size()){
+        auto& preset = (*presets)[index];
         int type = 0;
         switch (preset.type){
         case PresetType::User:
@@ -2205,10 +2352,13 @@ static void vstplugin_preset_info(t_vstplugin *x, t_floatarg f){
 }
 
 static void vstplugin_preset_list(t_vstplugin *x, t_symbol *s){
+    PluginInfo::const_ptr desc; // keep the queried plugin alive
     const PluginInfo *info = nullptr;
     if (*s->s_name){
         auto path = s->s_name;
-        if (!(info = queryPlugin<false>(x, path))){
+        if ((desc = queryPlugin<false>(x, path))){
+            info = desc.get();
+        } else {
             pd_error(x, "%s: couldn't open '%s' - no such file or plugin!", classname(x), path);
             return;
         }
@@ -2281,7 +2431,8 @@ static int vstplugin_preset_index(t_vstplugin *x, int argc, t_atom *argv, bool l
 }
 
 static bool vstplugin_preset_writeable(t_vstplugin *x, const PluginInfo& info, int index){
-    bool writeable = info.presets[index].type == PresetType::User;
+    auto presets = info.presets(); // snapshot
+    bool writeable = index < (int)presets->size() && (*presets)[index].type == PresetType::User;
     if (!writeable){
         pd_error(x, "%s: preset is not writeable!", classname(x));
     }
@@ -2323,7 +2474,8 @@ static void vstplugin_preset_load(t_vstplugin *x, t_symbol *s, int argc, t_atom
         return;
     }
 
-    auto& preset = info.presets[index];
+    auto presets = info.presets(); // snapshot
+    auto& preset = (*presets)[index];
     x->x_preset = gensym(preset.name.c_str());
     auto path = gensym(preset.path.c_str());
 #ifdef PDINSTANCE
@@ -2369,7 +2521,7 @@ static void vstplugin_preset_save(t_vstplugin *x, t_symbol *s, int argc, t_atom
             return;
         }
     } else {
-        preset = info.presets[index];
+        preset = (*info.presets())[index];
     }
 
     bool async = atom_getfloatarg(1, argc, argv); // optional 2nd argument
@@ -2436,7 +2588,7 @@ static void vstplugin_preset_rename(t_vstplugin *x, t_symbol *s, int argc, t_ato
         return;
     }
     // check if we rename the current preset
-    bool update = x->x_preset && (x->x_preset->s_name == info.presets[index].name);
+    bool update = x->x_preset && (x->x_preset->s_name == (*info.presets())[index].name);
 
     if (vstplugin_preset_writeable(x, info, index)){
         if (const_cast<PluginInfo&>(info).renamePreset(index, newname->s_name)){
@@ -2483,7 +2635,7 @@ static void vstplugin_preset_delete(t_vstplugin *x, t_symbol *s, int argc, t_ato
     }
 
     // check if we delete the current preset
-    bool current = x->x_preset && (x->x_preset->s_name == info.presets[index].name);
+    bool current = x->x_preset && (x->x_preset->s_name == (*info.presets())[index].name);
 
     if (vstplugin_preset_writeable(x, info, index)){
         if (const_cast<PluginInfo&>(info).removePreset(index)){
@@ -2656,9 +2808,7 @@ t_vstplugin::t_vstplugin(int argc, t_atom *argv){
     x_messout = outlet_new(&x_obj, 0); // additional message outlet
 
     if (search && !gDidSearch){
-        for (auto& path : getDefaultSearchPaths()){
-            searchPlugins<false>(path, true); // synchronous and parallel
-        }
+        searchPlugins<false>(getDefaultSearchPaths(), true); // synchronous and parallel
     #if 1
         writeIniFile(); // shall we write cache file?
     #endif
@@ -2702,6 +2852,8 @@ t_vstplugin::~t_vstplugin(){
     }
     LOG_DEBUG("vstplugin free");
 
+    vstplugin_watch(this, 0);
+
     pd_unbind(&x_obj.ob_pd, gensym(glob_recv_name));
 }
 
@@ -2716,10 +2868,10 @@ static void vstplugin_free(t_vstplugin *x){
 template<typename TFloat>
 static void vstplugin_doperform(t_vstplugin *x, int n){
     auto plugin = x->x_plugin.get();
-    auto invec = (TFloat **)alloca(sizeof(TFloat *) * x->x_siginlets.size());
-    auto outvec = (TFloat **)alloca(sizeof(TFloat *) * x->x_sigoutlets.size());
-    auto auxinvec = (TFloat **)alloca(sizeof(TFloat *) * x->x_sigauxinlets.size());
-    auto auxoutvec = (TFloat **)alloca(sizeof(TFloat *) * x->x_sigauxoutlets.size());
+    auto invec = (TFloat **)x->x_bufvec.data();
+    auto auxinvec = invec + x->x_siginlets.size();
+    auto outvec = auxinvec + x->x_sigauxinlets.size();
+    auto auxoutvec = outvec + x->x_sigoutlets.size();
 
     auto prepareInput = [](auto vec, auto& inlets, auto buf, int k){
         for (size_t i = 0; i < inlets.size(); ++i, buf += k){
@@ -2765,7 +2917,9 @@ static void vstplugin_doperform(t_vstplugin *x, int n){
     data.numOutputs = x->x_sigoutlets.size();
     data.numAuxInputs = x->x_sigauxinlets.size();
     data.numAuxOutputs = x->x_sigauxoutlets.size();
+    x->x_dspload.begin();
     plugin->process(data);
+    x->x_dspload.end(n, x->x_sr);
 
     if (!std::is_same<t_sample, TFloat>::value){
             // copy output buffer to Pd outlets
@@ -2816,6 +2970,10 @@ static t_int *vstplugin_perform(t_int *w){
         } else { // single precision
             vstplugin_doperform<float>(x, n);
         }
+        int dropped = plugin->takeNumDroppedEvents();
+        if (dropped > 0){
+            x->x_editor->dropped_events(dropped);
+        }
         if (x->x_command >= 0){
             x->x_mutex.unlock();
         }
@@ -2944,6 +3102,9 @@ static void vstplugin_dsp(t_vstplugin *x, t_signal **sp){
         *it = sp[k++]->s_vec;
     }
     x->x_auxoutbuf.resize(x->x_sigauxoutlets.size() * sizeof(double) * blocksize);
+    // channel pointers for all of the above
+    x->x_bufvec.resize(x->x_siginlets.size() + x->x_sigauxinlets.size()
+                       + x->x_sigoutlets.size() + x->x_sigauxoutlets.size());
 }
 
 // setup function
@@ -2968,6 +3129,9 @@ EXPORT void vstplugin_tilde_setup(void){
     class_addmethod(vstplugin_class, (t_method)vstplugin_search, gensym("search"), A_GIMME, A_NULL);
     class_addmethod(vstplugin_class, (t_method)vstplugin_search_stop, gensym("search_stop"), A_NULL);
     class_addmethod(vstplugin_class, (t_method)vstplugin_search_clear, gensym("search_clear"), A_DEFFLOAT, A_NULL);
+    class_addmethod(vstplugin_class, (t_method)vstplugin_query, gensym("query"), A_GIMME, A_NULL);
+    class_addmethod(vstplugin_class, (t_method)vstplugin_watch, gensym("watch"), A_FLOAT, A_NULL);
+    class_addmethod(vstplugin_class, (t_method)vstplugin_watch_change, gensym("watch_change"), A_SYMBOL, A_SYMBOL, A_NULL);
 
     class_addmethod(vstplugin_class, (t_method)vstplugin_bypass, gensym("bypass"), A_FLOAT, A_NULL);
     class_addmethod(vstplugin_class, (t_method)vstplugin_reset, gensym("reset"), A_DEFFLOAT, A_NULL);
@@ -3038,8 +3202,17 @@ EXPORT void vstplugin_tilde_setup(void){
 
     t_workqueue::init();
 
-    // read cached plugin info
-    readIniFile();
+    // read cached plugin info on the worker thread, so we don't block Pd on startup.
+    // lookups which arrive in the meantime only wait for the requested plugin.
+    gPluginManager.beginLoad();
+    t_workqueue::get()->push(new t_load_data, [](t_load_data *x){
+        readIniFile(x->errors);
+        gPluginManager.endLoad();
+    }, [](t_load_data *x){
+        for (auto& e : x->errors){
+            error("%s", e.c_str());
+        }
+    });
 
 #if !HAVE_UI_THREAD
     eventLoopClock = clock_new(0, (t_method)eventLoopTick);
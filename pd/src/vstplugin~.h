@@ -2,6 +2,7 @@
 
 #include "Interface.h"
 #include "PluginManager.h"
+#include "PluginSearch.h"
 #include "Utility.h"
 
 using namespace vst;
@@ -48,6 +49,8 @@ struct t_search_data : t_command_data<t_search_data> {
     std::vector<t_symbol *> plugins;
     bool parallel;
     bool update;
+    float timeout; // probe timeout (< 0: default)
+    int concurrency; // max. number of parallel probes (< 0: default)
     std::atomic_bool cancel {false};
 };
 
@@ -65,6 +68,7 @@ class t_vstplugin {
     t_canvas *x_canvas; // parent canvas
     int x_blocksize = 64;
     t_float x_sr = 44100;
+    DspLoadMeter x_dspload; // for probe throttling
     std::vector<t_sample *> x_siginlets;
     std::vector<t_sample *> x_sigoutlets;
     std::vector<t_sample *> x_sigauxinlets;
@@ -73,6 +77,7 @@ class t_vstplugin {
     std::vector<char> x_auxinbuf;
     std::vector<char> x_outbuf;
     std::vector<char> x_auxoutbuf;
+    std::vector<void *> x_bufvec; // channel pointers (see vstplugin_doperform)
     std::mutex x_mutex;
     // VST plugin
     IPlugin::ptr x_plugin;
@@ -82,6 +87,7 @@ class t_vstplugin {
     bool x_async = false;
     bool x_uithread = false;
     bool x_keep = false;
+    bool x_watch = false; // receive watcher notifications
     Bypass x_bypass = Bypass::Off;
     ProcessPrecision x_precision; // single/double precision
     int x_command = -1;
@@ -129,6 +135,8 @@ class t_vsteditor : public IPluginListener {
     void param_changed(int index, float value, bool automated = false);
     // flush parameter, MIDI and sysex queues
     void flush_queues();
+    // report dropped MIDI and sysex events in the clock method (see IPlugin::takeNumDroppedEvents())
+    void dropped_events(int n);
     // show/hide window
     void vis(bool v);
     bool pd_gui() const {
@@ -167,6 +175,7 @@ class t_vsteditor : public IPluginListener {
     std::mutex e_mutex;
     std::thread::id e_mainthread;
     std::atomic_bool e_needclock {false};
+    std::atomic<int> e_dropped {0};
     std::vector<std::pair<int, float>> e_automated;
     std::vector<MidiEvent> e_midi;
     std::vector<SysexEvent> e_sysex;
@@ -20,6 +20,7 @@ VSTPluginDesc {
 	var <>midiOutput;
 	var <>sysexInput;
 	var <>sysexOutput;
+	var <>partial;
 	var <>parameters;
 	var <>programs;
 	var <>presets;
@@ -334,7 +335,7 @@ VSTPluginDesc {
 						\flags,
 						{
 							f = hex2int.(value);
-							flags = Array.fill(8, {arg i; ((f >> i) & 1).asBoolean });
+							flags = Array.fill(9, {arg i; ((f >> i) & 1).asBoolean });
 							info.hasEditor = flags[0];
 							info.isSynth = flags[1];
 							info.singlePrecision = flags[2];
@@ -343,6 +344,7 @@ VSTPluginDesc {
 							info.midiOutput = flags[5];
 							info.sysexInput = flags[6];
 							info.sysexOutput = flags[7];
+							info.partial = flags[8];
 						}
 					);
 				},
@@ -379,6 +381,8 @@ VSTPluginDesc {
 VSTPlugin : MultiOutUGen {
 	// class members
 	classvar pluginDict;
+	classvar watchDict;
+	classvar pluginVersion;
 	classvar <platformExtension;
 	// instance members
 	var <id;
@@ -391,6 +395,8 @@ VSTPlugin : MultiOutUGen {
 			);
 			pluginDict = IdentityDictionary.new;
 			pluginDict[Server.default] = IdentityDictionary.new;
+			watchDict = IdentityDictionary.new;
+			pluginVersion = IdentityDictionary.new;
 		}
 	}
 	*ar { arg input, numOut=1, bypass=0, params, id, info, auxInput, numAuxOut=0;
@@ -437,6 +443,7 @@ VSTPlugin : MultiOutUGen {
 		server = server ?? Server.default;
 		// clear local plugin dictionary
 		pluginDict[server] = IdentityDictionary.new;
+		pluginVersion[server] = nil;
 		// clear server plugin dictionary
 		// remove=true -> also delete temp file
 		server.listSendMsg(this.clearMsg(remove));
@@ -447,33 +454,38 @@ VSTPlugin : MultiOutUGen {
 	*reset { arg server;
 		this.deprecated(thisMethod, this.class.findMethod(\clear));
 	}
-	*search { arg server, dir, useDefault=true, verbose=true, wait = -1, action, save=true, parallel=true;
+	*search { arg server, dir, useDefault=true, verbose=true, wait = -1, action, save=true, parallel=true, timeout=nil, progress;
 		server = server ?? Server.default;
 		// add dictionary if it doesn't exist yet
 		pluginDict[server].isNil.if { pluginDict[server] = IdentityDictionary.new };
-		server.isLocal.if { this.prSearchLocal(server, dir, useDefault, verbose, save, parallel, action) }
-		{ this.prSearchRemote(server, dir, useDefault, verbose, save, parallel, wait, action) };
+		server.isLocal.if { this.prSearchLocal(server, dir, useDefault, verbose, save, parallel, timeout, action, progress) }
+		{ this.prSearchRemote(server, dir, useDefault, verbose, save, parallel, timeout, wait, action, progress) };
 	}
-	*searchMsg { arg dir, useDefault=true, verbose=false, save=true, parallel=true, dest=nil;
-		var flags = 0;
+	*searchMsg { arg dir, useDefault=true, verbose=false, save=true, parallel=true, dest=nil, timeout=nil;
+		var flags = 0, msg, parallelFlag;
 		dir.isString.if { dir = [dir] };
 		(dir.isNil or: dir.isArray).not.if { ^"bad type for 'dir' argument!".throw };
 		dir = dir.collect({ arg p; p.asString.standardizePath});
-		// make flags
-		[useDefault, verbose, save, parallel].do { arg value, bit;
+		// make flags (parallel might be the number of parallel probes)
+		parallelFlag = parallel.isInteger.if { parallel != 1 } { parallel };
+		[useDefault, verbose, save, parallelFlag].do { arg value, bit;
 			flags = flags | (value.asBoolean.asInteger << bit);
 		};
 		dest = this.prMakeDest(dest); // nil -> -1 = don't write results
-		^['/cmd', '/vst_search', flags, dest] ++ dir;
+		msg = ['/cmd', '/vst_search', flags, dest];
+		// parallel: Integer = max. number of parallel probes
+		(timeout.notNil or: parallel.isInteger).if { msg = msg.add((timeout ? -1).asFloat) };
+		parallel.isInteger.if { msg = msg.add(parallel) };
+		^msg ++ dir;
 	}
-	*prSearchLocal { arg server, dir, useDefault, verbose, save, parallel, action;
+	*prSearchLocal { arg server, dir, useDefault, verbose, save, parallel, timeout, action, progress;
 		{
 			var stream, dict = pluginDict[server];
 			var tmpPath = this.prMakeTmpPath;
 			// ask VSTPlugin to store the search results in a temp file
-			server.listSendMsg(this.searchMsg(dir, useDefault, verbose, save, parallel, tmpPath));
-			// wait for cmd to finish
-			server.sync;
+			server.listSendMsg(this.searchMsg(dir, useDefault, verbose, save, parallel, tmpPath, timeout));
+			// wait for the search to finish
+			this.prWaitForSearch(server, progress);
 			// read file
 			try {
 				File.use(tmpPath, "rb", { arg file;
@@ -491,15 +503,15 @@ VSTPlugin : MultiOutUGen {
 			action.value;
 		}.forkIfNeeded;
 	}
-	*prSearchRemote { arg server, dir, useDefault, verbose, save, parallel, wait, action;
+	*prSearchRemote { arg server, dir, useDefault, verbose, save, parallel, timeout, wait, action, progress;
 		{
 			var dict = pluginDict[server];
 			var buf = Buffer(server); // get free Buffer
 			// ask VSTPlugin to store the search results in this Buffer
 			// (it will allocate the memory for us!)
-			server.listSendMsg(this.searchMsg(dir, useDefault, verbose, save, parallel, buf));
-			// wait for cmd to finish and update buffer info
-			server.sync;
+			server.listSendMsg(this.searchMsg(dir, useDefault, verbose, save, parallel, buf, timeout));
+			// wait for the search to finish and update buffer info
+			this.prWaitForSearch(server, progress);
 			buf.updateInfo({
 				// now read data from Buffer
 				buf.getToFloatArray(wait: wait, timeout: 5, action: { arg array;
@@ -514,11 +526,92 @@ VSTPlugin : MultiOutUGen {
 			});
 		}.forkIfNeeded;
 	}
+	*prWaitForSearch { arg server, progress;
+		// the search runs in the background, so we poll for new plugins until it has finished.
+		// new plugins are reported as (len, chars...)+ (see cmdSearchPollDone in VSTPlugin.cpp)
+		var done = false, progressFunc, doneFunc;
+		progressFunc = OSCFunc({ arg msg;
+			var onset = 3, len;
+			while { onset < msg.size } {
+				len = msg[onset].asInteger;
+				progress.value(VSTPluginController.msg2string(msg, onset).asSymbol);
+				onset = onset + len + 1;
+			};
+		}, '/vst_search_progress', server.addr, argTemplate: [0, -1]);
+		doneFunc = OSCFunc({ done = true }, '/vst_search_done', server.addr, argTemplate: [0, -1]);
+		server.sync; // wait for the search to start
+		while { done.not } {
+			server.listSendMsg(this.searchPollMsg);
+			0.05.wait;
+		};
+		progressFunc.free;
+		doneFunc.free;
+	}
+	*searchPollMsg { ^['/cmd', '/vst_search_poll']; }
 	*stopSearch { arg server;
 		server = server ?? Server.default;
 		server.listSendMsg(this.stopSearchMsg);
 	}
 	*stopSearchMsg { ^['/cmd', '/vst_search_stop']; }
+	*watch { arg server, enable=true, verbose=false, action;
+		server = server ?? Server.default;
+		// add dictionary if it doesn't exist yet
+		pluginDict[server].isNil.if { pluginDict[server] = IdentityDictionary.new };
+		// stop old watcher
+		watchDict[server] !? { arg w; w[0].free; w[1].stop; watchDict[server] = nil };
+		server.listSendMsg(this.watchMsg(enable, verbose));
+		enable.if { watchDict[server] = this.prWatch(server, action) };
+	}
+	*watchMsg { arg enable=true, verbose=false;
+		^['/cmd', '/vst_watch', enable.asInteger | (verbose.asInteger << 1)];
+	}
+	*watchPollMsg { ^['/cmd', '/vst_watch_poll']; }
+	*prWatch { arg server, action;
+		// the watcher runs on the Server, so we poll for changes.
+		// events are reported as (len, chars...)+ (see cmdWatchPollDone in VSTPlugin.cpp)
+		var func, routine, dict = pluginDict[server];
+		func = OSCFunc({ arg msg;
+			var onset = 3, len, event, arg1;
+			while { onset < msg.size } {
+				len = msg[onset].asInteger;
+				event = VSTPluginController.msg2string(msg, onset);
+				onset = onset + len + 1;
+				arg1 = event[1..];
+				switch(event[0],
+					$+, {
+						// new or modified plugin
+						this.probe(server, arg1, action: { arg info;
+							info !? { action.value(\add, info) };
+						});
+					},
+					$-, {
+						// removed module: remove all entries which refer to it
+						dict.keys.copy.do { arg key;
+							var path = dict[key].path;
+							((path == arg1) or: { path.beginsWith(arg1 ++ "/") }).if {
+								dict.removeAt(key);
+							}
+						};
+						action.value(\remove, arg1);
+					},
+					$*, {
+						// presets have changed
+						dict[arg1.asSymbol] !? { arg info;
+							info.scanPresets;
+							action.value(\presets, info);
+						}
+					}
+				);
+			};
+		}, '/vst_watch', server.addr, argTemplate: [0, -1]);
+		routine = Routine({
+			loop {
+				server.listSendMsg(this.watchPollMsg);
+				1.wait;
+			}
+		}).play(AppClock);
+		^[func, routine];
+	}
 	*probe { arg server, path, key, wait = -1, action;
 		server = server ?? Server.default;
 		path = path.asString.standardizePath;
@@ -590,6 +683,167 @@ VSTPlugin : MultiOutUGen {
 			});
 		}.forkIfNeeded;
 	}
+	*query { arg server, name, vendor, category, type, flags, prefix=false, wait = -1, action;
+		server = server ?? Server.default;
+		// add dictionary if it doesn't exist yet
+		pluginDict[server].isNil.if { pluginDict[server] = IdentityDictionary.new };
+		server.isLocal.if { this.prQueryLocal(server, name, vendor, category, type, flags, prefix, action) }
+		{ this.prQueryRemote(server, name, vendor, category, type, flags, prefix, wait, action) };
+	}
+	*queryMsg { arg name, vendor, category, type, flags, prefix=false, dest=nil;
+		var mask = 0;
+		// type: nil -> any
+		type = type.notNil.if {
+			switch(type.asString.toLower.asSymbol, \vst2, 0, \vst3, 1,
+				{ ^"bad value for 'type' argument!".throw })
+		} { -1 };
+		// flags: Integer or Array of flag names
+		flags.isInteger.if { mask = flags } {
+			flags.do { arg flag;
+				var bit = #[\hasEditor, \isSynth, \singlePrecision, \doublePrecision,
+					\midiInput, \midiOutput, \sysexInput, \sysexOutput].indexOf(flag.asSymbol);
+				bit ?? { ^"unknown flag '%'".format(flag).throw };
+				mask = mask | (1 << bit);
+			};
+		};
+		dest = this.prMakeDest(dest); // nil -> -1 = don't write results
+		^['/cmd', '/vst_query', prefix.asBoolean.asInteger,
+			(name ? "").asString, (vendor ? "").asString, (category ? "").asString, type, mask, dest];
+	}
+	*prQueryLocal { arg server, name, vendor, category, type, flags, prefix, action;
+		{
+			var stream, results;
+			var tmpPath = this.prMakeTmpPath;
+			// ask VSTPlugin to store the results in a temp file
+			server.listSendMsg(this.queryMsg(name, vendor, category, type, flags, prefix, tmpPath));
+			// wait for cmd to finish
+			server.sync;
+			try {
+				File.use(tmpPath, "rb", { arg file;
+					stream = CollStream.new(file.readAllString);
+				});
+				File.delete(tmpPath).not.if { ("Could not delete tmp file:" + tmpPath).warn };
+			} { "Failed to read tmp file!".error };
+			stream.notNil.if { results = this.prAddQueryResults(server, stream) };
+			action.value(results ?? { [] });
+		}.forkIfNeeded;
+	}
+	*prQueryRemote { arg server, name, vendor, category, type, flags, prefix, wait, action;
+		{
+			var buf = Buffer(server); // get free Buffer
+			// ask VSTPlugin to store the results in this Buffer
+			// (it will allocate the memory for us!)
+			server.listSendMsg(this.queryMsg(name, vendor, category, type, flags, prefix, buf));
+			// wait for cmd to finish and update buffer info
+			server.sync;
+			buf.updateInfo({
+				// now read data from Buffer
+				buf.getToFloatArray(wait: wait, timeout: 5, action: { arg array;
+					var string = array.collectAs({arg c; c.asInteger.asAscii}, String);
+					var results = this.prAddQueryResults(server, CollStream.new(string));
+					buf.free;
+					action.value(results); // done
+				});
+			});
+		}.forkIfNeeded;
+	}
+	*updatePlugins { arg server, wait = -1, action;
+		server = server ?? Server.default;
+		// add dictionary if it doesn't exist yet
+		pluginDict[server].isNil.if { pluginDict[server] = IdentityDictionary.new };
+		server.isLocal.if { this.prUpdateLocal(server, action) }
+		{ this.prUpdateRemote(server, wait, action) };
+	}
+	*changesMsg { arg since, dest=nil;
+		dest = this.prMakeDest(dest); // nil -> -1 = don't write results
+		// the version is a 64-bit number, so we pass it as a String
+		^['/cmd', '/vst_changes', (since ? 0).asString, dest];
+	}
+	*prUpdateLocal { arg server, action;
+		{
+			var stream, result;
+			var tmpPath = this.prMakeTmpPath;
+			// ask VSTPlugin to store the changes in a temp file
+			server.listSendMsg(this.changesMsg(pluginVersion[server], tmpPath));
+			// wait for cmd to finish
+			server.sync;
+			try {
+				File.use(tmpPath, "rb", { arg file;
+					stream = CollStream.new(file.readAllString);
+				});
+				File.delete(tmpPath).not.if { ("Could not delete tmp file:" + tmpPath).warn };
+			} { "Failed to read tmp file!".error };
+			stream.notNil.if { result = this.prApplyChanges(server, stream) };
+			action.value(*(result ?? { [[], []] }));
+		}.forkIfNeeded;
+	}
+	*prUpdateRemote { arg server, wait, action;
+		{
+			var buf = Buffer(server); // get free Buffer
+			// ask VSTPlugin to store the changes in this Buffer
+			// (it will allocate the memory for us!)
+			server.listSendMsg(this.changesMsg(pluginVersion[server], buf));
+			// wait for cmd to finish and update buffer info
+			server.sync;
+			buf.updateInfo({
+				// now read data from Buffer
+				buf.getToFloatArray(wait: wait, timeout: 5, action: { arg array;
+					var string = array.collectAs({arg c; c.asInteger.asAscii}, String);
+					var result = this.prApplyChanges(server, CollStream.new(string));
+					buf.free;
+					action.value(*result); // done
+				});
+			});
+		}.forkIfNeeded;
+	}
+	*prApplyChanges { arg server, stream;
+		var dict = pluginDict[server], line, n, version, reset;
+		var updated = [], removed = [];
+		line = this.prGetLine(stream, true);
+		(line != "[changes]").if { ^Error("missing [changes] header").throw };
+		version = this.prParseKeyValuePair(this.prGetLine(stream, true))[1];
+		reset = this.prParseKeyValuePair(this.prGetLine(stream, true))[1].asInteger.asBoolean;
+		n = this.prParseCount(this.prGetLine(stream, true));
+		reset.if {
+			// the Server sends all plugins
+			dict = IdentityDictionary.new;
+			pluginDict[server] = dict;
+		};
+		n.do {
+			var info, key;
+			line = this.prGetLine(stream, true);
+			switch(line,
+				"[remove]", {
+					key = this.prGetLine(stream).asSymbol;
+					dict.removeAt(key);
+					removed = removed.add(key);
+				},
+				"[add]", {
+					// only a summary (see VSTPluginDesc.partial), so don't
+					// replace a plugin which has already been probed.
+					info = VSTPluginDesc.prParse(stream);
+					dict[info.key] = dict[info.key] ?? info;
+					updated = updated.add(dict[info.key]);
+				},
+				"[modify]", {
+					info = VSTPluginDesc.prParse(stream);
+					dict[info.key] = info;
+					updated = updated.add(info);
+				},
+				{ ^Error("plugin changes: bad data (%)".format(line)).throw }
+			);
+		};
+		pluginVersion[server] = version;
+		^[updated, removed];
+	}
+	*prAddQueryResults { arg server, stream;
+		var dict = pluginDict[server];
+		// the results are only summaries (see VSTPluginDesc.partial), so we don't
+		// scan presets and we don't replace plugins which have already been probed.
+		^this.prParseIni(stream, false).collect { arg info;
+			dict[info.key] ?? { dict[info.key] = info; info };
+		};
+	}
 	*readPlugins {
 		var path, stream, dict = IdentityDictionary.new;
 		// handle 32-bit SuperCollider on Windows (should we care about 32-bit builds on macOS and Linux?)
@@ -665,7 +919,7 @@ VSTPlugin : MultiOutUGen {
 		} { value = "" };
 		^[this.prTrim(key).asSymbol, this.prTrim(value)];
 	}
-	*prParseIni { arg stream;
+	*prParseIni { arg stream, scan=true;
 		var results, onset, line, n, indices, last = 0;
 		// skip header
 		line = this.prGetLine(stream, true);
@@ -676,7 +930,8 @@ VSTPlugin : MultiOutUGen {
 		results = Array.newClear(n);
 		// now serialize plugins
 		n.do { arg i;
-			results[i] = VSTPluginDesc.prParse(stream).scanPresets;
+			results[i] = VSTPluginDesc.prParse(stream);
+			scan.if { results[i].scanPresets };
 		};
 		^results;
 	}
@@ -685,8 +940,18 @@ VSTPlugin : MultiOutUGen {
 		key = key.asSymbol;
 		// if the key already exists, return the info.
 		// otherwise probe the plugin and store it under the given key
-		dict !? { info = dict[key] } !? { action.value(info) }
-		?? { this.probe(server, key, key, wait, action) };
+		dict !? { info = dict[key] };
+		info.notNil.if {
+			info.partial.if {
+				// the search only scanned the metadata, so we have to get the full info
+				this.probe(server, info.key, key, wait, { arg newInfo;
+					newInfo !? {
+						dict.keys.do { arg k; (dict[k] === info).if { dict[k] = newInfo } };
+					};
+					action.value(newInfo);
+				});
+			} { action.value(info) };
+		} { this.probe(server, key, key, wait, action) };
 	}
 	*prMakeTmpPath {
 		^PathName.tmp +/+ "vst_" ++ UniqueID.next;
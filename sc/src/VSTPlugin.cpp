@@ -105,6 +105,16 @@ bool InfoCmdData::nrtFree(World* inWorld, void* cmdData) {
     // free preset data
     std::string dummy;
     std::swap(data->buffer, dummy);
+    // release plugin info (see cmdProbe)
+    data->info = nullptr;
+    return true;
+}
+
+bool QueryCmdData::nrtFree(World* inWorld, void* cmdData) {
+    auto data = (QueryCmdData*)cmdData;
+    // see InfoCmdData::nrtFree()
+    if (data->freeData)
+        NRTFree(data->freeData);
     return true;
 }
 
@@ -141,6 +151,7 @@ int string2floatArray(const std::string& src, float *dest, int maxSize) {
 
 // search and probe
 static std::atomic_bool gSearching {false};
+static std::atomic_bool gCancelSearch {false};
 
 static PluginManager gPluginManager;
 
@@ -148,8 +159,12 @@ static PluginManager gPluginManager;
 // so that 64-bit and 32-bit installations can co-exist!
 #if (defined(_WIN32) && !defined(_WIN64)) || defined(__i386__)
 #define SETTINGS_FILE "cache32.ini"
+#define CACHE_FILE "cache32.bin"
+#define JOURNAL_FILE "cache32.journal"
 #else
 #define SETTINGS_FILE "cache.ini"
+#define CACHE_FILE "cache.bin"
+#define JOURNAL_FILE "cache.journal"
 #endif
 
 static std::string getSettingsDir(){
@@ -163,11 +178,41 @@ static std::string getSettingsDir(){
 static SharedMutex gFileLock;
 
 static void readIniFile(){
-    SharedLock lock(gFileLock);
+    auto dir = getSettingsDir();
+    bool convert = false;
+    {
+        SharedLock lock(gFileLock);
+        // try the binary cache file first
+        try {
+            gPluginManager.readBinary(dir + "/" CACHE_FILE);
+        } catch (const Error& e){
+            LOG_VERBOSE("couldn't read binary cache file: " << e.what());
+            // fall back to the INI file
+            if (pathExists(dir + "/" SETTINGS_FILE)){
+                try {
+                    gPluginManager.read(dir + "/" SETTINGS_FILE);
+                    convert = true;
+                } catch (const Error& e){
+                    LOG_ERROR("couldn't read cache file: " << e.what());
+                }
+            }
+        }
+        // replay changes which haven't been compacted yet
+        try {
+            gPluginManager.readJournal(dir + "/" JOURNAL_FILE);
+        } catch (const Error& e){
+            LOG_ERROR("couldn't read journal file: " << e.what());
+        }
+    }
+    if (!convert){
+        return;
+    }
+    // convert to binary cache file
+    Lock lock(gFileLock);
     try {
-        gPluginManager.read(getSettingsDir() + "/" SETTINGS_FILE);
+        gPluginManager.writeBinary(dir + "/" CACHE_FILE);
     } catch (const Error& e){
-        LOG_ERROR("couldn't read cache file: " << e.what());
+        LOG_ERROR("couldn't write binary cache file: " << e.what());
     }
 }
 
@@ -180,194 +225,46 @@ static void writeIniFile(){
                 throw Error("couldn't create directory");
             }
         }
-        gPluginManager.write(dir + "/" SETTINGS_FILE);
+        // only append the changes to the journal; the cache files are rewritten
+        // in the background once the journal has grown too large.
+        bool compact = !pathExists(dir + "/" CACHE_FILE);
+        try {
+            auto size = gPluginManager.writeJournal(dir + "/" JOURNAL_FILE);
+            if (size > PluginManager::maxJournalSize){
+                compact = true;
+            }
+        } catch (const Error& e){
+            LOG_ERROR("couldn't write journal file: " << e.what());
+            compact = true;
+        }
+        if (compact){
+            gPluginManager.compact(dir + "/" CACHE_FILE, dir + "/" SETTINGS_FILE,
+                                   dir + "/" JOURNAL_FILE);
+        }
     } catch (const Error& e){
         LOG_ERROR("couldn't write settings file: " << e.what());
     }
 }
 
-// VST2: plug-in name
-// VST3: plug-in name + ".vst3"
-static std::string makeKey(const PluginInfo& desc) {
-    std::string key;
-    auto ext = ".vst3";
-    auto onset = std::max<size_t>(0, desc.path.size() - strlen(ext));
-    if (desc.path.find(ext, onset) != std::string::npos) {
-        key = desc.name + ext;
-    }
-    else {
-        key = desc.name;
-    }
-    return key;
-}
-
-void serializePlugin(std::ostream& os, const PluginInfo& desc) {
-    desc.serialize(os);
+void serializePlugin(std::ostream& os, const PluginInfo& desc, bool summary = false) {
+    desc.serialize(os, summary);
     os << "[keys]\n";
     os << "n=1\n";
     os << makeKey(desc) << "\n";
 }
 
-// load factory and probe plugins
-
-static IFactory::ptr loadFactory(const std::string& path, bool verbose = false){
-    IFactory::ptr factory;
-
-    if (gPluginManager.findFactory(path)) {
-        LOG_ERROR("ERROR: bug in 'loadFactory'");
-        return nullptr;
-    }
-    if (gPluginManager.isException(path)) {
-        if (verbose) {
-            Print("'%s' is black-listed.\n", path.c_str());
+// the search engine posts probe results only in verbose mode
+static PluginSearch makeSearch(bool verbose) {
+    return PluginSearch(gPluginManager, [verbose](PluginSearch::LogLevel level, const std::string& msg) {
+        if (level == PluginSearch::LogLevel::Error) {
+            Print("ERROR: %s\n", msg.c_str());
         }
-        return nullptr;
-    }
-    // load factory and probe plugins
-    try {
-        factory = IFactory::load(path);
-    } catch (const Error& e){
-        // always print error
-        Print("ERROR: couldn't load '%s': %s\n", path.c_str(), e.what());
-        gPluginManager.addException(path);
-        return nullptr;
-    }
-
-    return factory;
-}
-
-static void addFactory(const std::string& path, IFactory::ptr factory){
-    if (factory->numPlugins() == 1) {
-        auto plugin = factory->getPlugin(0);
-        // factories with a single plugin can also be aliased by their file path(s)
-        gPluginManager.addPlugin(plugin->path, plugin);
-        gPluginManager.addPlugin(path, plugin);
-    }
-    gPluginManager.addFactory(path, factory);
-    for (int i = 0; i < factory->numPlugins(); ++i) {
-        auto plugin = factory->getPlugin(i);
-    #if 0
-        // search for presets
-        const_cast<PluginInfo&>(*plugin).scanPresets();
-    #endif
-        gPluginManager.addPlugin(makeKey(*plugin), plugin);
-    }
-}
-
-static void postResult(const Error& e){
-    switch (e.code()) {
-    case Error::NoError:
-        Print("ok!\n");
-        break;
-    case Error::Crash:
-        Print("crashed!\n");
-        break;
-    case Error::SystemError:
-        Print("error! %s\n", e.what());
-        break;
-    case Error::ModuleError:
-        Print("couldn't load! %s\n", e.what());
-        break;
-    case Error::PluginError:
-        Print("failed! %s\n", e.what());
-        break;
-    default:
-        Print("unexpected error! %s\n", e.what());
-        break;
-    }
-}
-
-static IFactory::ptr probePlugin(const std::string& path, bool verbose) {
-    auto factory = loadFactory(path, verbose);
-    if (!factory){
-        return nullptr;
-    }
-
-    if (verbose) Print("probing %s... ", path.c_str());
-
-    try {
-        factory->probe([&](const ProbeResult& result) {
-            if (verbose) {
-                if (result.total > 1) {
-                    if (result.index == 0) {
-                        Print("\n");
-                    }
-                    Print("\t[%d/%d] ", result.index + 1, result.total);
-                    if (result.plugin && !result.plugin->name.empty()) {
-                        Print("'%s' ... ", result.plugin->name.c_str());
-                    } else {
-                        Print("... ");
-                    }
-                }
-                postResult(result.error);
-            }
-        });
-        if (factory->valid()){
-            addFactory(path, factory);
-            return factory; // success
+        else if (level == PluginSearch::LogLevel::Normal || verbose) {
+            Print("%s\n", msg.c_str());
         }
-    } catch (const Error& e){
-        if (verbose) postResult(e);
-    }
-    gPluginManager.addException(path);
-    return nullptr;
-}
-
-using FactoryFuture = std::function<IFactory::ptr()>;
-
-static FactoryFuture probePluginParallel(const std::string& path, bool verbose) {
-    auto factory = loadFactory(path, verbose);
-    if (!factory){
-        return []() { return nullptr; };
-    }
-    // start probing process
-    try {
-        auto future = factory->probeAsync();
-        // return future
-        return [=]() -> IFactory::ptr {
-            if (verbose) Print("probing %s... ", path.c_str());
-
-            // wait for results
-            future([&](const ProbeResult& result) {
-                if (verbose) {
-                    if (result.total > 1) {
-                        if (result.index == 0) {
-                            Print("\n");
-                        }
-                        Print("\t[%d/%d] ", result.index + 1, result.total);
-                        if (result.plugin && !result.plugin->name.empty()) {
-                            Print("'%s' ... ", result.plugin->name.c_str());
-                        } else {
-                            Print("... ");
-                        }
-                    }
-                    postResult(result.error);
-                }
-            });
-            // collect results
-            if (factory->valid()){
-                addFactory(path, factory);
-                return factory; // success
-            } else {
-                gPluginManager.addException(path);
-                return nullptr;
-            }
-        };
-    }
-    catch (const Error& e) {
-        // return future which prints the error message
-        return [=]() -> IFactory::ptr {
-            if (verbose) {
-                Print("probing %s... ", path.c_str());
-                postResult(e);
-            }
-            gPluginManager.addException(path);
-            return nullptr;
-        };
-    }
+    });
 }
 
-
 static bool isAbsolutePath(const std::string& path) {
     if (!path.empty() &&
         (path[0] == '/' || path[0] == '~' // Unix
@@ -403,8 +300,30 @@ static std::string resolvePath(std::string path) {
     return std::string{}; // fail
 }
 
+// The search only scans the plugin metadata; the parameters and programs
+// are probed when the plugin is used for the first time.
+static PluginInfo::const_ptr completePlugin(PluginInfo::const_ptr desc) {
+    std::stringstream ss;
+    ss << "probing '" << desc->name << "'... ";
+    ProbeResult result;
+    try {
+        desc = gPluginManager.probeFull(desc);
+    } catch (const Error& e) {
+        result.error = e;
+        desc = nullptr;
+    }
+    PluginSearch::formatResult(ss, result);
+    Print("%s\n", ss.str().c_str());
+    if (desc) {
+        writeIniFile();
+    }
+    return desc;
+}
+
 // query a plugin by its key or file path and probe if necessary.
-static const PluginInfo* queryPlugin(std::string path) {
+// NB: the plugin description might be replaced in the plugin manager at any time
+// (e.g. by completePlugin() or the watcher), so the caller must hold on to the result.
+static PluginInfo::const_ptr queryPlugin(std::string path) {
 #ifdef _WIN32
     for (auto& c : path) {
         if (c == '\\') c = '/';
@@ -420,7 +339,7 @@ static const PluginInfo* queryPlugin(std::string path) {
                     "nor a valid file path.\n", path.c_str());
         } else if (!(desc = gPluginManager.findPlugin(absPath))){
             // finally probe plugin
-            if (probePlugin(absPath, true)) {
+            if (makeSearch(true).probe(absPath)) {
                 desc = gPluginManager.findPlugin(absPath);
                 // findPlugin() fails if the module contains several plugins,
                 // which means the path can't be used as a key.
@@ -432,90 +351,10 @@ static const PluginInfo* queryPlugin(std::string path) {
             }
         }
     }
-    return desc.get();
-}
-
-#define PROBE_PROCESSES 8
-
-std::vector<PluginInfo::const_ptr> searchPlugins(const std::string & path,
-                                                 bool parallel, bool verbose) {
-    Print("searching in '%s'...\n", path.c_str());
-    std::vector<PluginInfo::const_ptr> results;
-
-    auto addPlugin = [&](const PluginInfo::const_ptr& plugin, int which = 0, int n = 0){
-        if (verbose && n > 0) {
-            Print("\t[%d/%d] %s\n", which + 1, n, plugin->name.c_str());
-        }
-        results.push_back(plugin);
-    };
-
-    std::vector<FactoryFuture> futures;
-
-    auto processFutures = [&](){
-        for (auto& f : futures){
-            auto factory = f();
-            if (factory){
-                int numPlugins = factory->numPlugins();
-                for (int i = 0; i < numPlugins; ++i){
-                    addPlugin(factory->getPlugin(i));
-                }
-            }
-        }
-        futures.clear();
-    };
-
-    vst::search(path, [&](const std::string & absPath) {
-        if (!gSearching){
-            return;
-        }
-        std::string pluginPath = absPath;
-#ifdef _WIN32
-        for (auto& c : pluginPath) {
-            if (c == '\\') c = '/';
-        }
-#endif
-        // check if module has already been loaded
-        auto factory = gPluginManager.findFactory(pluginPath);
-        if (factory) {
-            // just post names of valid plugins
-            if (verbose) Print("%s\n", pluginPath.c_str());
-            auto numPlugins = factory->numPlugins();
-            if (numPlugins == 1) {
-                addPlugin(factory->getPlugin(0));
-            }
-            else {
-                for (int i = 0; i < numPlugins; ++i) {
-                    // add and post plugins
-                    addPlugin(factory->getPlugin(i), i, numPlugins);
-                }
-            }
-        }
-        else {
-            // probe (will post results and add plugins)
-            if (parallel){
-                futures.push_back(probePluginParallel(pluginPath, verbose));
-                if (futures.size() >= PROBE_PROCESSES){
-                    processFutures();
-                }
-            } else {
-                if ((factory = probePlugin(pluginPath, verbose))) {
-                    int numPlugins = factory->numPlugins();
-                    for (int i = 0; i < numPlugins; ++i) {
-                        addPlugin(factory->getPlugin(i));
-                    }
-                }
-            }
-        }
-    });
-    processFutures();
-
-    int numResults = results.size();
-    if (numResults == 1){
-        Print("found 1 plugin\n");
-    } else {
-        Print("found %d plugins\n", numResults);
+    if (desc && desc->isPartial()) {
+        desc = completePlugin(desc);
     }
-    return results;
+    return desc;
 }
 
 // -------------------- VSTPlugin ------------------------ //
@@ -875,7 +714,14 @@ void VSTPlugin::next(int inNumSamples) {
         data.numAuxOutputs = numAuxOutChannels();
         data.auxOutput = data.numAuxOutputs > 0 ? mOutBuf + numOutChannels() : nullptr;
         data.numSamples = inNumSamples;
+        dspLoad_.begin();
         plugin->process(data);
+        dspLoad_.end(inNumSamples, sampleRate());
+
+        int dropped = plugin->takeNumDroppedEvents();
+        if (dropped > 0) {
+            delegate_->droppedEvents(dropped);
+        }
 
     #if HAVE_UI_THREAD
         // send parameter automation notification posted from the GUI thread [or NRT thread]
@@ -964,6 +810,35 @@ void VSTPluginDelegate::parameterAutomated(int index, float value) {
 #endif
 }
 
+void VSTPluginDelegate::droppedEvents(int n) {
+    numDroppedEvents_ += n;
+    if (!droppedPending_) {
+        reportDroppedEvents();
+    }
+}
+
+void VSTPluginDelegate::reportDroppedEvents() {
+    auto cmdData = PluginCmdData::create(world());
+    if (cmdData) {
+        cmdData->value = numDroppedEvents_;
+        numDroppedEvents_ = 0;
+        droppedPending_ = true;
+        doCmd(cmdData, [](World *world, void *inData) {
+            auto data = (PluginCmdData *)inData;
+            LOG_WARNING("VSTPlugin: event queue full, dropped " << data->value << " event(s)");
+            return true; // continue
+        }, [](World *world, void *inData) {
+            // back on the RT thread; events might have been dropped in the meantime
+            auto data = (PluginCmdData *)inData;
+            data->owner->droppedPending_ = false;
+            if (data->owner->numDroppedEvents_ > 0) {
+                data->owner->reportDroppedEvents();
+            }
+            return false; // done
+        });
+    }
+}
+
 void VSTPluginDelegate::midiEvent(const MidiEvent& midi) {
 #if HAVE_UI_THREAD
     // check if we're on the realtime thread, otherwise ignore it
@@ -1067,12 +942,15 @@ void VSTPluginDelegate::close() {
     }
 }
 
+static void watchPresetFolders(const PluginInfo& info);
+
 bool cmdOpen(World *world, void* cmdData) {
     LOG_DEBUG("cmdOpen");
     // initialize GUI backend (if needed)
     auto data = (PluginCmdData *)cmdData;
     data->threadID = std::this_thread::get_id();
     // create plugin in main thread
+    // NB: 'info' keeps the plugin description alive, afterwards the plugin holds a reference.
     auto info = queryPlugin(data->buf);
     if (info) {
         try {
@@ -1097,6 +975,7 @@ bool cmdOpen(World *world, void* cmdData) {
                                    owner->numAuxInChannels(), owner->numAuxOutChannels());
             plugin->resume();
             data->plugin = std::move(plugin);
+            watchPresetFolders(*info);
         }
         catch (const Error & e) {
             LOG_ERROR(e.what());
@@ -2109,15 +1988,109 @@ void vst_vendor_method(VSTPlugin* unit, sc_msg_iter *args) {
 
 /*** plugin command callbacks ***/
 
+// The search runs on its own thread, so it doesn't block the NRT thread (and with it
+// all other asynchronous commands) for a possibly long time. Found plugins are reported
+// in the order of completion; the Client fetches them with /vst_search_poll (see cmdSearchPoll),
+// which also tells when the search has finished. gSearchState is only accessed in the NRT thread.
+struct SearchState {
+    ~SearchState();
+    void run();
+
+    std::vector<std::string> searchPaths;
+    std::string path; // result file
+    int32 bufnum = -1; // result buffer
+    bool verbose = false;
+    bool save = false;
+    bool parallel = false;
+    float timeout = -1;
+    int concurrency = -1;
+    std::thread thread;
+    std::vector<PluginInfo::const_ptr> plugins; // all results
+    // shared with the search thread:
+    std::mutex mutex;
+    std::vector<std::string> progress; // keys of new plugins
+    bool finished = false;
+};
+
+static std::unique_ptr<SearchState> gSearchState;
+
+#define SEARCH_POLL_LIMIT 1024 // max. number of plugins per /vst_search_poll
+
+SearchState::~SearchState() {
+    if (thread.joinable()) {
+        gCancelSearch = true;
+        thread.join();
+    }
+}
+
+static void writeSearchResults(std::ostream& os, const std::vector<PluginInfo::const_ptr>& plugins) {
+    os << "[plugins]\n";
+    os << "n=" << plugins.size() << "\n";
+    for (auto& plugin : plugins) {
+        serializePlugin(os, *plugin);
+    }
+}
+
+static void writeSearchBuffer(World *inWorld, int32 bufnum,
+                              const std::vector<PluginInfo::const_ptr>& plugins, void*& freeData) {
+    auto buf = World_GetNRTBuf(inWorld, bufnum);
+    freeData = buf->data; // to be freed in stage 4
+    std::stringstream ss;
+    LOG_DEBUG("writing plugin info to buffer");
+    writeSearchResults(ss, plugins);
+    allocReadBuffer(buf, ss.str());
+}
+
+void SearchState::run() {
+    // optional probe timeout and number of parallel probes for this search
+    ProbeOptions options;
+    options.timeout = timeout;
+    options.concurrency = concurrency;
+    // search for plugins
+    makeSearch(verbose).search(searchPaths, parallel, [&](const PluginInfo::const_ptr& plugin) {
+        plugins.push_back(plugin);
+        std::lock_guard<std::mutex> lock(mutex);
+        progress.push_back(makeKey(*plugin));
+    }, &gCancelSearch, options);
+    if (gCancelSearch) {
+        LOG_DEBUG("search cancelled"); // don't update cache file
+    } else if (save) {
+        writeIniFile();
+    }
+    // write new info to file (only for local Servers).
+    // buffers are written in the NRT thread, see cmdSearchPoll()
+    if (!path.empty()) {
+        std::ofstream file(path, std::ios_base::binary | std::ios_base::trunc);
+        if (file.is_open()) {
+            LOG_DEBUG("writing plugin info to file");
+            writeSearchResults(file, plugins);
+        }
+        else {
+            LOG_ERROR("couldn't write plugin info file '" << path << "'!");
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+    gSearching = false;
+}
+
 // recursively search directories for VST plugins.
 bool cmdSearch(World *inWorld, void* cmdData) {
     auto data = (InfoCmdData *)cmdData;
-    std::vector<PluginInfo::const_ptr> plugins;
+    // the results of the previous search haven't been fetched
+    gSearchState.reset();
+
+    std::unique_ptr<SearchState> state(new SearchState);
     bool useDefault = data->flags & SearchFlags::useDefault;
-    bool verbose = data->flags & SearchFlags::verbose;
-    bool save = data->flags & SearchFlags::save;
-    bool parallel = data->flags & SearchFlags::parallel;
-    std::vector<std::string> searchPaths;
+    state->verbose = data->flags & SearchFlags::verbose;
+    state->save = data->flags & SearchFlags::save;
+    state->parallel = data->flags & SearchFlags::parallel;
+    state->timeout = data->timeout;
+    state->concurrency = data->concurrency;
+    state->path = data->path;
+    state->bufnum = data->bufnum;
     auto size = data->size;
     auto ptr = data->buf;
     auto onset = ptr;
@@ -2125,70 +2098,118 @@ bool cmdSearch(World *inWorld, void* cmdData) {
     while (size--) {
         if (*ptr++ == '\0') {
             auto diff = ptr - onset;
-            searchPaths.emplace_back(onset, diff - 1); // don't store '\0'!
+            state->searchPaths.emplace_back(onset, diff - 1); // don't store '\0'!
             onset = ptr;
         }
     }
     // use default search paths?
     if (useDefault) {
         for (auto& path : getDefaultSearchPaths()) {
-            searchPaths.push_back(path);
+            state->searchPaths.push_back(path);
         }
     }
-    // search for plugins
-    for (auto& path : searchPaths) {
-        if (gSearching){
-            auto result = searchPlugins(path, parallel, verbose);
-            plugins.insert(plugins.end(), result.begin(), result.end());
-        } else {
-            save = false; // don't update cache file
-            LOG_DEBUG("search cancelled");
-            break;
+    gCancelSearch = false;
+    if (!inWorld->mRealTime) {
+        // NRT synthesis: nobody is going to poll, so we just search synchronously.
+        state->run();
+        if (state->bufnum >= 0) {
+            writeSearchBuffer(inWorld, state->bufnum, state->plugins, data->freeData);
         }
+        return true;
     }
-    if (save){
-        writeIniFile();
+    data->bufnum = -1; // written in cmdSearchPoll()
+    try {
+        state->thread = std::thread(&SearchState::run, state.get());
+    } catch (const std::system_error& e) {
+        LOG_ERROR("couldn't start search thread: " << e.what());
+        gSearching = false;
+        return false;
     }
-    // write new info to file (only for local Servers) or buffer
-    if (data->path[0]) {
-        // write to file
-        std::ofstream file(data->path, std::ios_base::binary | std::ios_base::trunc);
-        if (file.is_open()) {
-            LOG_DEBUG("writing plugin info to file");
-            file << "[plugins]\n";
-            file << "n=" << plugins.size() << "\n";
-            for (auto& plugin : plugins) {
-                serializePlugin(file, *plugin);
-            }
+    gSearchState = std::move(state);
+    return true;
+}
+
+bool cmdSearchDone(World *inWorld, void *cmdData) {
+    auto data = (InfoCmdData*)cmdData;
+    if (data->bufnum >= 0)
+        syncBuffer(inWorld, data->bufnum);
+    // LOG_DEBUG("search started!");
+    return true;
+}
+
+// fetch new plugins and check if the search has finished
+bool cmdSearchPoll(World *inWorld, void *cmdData) {
+    auto data = (SearchPollCmdData *)cmdData;
+    auto state = gSearchState.get();
+    if (!state) {
+        data->numPlugins = 0; // not searching
+        return true;
+    }
+    bool finished;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        auto& progress = state->progress;
+        if (progress.size() > SEARCH_POLL_LIMIT) {
+            auto end = progress.begin() + SEARCH_POLL_LIMIT;
+            data->plugins.assign(std::make_move_iterator(progress.begin()),
+                                 std::make_move_iterator(end));
+            progress.erase(progress.begin(), end);
+        } else {
+            data->plugins.swap(progress);
         }
-        else {
-            LOG_ERROR("couldn't write plugin info file '" << data->path << "'!");
+        finished = state->finished && progress.empty();
+    }
+    if (finished) {
+        state->thread.join();
+        if (state->bufnum >= 0) {
+            writeSearchBuffer(inWorld, state->bufnum, state->plugins, data->freeData);
+            data->bufnum = state->bufnum;
         }
+        data->numPlugins = state->plugins.size();
+        gSearchState.reset();
     }
-    else if (data->bufnum >= 0) {
-        // write to buffer
-        auto buf = World_GetNRTBuf(inWorld, data->bufnum);
-        data->freeData = buf->data; // to be freed in stage 4
-        std::stringstream ss;
-        LOG_DEBUG("writing plugin info to buffer");
-        ss << "[plugins]\n";
-        ss << "n=" << plugins.size() << "\n";
-        for (auto& plugin : plugins) {
-            serializePlugin(ss, *plugin);
+    return true;
+}
+
+// Node replies need a Node, so we just take the root group (mNode is its first member).
+// msg format: (len, chars...)+ - several strings are packed into a single message.
+static void sendStrings(World *inWorld, const char *cmd, const std::vector<std::string>& strings) {
+    auto node = reinterpret_cast<Node *>(inWorld->mTopGroup);
+    const int maxSize = MAX_OSC_PACKET_SIZE / sizeof(float) - 8; // leave room for the header
+    float buf[maxSize];
+    int size = 0;
+    for (auto& s : strings) {
+        if (size > 0 && (size + (int)s.size() + 1) > maxSize) {
+            SendNodeReply(node, -1, cmd, size, buf);
+            size = 0;
         }
-        allocReadBuffer(buf, ss.str());
+        size += string2floatArray(s, buf + size, maxSize - size);
+    }
+    if (size > 0) {
+        SendNodeReply(node, -1, cmd, size, buf);
     }
-    // else do nothing
+}
 
+bool cmdSearchPollDone(World *inWorld, void *cmdData) {
+    auto data = (SearchPollCmdData *)cmdData;
+    sendStrings(inWorld, "/vst_search_progress", data->plugins);
+    if (data->numPlugins >= 0) {
+        auto node = reinterpret_cast<Node *>(inWorld->mTopGroup);
+        if (data->bufnum >= 0)
+            syncBuffer(inWorld, data->bufnum);
+        float numPlugins = data->numPlugins;
+        SendNodeReply(node, -1, "/vst_search_done", 1, &numPlugins);
+    }
     return true;
 }
 
-bool cmdSearchDone(World *inWorld, void *cmdData) {
-    auto data = (InfoCmdData*)cmdData;
-    if (data->bufnum >= 0)
-        syncBuffer(inWorld, data->bufnum);
-    gSearching = false;
-    // LOG_DEBUG("search done!");
+bool SearchPollCmdData::nrtFree(World* inWorld, void* cmdData) {
+    auto data = (SearchPollCmdData*)cmdData;
+    // see InfoCmdData::nrtFree
+    if (data->freeData)
+        NRTFree(data->freeData);
+    std::vector<std::string> dummy;
+    std::swap(data->plugins, dummy);
     return true;
 }
 
@@ -2212,6 +2233,16 @@ void vst_search(World *inWorld, void* inUserData, struct sc_msg_iter *args, void
             return;
         }
     }
+    // optional probe timeout (in seconds)
+    float timeout = -1;
+    if (args->nextTag() == 'f' || args->nextTag() == 'i') {
+        timeout = args->getf();
+    }
+    // optional number of parallel probes (0: automatic)
+    int concurrency = -1;
+    if (args->nextTag() == 'f' || args->nextTag() == 'i') {
+        concurrency = args->geti();
+    }
     // collect optional search paths
     std::pair<const char *, size_t> paths[64];
     int numPaths = 0;
@@ -2231,6 +2262,8 @@ void vst_search(World *inWorld, void* inUserData, struct sc_msg_iter *args, void
     if (data) {
         data->flags = flags;
         data->bufnum = bufnum; // negative bufnum: don't write search result
+        data->timeout = timeout;
+        data->concurrency = concurrency;
         if (filename) {
             snprintf(data->path, sizeof(data->path), "%s", filename);
         }
@@ -2254,7 +2287,207 @@ void vst_search(World *inWorld, void* inUserData, struct sc_msg_iter *args, void
 }
 
 void vst_search_stop(World* inWorld, void* inUserData, struct sc_msg_iter*args, void* replyAddr) {
-    gSearching = false;
+    gCancelSearch = true;
+}
+
+void vst_search_poll(World* inWorld, void* inUserData, struct sc_msg_iter*args, void* replyAddr) {
+    auto data = CmdData::create<SearchPollCmdData>(inWorld);
+    if (data) {
+        DoAsynchronousCommand(inWorld, replyAddr, 0, data, cmdSearchPoll, cmdSearchPollDone,
+            SearchPollCmdData::nrtFree, cmdRTfree<SearchPollCmdData>, 0, 0);
+    }
+}
+
+// The watcher (if supported on the platform) observes the default search paths and the
+// preset folders of opened plugins. Changed modules are probed on the watcher thread and
+// the results are queued as events: "+<key>" (new plugin), "-<path>" (removed module)
+// and "*<key>" (presets have changed). The Server can't send replies from a foreign thread,
+// so the Client fetches the events with /vst_watch_poll (see cmdWatchPoll), which is cheap
+// and doesn't touch the file system. gWatcher is only accessed in the NRT thread.
+static DirectoryWatcher::ptr gWatcher;
+static std::atomic_bool gWatchVerbose {false};
+static std::mutex gWatchMutex;
+static std::vector<std::string> gWatchEvents; // pending events
+static std::unordered_map<std::string, std::string> gPresetFolders; // folder -> plugin key
+
+static bool isInFolder(const std::string& path, const std::string& folder) {
+    return !path.compare(0, folder.size(), folder) && (path.size() == folder.size()
+        || path[folder.size()] == '/' || path[folder.size()] == '\\');
+}
+
+static void watchPresetFolders(const PluginInfo& info) {
+    if (!gWatcher) {
+        return;
+    }
+    auto key = makeKey(info);
+    for (auto type : { PresetType::User, PresetType::UserFactory,
+                       PresetType::SharedFactory, PresetType::Global }) {
+        auto folder = info.getPresetFolder(type);
+        if (!folder.empty()) {
+            std::lock_guard<std::mutex> lock(gWatchMutex);
+            if (gPresetFolders.emplace(folder, key).second) {
+                gWatcher->watch(folder);
+            }
+        }
+    }
+}
+
+// called on the watcher thread
+static void watchCallback(const std::vector<std::string>& paths) {
+    auto search = makeSearch(gWatchVerbose);
+    std::vector<std::string> events;
+    std::unordered_set<std::string> modules;
+    for (auto& path : paths) {
+        // preset folders
+        bool preset = false;
+        {
+            std::lock_guard<std::mutex> lock(gWatchMutex);
+            for (auto& it : gPresetFolders) {
+                if (isInFolder(path, it.first)) {
+                    events.push_back("*" + it.second);
+                    preset = true;
+                }
+            }
+        }
+        if (preset) {
+            continue;
+        }
+        auto module = getModulePath(path);
+        if (!module.empty()) {
+            modules.insert(module);
+        } else if (isDirectory(path)) {
+            // new directory or rescan (e.g. after an event queue overflow)
+            vst::search(path, [&](const std::string& p) {
+                modules.insert(p);
+            });
+            for (auto& m : gPluginManager.removeModules(path, true)) {
+                events.push_back("-" + m);
+            }
+        } else if (!pathExists(path)) {
+            // removed directory
+            for (auto& m : gPluginManager.removeModules(path)) {
+                events.push_back("-" + m);
+            }
+        }
+    }
+    bool changed = false;
+    for (auto& module : modules) {
+        if (!pathExists(module)) {
+            for (auto& m : gPluginManager.removeModules(module)) {
+                events.push_back("-" + m);
+                changed = true;
+            }
+            continue;
+        }
+        if (gPluginManager.checkModule(module)) {
+            events.push_back("-" + module);
+            changed = true;
+        }
+        if (!gPluginManager.findFactory(module) && !gPluginManager.isException(module)) {
+            auto factory = gPluginManager.findDuplicate(module);
+            if (factory) {
+                search.addFactory(module, factory);
+            } else {
+                factory = search.probe(module, true);
+            }
+            if (factory) {
+                for (int i = 0; i < factory->numPlugins(); ++i) {
+                    events.push_back("+" + makeKey(*factory->getPlugin(i)));
+                }
+            }
+            changed = true;
+        }
+    }
+    if (changed) {
+        writeIniFile();
+    }
+    if (!events.empty()) {
+        std::lock_guard<std::mutex> lock(gWatchMutex);
+        gWatchEvents.insert(gWatchEvents.end(), events.begin(), events.end());
+    }
+}
+
+// start/stop watching the default search paths
+bool cmdWatch(World *inWorld, void* cmdData) {
+    auto data = (InfoCmdData *)cmdData;
+    bool enable = data->flags & 1;
+    gWatchVerbose = data->flags & 2;
+    if (enable && !gWatcher) {
+        try {
+            gWatcher = DirectoryWatcher::create(watchCallback);
+        } catch (const Error& e) {
+            LOG_ERROR("couldn't start watcher: " << e.what());
+            return false;
+        }
+        if (!gWatcher) {
+            LOG_WARNING("watching plugin folders is not supported on this platform");
+            return false;
+        }
+        for (auto& path : getDefaultSearchPaths()) {
+            gWatcher->watch(path);
+        }
+    } else if (!enable && gWatcher) {
+        {
+            std::lock_guard<std::mutex> lock(gWatchMutex);
+            gWatchEvents.clear();
+            gPresetFolders.clear();
+        }
+        // The destructor joins the watcher thread, which might be busy probing plugins,
+        // so we destroy the watcher on a helper thread instead of blocking the NRT thread.
+        // Events which are still reported in the meantime are harmless.
+        auto watcher = gWatcher.release();
+        try {
+            std::thread([watcher]() {
+                delete watcher;
+            }).detach();
+        } catch (const std::system_error& e) {
+            LOG_ERROR("couldn't start thread: " << e.what());
+            // leak the watcher (like the Pd external does) rather than blocking
+        }
+    }
+    return false;
+}
+
+// fetch pending watcher events
+bool cmdWatchPoll(World *inWorld, void *cmdData) {
+    auto data = (SearchPollCmdData *)cmdData;
+    std::lock_guard<std::mutex> lock(gWatchMutex);
+    if (gWatchEvents.size() > SEARCH_POLL_LIMIT) {
+        auto end = gWatchEvents.begin() + SEARCH_POLL_LIMIT;
+        data->plugins.assign(std::make_move_iterator(gWatchEvents.begin()),
+                             std::make_move_iterator(end));
+        gWatchEvents.erase(gWatchEvents.begin(), end);
+    } else {
+        data->plugins.swap(gWatchEvents);
+    }
+    return true;
+}
+
+bool cmdWatchPollDone(World *inWorld, void *cmdData) {
+    auto data = (SearchPollCmdData *)cmdData;
+    sendStrings(inWorld, "/vst_watch", data->plugins);
+    return true;
+}
+
+void vst_watch(World* inWorld, void* inUserData, struct sc_msg_iter* args, void* replyAddr) {
+    if (!inWorld->mRealTime) {
+        LOG_WARNING("vst_watch: not supported in NRT synthesis");
+        return;
+    }
+    auto data = CmdData::create<InfoCmdData>(inWorld);
+    if (data) {
+        data->flags = args->geti(); // 1 = enable, 2 = verbose
+        DoAsynchronousCommand(inWorld, replyAddr, "vst_watch",
+            data, cmdWatch, 0, 0, cmdRTfree, 0, 0);
+    }
+}
+
+void vst_watch_poll(World* inWorld, void* inUserData, struct sc_msg_iter*args, void* replyAddr) {
+    auto data = CmdData::create<SearchPollCmdData>(inWorld);
+    if (data) {
+        DoAsynchronousCommand(inWorld, replyAddr, 0, data, cmdWatchPoll, cmdWatchPollDone,
+            SearchPollCmdData::nrtFree, cmdRTfree<SearchPollCmdData>, 0, 0);
+    }
 }
 
 void vst_clear(World* inWorld, void* inUserData, struct sc_msg_iter* args, void* replyAddr) {
@@ -2265,9 +2498,12 @@ void vst_clear(World* inWorld, void* inUserData, struct sc_msg_iter* args, void*
             DoAsynchronousCommand(inWorld, replyAddr, "vst_clear", data, [](World*, void* data) {
                 // unloading plugins might crash, so we make sure we *first* delete the cache file
                 int flags = static_cast<InfoCmdData*>(data)->flags;
+                Lock lock(gFileLock); // wait for readIniFile()
                 if (flags & 1) {
                     // remove cache file
                     removeFile(getSettingsDir() + "/" SETTINGS_FILE);
+                    removeFile(getSettingsDir() + "/" CACHE_FILE);
+                    removeFile(getSettingsDir() + "/" JOURNAL_FILE);
                 }
                 gPluginManager.clear();
                 return false;
@@ -2282,7 +2518,8 @@ void vst_clear(World* inWorld, void* inUserData, struct sc_msg_iter* args, void*
 // query plugin info
 bool cmdProbe(World *inWorld, void *cmdData) {
     auto data = (InfoCmdData *)cmdData;
-    auto desc = queryPlugin(data->buf);
+    data->info = queryPlugin(data->buf); // released in nrtFree()
+    auto desc = data->info.get();
     // write info to file or buffer
     if (desc){
         if (data->path[0]) {
@@ -2355,6 +2592,195 @@ void vst_probe(World *inWorld, void* inUserData, struct sc_msg_iter *args, void
     }
 }
 
+// query the plugin database; only returns plugin summaries (see PluginManager::query())
+bool cmdQuery(World *inWorld, void *cmdData) {
+    auto data = (QueryCmdData *)cmdData;
+    PluginIndex::Query query;
+    auto ptr = data->buf;
+    query.name = ptr;
+    ptr += query.name.size() + 1;
+    query.vendor = ptr;
+    ptr += query.vendor.size() + 1;
+    query.category = ptr;
+    query.match = (data->flags & QueryFlags::prefix) ?
+        PluginIndex::Match::Prefix : PluginIndex::Match::Substring;
+    query.type = data->type;
+    query.flags = data->pluginFlags;
+    auto plugins = gPluginManager.query(query);
+    LOG_DEBUG("query: " << plugins.size() << " plugins");
+    std::stringstream ss;
+    ss << "[plugins]\n";
+    ss << "n=" << plugins.size() << "\n";
+    for (auto& plugin : plugins) {
+        serializePlugin(ss, *plugin, true);
+    }
+    // write results to file or buffer
+    if (data->path[0]) {
+        std::ofstream file(data->path, std::ios_base::binary | std::ios_base::trunc);
+        if (file.is_open()) {
+            file << ss.str();
+        }
+        else {
+            LOG_ERROR("couldn't write plugin info file '" << data->path << "'!");
+        }
+    }
+    else if (data->bufnum >= 0) {
+        auto buf = World_GetNRTBuf(inWorld, data->bufnum);
+        data->freeData = buf->data; // to be freed in stage 4
+        allocReadBuffer(buf, ss.str());
+    }
+    return true;
+}
+
+bool cmdQueryDone(World* inWorld, void* cmdData) {
+    auto data = (QueryCmdData*)cmdData;
+    if (data->bufnum >= 0)
+        syncBuffer(inWorld, data->bufnum);
+    return true;
+}
+
+void vst_query(World *inWorld, void* inUserData, struct sc_msg_iter *args, void *replyAddr) {
+    // flags (prefix match)
+    int flags = args->geti();
+    // name, vendor and category (empty strings match everything)
+    const char* strings[3];
+    size_t size = 0;
+    for (auto& s : strings) {
+        s = args->gets("");
+        size += strlen(s) + 1; // include terminating '\0'
+    }
+    // plugin type (-1: any) and required plugin flags
+    int type = args->geti(-1);
+    int pluginFlags = args->geti();
+
+    // temp file or buffer to store the results
+    int32 bufnum = -1;
+    const char* filename = nullptr;
+    if (args->nextTag() == 's') {
+        filename = args->gets();
+    }
+    else {
+        bufnum = args->geti(-1);
+        if (bufnum >= inWorld->mNumSndBufs) {
+            LOG_ERROR("vst_query: bufnum " << bufnum << " out of range");
+            return;
+        }
+    }
+
+    auto data = CmdData::create<QueryCmdData>(inWorld, size);
+    if (data) {
+        data->flags = flags;
+        data->type = type;
+        data->pluginFlags = pluginFlags;
+        data->bufnum = bufnum; // negative bufnum: don't write results
+        if (filename) {
+            snprintf(data->path, sizeof(data->path), "%s", filename);
+        }
+        else {
+            data->path[0] = '\0';
+        }
+        // copy strings into a single buffer (separated by '\0')
+        data->size = size;
+        auto ptr = data->buf;
+        for (auto& s : strings) {
+            auto len = strlen(s) + 1;
+            memcpy(ptr, s, len);
+            ptr += len;
+        }
+        DoAsynchronousCommand(inWorld, replyAddr, "vst_query",
+            data, cmdQuery, cmdQueryDone, QueryCmdData::nrtFree, cmdRTfree, 0, 0);
+    }
+}
+
+// get the changes of the plugin database since a given version (see PluginManager::changes()).
+// the version is passed as a string because it doesn't fit into an OSC int32.
+bool cmdChanges(World *inWorld, void *cmdData) {
+    auto data = (InfoCmdData *)cmdData;
+    uint64_t since = strtoull(data->buf, nullptr, 10);
+    std::vector<PluginManager::Change> changes;
+    bool reset = false;
+    auto version = gPluginManager.changes(since, changes, reset);
+    LOG_DEBUG("changes since " << since << ": " << changes.size() << (reset ? " (reset)" : ""));
+    std::stringstream ss;
+    ss << "[changes]\n";
+    ss << "version=" << version << "\n";
+    ss << "reset=" << reset << "\n";
+    ss << "n=" << changes.size() << "\n";
+    for (auto& change : changes) {
+        switch (change.op) {
+        case PluginManager::Change::Add:
+            ss << "[add]\n";
+            break;
+        case PluginManager::Change::Modify:
+            ss << "[modify]\n";
+            break;
+        default:
+            ss << "[remove]\n" << change.key << "\n";
+            continue;
+        }
+        // only the summary; the full description is fetched with /vst_probe
+        change.plugin->serialize(ss, true);
+        ss << "[keys]\n";
+        ss << "n=1\n";
+        ss << change.key << "\n";
+    }
+    // write results to file or buffer
+    if (data->path[0]) {
+        std::ofstream file(data->path, std::ios_base::binary | std::ios_base::trunc);
+        if (file.is_open()) {
+            file << ss.str();
+        }
+        else {
+            LOG_ERROR("couldn't write plugin info file '" << data->path << "'!");
+        }
+    }
+    else if (data->bufnum >= 0) {
+        auto buf = World_GetNRTBuf(inWorld, data->bufnum);
+        data->freeData = buf->data; // to be freed in stage 4
+        allocReadBuffer(buf, ss.str());
+    }
+    return true;
+}
+
+bool cmdChangesDone(World* inWorld, void* cmdData) {
+    auto data = (InfoCmdData*)cmdData;
+    if (data->bufnum >= 0)
+        syncBuffer(inWorld, data->bufnum);
+    return true;
+}
+
+void vst_changes(World *inWorld, void* inUserData, struct sc_msg_iter *args, void *replyAddr) {
+    auto since = args->gets("0");
+    auto size = strlen(since) + 1;
+    // temp file or buffer to store the changes
+    int32 bufnum = -1;
+    const char* filename = nullptr;
+    if (args->nextTag() == 's') {
+        filename = args->gets();
+    }
+    else {
+        bufnum = args->geti(-1);
+        if (bufnum >= inWorld->mNumSndBufs) {
+            LOG_ERROR("vst_changes: bufnum " << bufnum << " out of range");
+            return;
+        }
+    }
+
+    auto data = CmdData::create<InfoCmdData>(inWorld, size);
+    if (data) {
+        data->bufnum = bufnum; // negative bufnum: don't write results
+        if (filename) {
+            snprintf(data->path, sizeof(data->path), "%s", filename);
+        }
+        else {
+            data->path[0] = '\0';
+        }
+        memcpy(data->buf, since, size);
+        DoAsynchronousCommand(inWorld, replyAddr, "vst_changes",
+            data, cmdChanges, cmdChangesDone, InfoCmdData::nrtFree, cmdRTfree, 0, 0);
+    }
+}
+
 /*** plugin entry point ***/
 
 void VSTPlugin_Ctor(VSTPlugin* unit){
@@ -2439,13 +2865,29 @@ PluginLoad(VSTPlugin) {
 
     PluginCmd(vst_search);
     PluginCmd(vst_search_stop);
+    PluginCmd(vst_search_poll);
+    PluginCmd(vst_watch);
+    PluginCmd(vst_watch_poll);
     PluginCmd(vst_clear);
     PluginCmd(vst_probe);
+    PluginCmd(vst_query);
+    PluginCmd(vst_changes);
 
     Print("VSTPlugin v%d.%d.%d%s\n",
           VERSION_MAJOR, VERSION_MINOR, VERSION_BUGFIX, VERSION_BETA ? " (beta)" : "");
-    // read cached plugin info
-    readIniFile();
+    // read cached plugin info on a background thread, so we don't delay the Server startup.
+    // lookups which arrive in the meantime only wait for the requested plugin.
+    gPluginManager.beginLoad();
+    try {
+        std::thread([]() {
+            readIniFile();
+            gPluginManager.endLoad();
+        }).detach();
+    } catch (const std::system_error& e) {
+        LOG_ERROR("couldn't start thread: " << e.what());
+        readIniFile();
+        gPluginManager.endLoad();
+    }
 }
 
 
@@ -3,6 +3,7 @@
 #include "SC_PlugIn.hpp"
 #include "Interface.h"
 #include "PluginManager.h"
+#include "PluginSearch.h"
 #include "Utility.h"
 #include "rt_shared_ptr.hpp"
 
@@ -10,9 +11,11 @@ using namespace vst;
 
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <memory>
 #include <string>
 #include <vector>
+#include <deque>
 #include <unordered_map>
 #include <fstream>
 #include <sstream>
@@ -72,8 +75,11 @@ struct InfoCmdData : CmdData {
     static bool nrtFree(World* world, void* cmdData);
     int32 flags = 0;
     int32 bufnum = -1;
+    float timeout = -1; // probe timeout (< 0: default)
+    int concurrency = -1; // max. number of parallel probes (< 0: default)
     bool async = false;
     std::string buffer;
+    PluginInfo::const_ptr info; // keep the queried plugin alive
     void* freeData = nullptr;
     char path[256];
     // flexible array
@@ -81,6 +87,33 @@ struct InfoCmdData : CmdData {
     char buf[1];
 };
 
+namespace QueryFlags {
+    const int prefix = 1;
+};
+
+// see /vst_query
+struct QueryCmdData : CmdData {
+    static bool nrtFree(World* world, void* cmdData);
+    int32 flags = 0;
+    int32 type = -1; // plugin type (< 0: any)
+    int32 pluginFlags = 0; // required plugin flags
+    int32 bufnum = -1;
+    void* freeData = nullptr;
+    char path[256];
+    // name, vendor and category (separated by '\0')
+    int size = 0;
+    char buf[1];
+};
+
+// see /vst_search_poll
+struct SearchPollCmdData : CmdData {
+    static bool nrtFree(World* world, void* cmdData);
+    std::vector<std::string> plugins; // keys of new plugins
+    int32 bufnum = -1;
+    int32 numPlugins = -1; // >= 0: the search has finished
+    void* freeData = nullptr;
+};
+
 // This class contains all the state that is shared between the UGen (VSTPlugin) and asynchronous commands.
 // It is managed by a rt::shared_ptr and therefore kept alive during the execution of commands, which means
 // we don't have to worry about the actual UGen being freed concurrently while a command is still running.
@@ -162,6 +195,8 @@ public:
     void sendCurrentProgramName();
     void sendParameter(int32 index, float value); // unchecked
     void sendParameterAutomated(int32 index, float value); // unchecked
+    // RT thread: report dropped MIDI and sysex events on the NRT thread (see IPlugin::takeNumDroppedEvents())
+    void droppedEvents(int n);
     // perform sequenced command
     template<bool owner = true, typename T>
     void doCmd(T* cmdData, AsyncStageFn stage2, AsyncStageFn stage3 = nullptr,
@@ -184,6 +219,10 @@ private:
     bool paramSet_ = false; // did we just set a parameter manually?
     bool suspended_ = false;
     std::mutex mutex_;
+    // dropped events; only accessed on the RT thread
+    int numDroppedEvents_ = 0;
+    bool droppedPending_ = false; // one report at a time
+    void reportDroppedEvents();
 };
 
 class VSTPlugin : public SCUnit {
@@ -258,6 +297,7 @@ private:
     float* paramState_ = nullptr;
     Mapping** paramMapping_ = nullptr;
     Bypass bypass_ = Bypass::Off;
+    DspLoadMeter dspLoad_; // for probe throttling
 
     // threading
 #if HAVE_UI_THREAD
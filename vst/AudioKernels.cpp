@@ -0,0 +1,165 @@
+#include "AudioKernels.h"
+#include "AudioKernelsImpl.h"
+
+#include <type_traits>
+
+#if VST_AUDIO_SSE2
+# include <emmintrin.h>
+#endif
+
+#if VST_AUDIO_AVX2 && defined(_MSC_VER)
+# include <intrin.h>
+#endif
+
+namespace vst {
+namespace audio {
+
+namespace {
+
+#if VST_AUDIO_SSE2
+
+struct SSE2Float {
+    using sample = float;
+    using vec = __m128;
+    static const int size = 4;
+    static vec load(const float *p) { return _mm_loadu_ps(p); }
+    static void store(float *p, vec v) { _mm_storeu_ps(p, v); }
+    static vec set(float x) { return _mm_set1_ps(x); }
+    static vec ramp(float start, float step) {
+        return _mm_add_ps(_mm_set1_ps(start), _mm_mul_ps(_mm_set_ps(3, 2, 1, 0), _mm_set1_ps(step)));
+    }
+    static vec add(vec a, vec b) { return _mm_add_ps(a, b); }
+    static vec sub(vec a, vec b) { return _mm_sub_ps(a, b); }
+    static vec mul(vec a, vec b) { return _mm_mul_ps(a, b); }
+    static float sum(vec v) {
+        v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+        v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+        return _mm_cvtss_f32(v);
+    }
+};
+
+struct SSE2Double {
+    using sample = double;
+    using vec = __m128d;
+    static const int size = 2;
+    static vec load(const double *p) { return _mm_loadu_pd(p); }
+    static void store(double *p, vec v) { _mm_storeu_pd(p, v); }
+    static vec set(double x) { return _mm_set1_pd(x); }
+    static vec ramp(double start, double step) {
+        return _mm_set_pd(start + step, start);
+    }
+    static vec add(vec a, vec b) { return _mm_add_pd(a, b); }
+    static vec sub(vec a, vec b) { return _mm_sub_pd(a, b); }
+    static vec mul(vec a, vec b) { return _mm_mul_pd(a, b); }
+    static double sum(vec v) {
+        return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+    }
+};
+
+template<typename T>
+using BaseVec = typename std::conditional<std::is_same<T, float>::value, SSE2Float, SSE2Double>::type;
+
+const char *baseName = "SSE2";
+
+#else
+
+template<typename T>
+using BaseVec = ScalarVec<T>;
+
+const char *baseName = "scalar";
+
+#endif
+
+#if VST_AUDIO_AVX2
+bool cpuHasAVX2(){
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7){
+        return false;
+    }
+    __cpuid(info, 1);
+    // the OS must save the YMM registers (OSXSAVE + AVX, XCR0 bits 1 and 2)
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0
+            || (_xgetbv(0) & 6) != 6){
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+template<typename T>
+KernelTable<T> selectKernels(){
+#if VST_AUDIO_AVX2
+    if (cpuHasAVX2()){
+        return getAVX2Kernels(T{});
+    }
+#endif
+    return Kernels<BaseVec<T>>::table(baseName);
+}
+
+// selected once when the library is loaded
+const KernelTable<float> floatKernels = selectKernels<float>();
+const KernelTable<double> doubleKernels = selectKernels<double>();
+
+} // namespace
+
+void rampCopy(const float *in, float *out, int n, float start, float step){
+    floatKernels.rampCopy(in, out, n, start, step);
+}
+
+void rampCopy(const double *in, double *out, int n, double start, double step){
+    doubleKernels.rampCopy(in, out, n, start, step);
+}
+
+void rampScale(float *out, int n, float start, float step){
+    floatKernels.rampScale(out, n, start, step);
+}
+
+void rampScale(double *out, int n, double start, double step){
+    doubleKernels.rampScale(out, n, start, step);
+}
+
+void rampAdd(const float *in, float *out, int n, float start, float step){
+    floatKernels.rampAdd(in, out, n, start, step);
+}
+
+void rampAdd(const double *in, double *out, int n, double start, double step){
+    doubleKernels.rampAdd(in, out, n, start, step);
+}
+
+void crossfade(const float *in, float *out, int n, float start, float step){
+    floatKernels.crossfade(in, out, n, start, step);
+}
+
+void crossfade(const double *in, double *out, int n, double start, double step){
+    doubleKernels.crossfade(in, out, n, start, step);
+}
+
+void add(const float *in, float *out, int n){
+    floatKernels.add(in, out, n);
+}
+
+void add(const double *in, double *out, int n){
+    doubleKernels.add(in, out, n);
+}
+
+bool isSilent(const float *buf, int n, float threshold){
+    return floatKernels.isSilent(buf, n, threshold);
+}
+
+bool isSilent(const double *buf, int n, double threshold){
+    return doubleKernels.isSilent(buf, n, threshold);
+}
+
+const char * kernelName(){
+    return floatKernels.name;
+}
+
+} // audio
+} // vst
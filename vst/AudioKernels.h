@@ -0,0 +1,43 @@
+#pragma once
+
+namespace vst {
+
+// Vectorized sample loops for the bypass ramps and the tail silence detection
+// in VST2Plugin::doProcessing() and VST3Plugin::doProcess().
+//
+// On x86 the SSE2 kernels are the baseline; the AVX2 kernels (AudioKernelsAVX2.cpp)
+// are selected at runtime if the CPU supports them. Other architectures use scalar loops.
+//
+// The ramps are linear: the gain of sample j is 'start + j * step'.
+// Input and output buffers may be identical but must not overlap otherwise.
+namespace audio {
+
+// out = in * gain
+void rampCopy(const float *in, float *out, int n, float start, float step);
+void rampCopy(const double *in, double *out, int n, double start, double step);
+
+// out *= gain
+void rampScale(float *out, int n, float start, float step);
+void rampScale(double *out, int n, double start, double step);
+
+// out += in * (1 - gain)
+void rampAdd(const float *in, float *out, int n, float start, float step);
+void rampAdd(const double *in, double *out, int n, double start, double step);
+
+// out = out * gain + in * (1 - gain)
+void crossfade(const float *in, float *out, int n, float start, float step);
+void crossfade(const double *in, double *out, int n, double start, double step);
+
+// out += in
+void add(const float *in, float *out, int n);
+void add(const double *in, double *out, int n);
+
+// RMS < threshold; stops as soon as the running sum exceeds the limit
+bool isSilent(const float *buf, int n, float threshold);
+bool isSilent(const double *buf, int n, double threshold);
+
+// name of the selected kernels ("AVX2", "SSE2" or "scalar")
+const char * kernelName();
+
+} // audio
+} // vst
@@ -0,0 +1,76 @@
+// AVX2 versions of the kernels in AudioKernels.cpp.
+// Only call them after checking the CPU (see selectKernels())!
+
+#ifdef _MSC_VER
+# define VST_AUDIO_TARGET
+#else
+# define VST_AUDIO_TARGET __attribute__((target("avx2")))
+#endif
+
+#include "AudioKernelsImpl.h"
+
+#if VST_AUDIO_AVX2
+
+#include <immintrin.h>
+
+namespace vst {
+namespace audio {
+
+namespace {
+
+struct AVX2Float {
+    using sample = float;
+    using vec = __m256;
+    static const int size = 8;
+    VST_AUDIO_TARGET static vec load(const float *p) { return _mm256_loadu_ps(p); }
+    VST_AUDIO_TARGET static void store(float *p, vec v) { _mm256_storeu_ps(p, v); }
+    VST_AUDIO_TARGET static vec set(float x) { return _mm256_set1_ps(x); }
+    VST_AUDIO_TARGET static vec ramp(float start, float step) {
+        return _mm256_add_ps(_mm256_set1_ps(start),
+            _mm256_mul_ps(_mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0), _mm256_set1_ps(step)));
+    }
+    VST_AUDIO_TARGET static vec add(vec a, vec b) { return _mm256_add_ps(a, b); }
+    VST_AUDIO_TARGET static vec sub(vec a, vec b) { return _mm256_sub_ps(a, b); }
+    VST_AUDIO_TARGET static vec mul(vec a, vec b) { return _mm256_mul_ps(a, b); }
+    VST_AUDIO_TARGET static float sum(vec v) {
+        auto x = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+        x = _mm_add_ss(x, _mm_shuffle_ps(x, x, 1));
+        return _mm_cvtss_f32(x);
+    }
+};
+
+struct AVX2Double {
+    using sample = double;
+    using vec = __m256d;
+    static const int size = 4;
+    VST_AUDIO_TARGET static vec load(const double *p) { return _mm256_loadu_pd(p); }
+    VST_AUDIO_TARGET static void store(double *p, vec v) { _mm256_storeu_pd(p, v); }
+    VST_AUDIO_TARGET static vec set(double x) { return _mm256_set1_pd(x); }
+    VST_AUDIO_TARGET static vec ramp(double start, double step) {
+        return _mm256_add_pd(_mm256_set1_pd(start),
+            _mm256_mul_pd(_mm256_set_pd(3, 2, 1, 0), _mm256_set1_pd(step)));
+    }
+    VST_AUDIO_TARGET static vec add(vec a, vec b) { return _mm256_add_pd(a, b); }
+    VST_AUDIO_TARGET static vec sub(vec a, vec b) { return _mm256_sub_pd(a, b); }
+    VST_AUDIO_TARGET static vec mul(vec a, vec b) { return _mm256_mul_pd(a, b); }
+    VST_AUDIO_TARGET static double sum(vec v) {
+        auto x = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(x, _mm_unpackhi_pd(x, x)));
+    }
+};
+
+} // namespace
+
+KernelTable<float> getAVX2Kernels(float){
+    return Kernels<AVX2Float>::table("AVX2");
+}
+
+KernelTable<double> getAVX2Kernels(double){
+    return Kernels<AVX2Double>::table("AVX2");
+}
+
+} // audio
+} // vst
+
+#endif // VST_AUDIO_AVX2
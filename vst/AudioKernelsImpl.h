@@ -0,0 +1,194 @@
+#pragma once
+
+// Generic kernel implementation, shared by AudioKernels.cpp and AudioKernelsAVX2.cpp.
+// Only include this from those files!
+//
+// The AVX2 kernels are not compiled with special flags; instead AudioKernelsAVX2.cpp
+// defines VST_AUDIO_TARGET as a target attribute, which is applied to all kernel functions.
+// Everything lives in an anonymous namespace, so the linker can never merge
+// the AVX2 instantiations with the baseline ones.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+# define VST_AUDIO_X86 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define VST_AUDIO_SSE2 1
+#endif
+
+// GCC and Clang support target attributes, MSVC allows any intrinsics
+#if VST_AUDIO_X86 && VST_AUDIO_SSE2 && (defined(__GNUC__) || defined(_MSC_VER))
+# define VST_AUDIO_AVX2 1
+#endif
+
+#ifndef VST_AUDIO_TARGET
+# define VST_AUDIO_TARGET
+#endif
+
+namespace vst {
+namespace audio {
+
+template<typename T>
+struct KernelTable {
+    void (*rampCopy)(const T *, T *, int, T, T);
+    void (*rampScale)(T *, int, T, T);
+    void (*rampAdd)(const T *, T *, int, T, T);
+    void (*crossfade)(const T *, T *, int, T, T);
+    void (*add)(const T *, T *, int);
+    bool (*isSilent)(const T *, int, T);
+    const char *name;
+};
+
+#if VST_AUDIO_AVX2
+// defined in AudioKernelsAVX2.cpp
+KernelTable<float> getAVX2Kernels(float);
+KernelTable<double> getAVX2Kernels(double);
+#endif
+
+namespace {
+
+// V is a vector type description with the following static members:
+// sample, vec, size, load(), store(), set(), ramp() (= {a, a + b, a + 2b, ...}),
+// add(), sub(), mul() and sum() (horizontal).
+// The ramps compute the gain of each vector as 'start + (i + k) * step' like the scalar
+// loops, so it doesn't drift over long blocks. Only the sample positions (i + k) are
+// advanced by addition; they are integers and therefore exact.
+template<typename V>
+struct Kernels {
+    using T = typename V::sample;
+
+    // gains of two consecutive vectors
+    struct Ramp {
+        VST_AUDIO_TARGET Ramp(T start, T step)
+            : start_(V::set(start)), step_(V::set(step)),
+              pos1_(V::ramp(0, 1)), pos2_(V::ramp(V::size, 1)), inc_(V::set(V::size * 2)) {}
+        VST_AUDIO_TARGET typename V::vec gain1() const { return V::add(start_, V::mul(pos1_, step_)); }
+        VST_AUDIO_TARGET typename V::vec gain2() const { return V::add(start_, V::mul(pos2_, step_)); }
+        VST_AUDIO_TARGET void advance(){
+            pos1_ = V::add(pos1_, inc_);
+            pos2_ = V::add(pos2_, inc_);
+        }
+     private:
+        typename V::vec start_, step_, pos1_, pos2_, inc_;
+    };
+
+    VST_AUDIO_TARGET static void rampCopy(const T *in, T *out, int n, T start, T step){
+        Ramp r(start, step);
+        int i = 0;
+        for (; i + V::size * 2 <= n; i += V::size * 2){
+            V::store(out + i, V::mul(V::load(in + i), r.gain1()));
+            V::store(out + i + V::size, V::mul(V::load(in + i + V::size), r.gain2()));
+            r.advance();
+        }
+        for (; i < n; ++i){
+            out[i] = in[i] * (start + i * step);
+        }
+    }
+
+    VST_AUDIO_TARGET static void rampScale(T *out, int n, T start, T step){
+        Ramp r(start, step);
+        int i = 0;
+        for (; i + V::size * 2 <= n; i += V::size * 2){
+            V::store(out + i, V::mul(V::load(out + i), r.gain1()));
+            V::store(out + i + V::size, V::mul(V::load(out + i + V::size), r.gain2()));
+            r.advance();
+        }
+        for (; i < n; ++i){
+            out[i] *= (start + i * step);
+        }
+    }
+
+    VST_AUDIO_TARGET static void rampAdd(const T *in, T *out, int n, T start, T step){
+        // in * (1 - gain) = in * (1 - start - i * step)
+        Ramp r(1 - start, -step);
+        int i = 0;
+        for (; i + V::size * 2 <= n; i += V::size * 2){
+            V::store(out + i, V::add(V::load(out + i), V::mul(V::load(in + i), r.gain1())));
+            V::store(out + i + V::size, V::add(V::load(out + i + V::size),
+                                               V::mul(V::load(in + i + V::size), r.gain2())));
+            r.advance();
+        }
+        for (; i < n; ++i){
+            out[i] += in[i] * (1 - (start + i * step));
+        }
+    }
+
+    VST_AUDIO_TARGET static void crossfade(const T *in, T *out, int n, T start, T step){
+        // out * gain + in * (1 - gain) = in + (out - in) * gain
+        Ramp r(start, step);
+        int i = 0;
+        for (; i + V::size * 2 <= n; i += V::size * 2){
+            auto x1 = V::load(in + i);
+            auto x2 = V::load(in + i + V::size);
+            V::store(out + i, V::add(x1, V::mul(V::sub(V::load(out + i), x1), r.gain1())));
+            V::store(out + i + V::size, V::add(x2, V::mul(V::sub(V::load(out + i + V::size), x2), r.gain2())));
+            r.advance();
+        }
+        for (; i < n; ++i){
+            T g = start + i * step;
+            out[i] = out[i] * g + in[i] * (1 - g);
+        }
+    }
+
+    VST_AUDIO_TARGET static void add(const T *in, T *out, int n){
+        int i = 0;
+        for (; i + V::size <= n; i += V::size){
+            V::store(out + i, V::add(V::load(out + i), V::load(in + i)));
+        }
+        for (; i < n; ++i){
+            out[i] += in[i];
+        }
+    }
+
+    VST_AUDIO_TARGET static bool isSilent(const T *buf, int n, T threshold){
+        // sqrt(sum / n) < threshold
+        const T limit = threshold * threshold * n;
+        // the sum can only grow, so we can stop as soon as it reaches the limit.
+        // check every 64 samples (with two accumulators to hide the add latency)
+        const int blocksize = 64;
+        T sum = 0;
+        int i = 0;
+        while (i + blocksize <= n){
+            auto acc1 = V::set(0);
+            auto acc2 = V::set(0);
+            for (int end = i + blocksize; i < end; i += V::size * 2){
+                auto a = V::load(buf + i);
+                auto b = V::load(buf + i + V::size);
+                acc1 = V::add(acc1, V::mul(a, a));
+                acc2 = V::add(acc2, V::mul(b, b));
+            }
+            sum += V::sum(V::add(acc1, acc2));
+            if (sum >= limit){
+                return false;
+            }
+        }
+        for (; i < n; ++i){
+            sum += buf[i] * buf[i];
+        }
+        return sum < limit; // false for NaN
+    }
+
+    static KernelTable<T> table(const char *name){
+        return { rampCopy, rampScale, rampAdd, crossfade, add, isSilent, name };
+    }
+};
+
+// plain loops, also used as a reference
+template<typename T>
+struct ScalarVec {
+    using sample = T;
+    using vec = T;
+    static const int size = 1;
+    static vec load(const T *p) { return *p; }
+    static void store(T *p, vec v) { *p = v; }
+    static vec set(T x) { return x; }
+    static vec ramp(T start, T) { return start; }
+    static vec add(vec a, vec b) { return a + b; }
+    static vec sub(vec a, vec b) { return a - b; }
+    static vec mul(vec a, vec b) { return a * b; }
+    static T sum(vec v) { return v; }
+};
+
+} // namespace
+} // audio
+} // vst
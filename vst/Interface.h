@@ -6,6 +6,7 @@
 #include <iostream>
 #include <functional>
 #include <memory>
+#include <atomic>
 
 // for SharedMutex
 #include <mutex>
@@ -132,7 +133,7 @@ class IPlugin {
         int numOutputs = 0;
         int numAuxInputs = 0;
         int numAuxOutputs = 0;
-        int numSamples = 0;
+        int numSamples = 0; // must not exceed maxBlockSize (see setupProcessing())
     };
     virtual void setupProcessing(double sampleRate, int maxBlockSize, ProcessPrecision precision) = 0;
     virtual void process(ProcessData<float>& data) = 0;
@@ -158,6 +159,10 @@ class IPlugin {
 
     virtual void sendMidiEvent(const MidiEvent& event) = 0;
     virtual void sendSysexEvent(const SysexEvent& event) = 0;
+    // the number of events which have been dropped because the event queues were full;
+    // resets the count. Can be called from any thread, so the host can report it outside
+    // the audio thread.
+    virtual int takeNumDroppedEvents() = 0;
 
     virtual void setParameter(int index, float value, int sampleOffset = 0) = 0;
     virtual bool setParameter(int index, const std::string& str, int sampleOffset = 0) = 0;
@@ -227,6 +232,87 @@ struct Preset {
 
 using PresetList = std::vector<Preset>;
 
+class StringPool;
+
+// Immutable string which lives in a global string pool. Values which repeat a lot
+// in the plugin database (vendors, categories, module paths, parameter names and
+// labels, etc.) are only stored once, and copying only increments a reference count.
+// A pooled string is freed together with its last reference (e.g. after PluginManager::clear()).
+class InternedString {
+ public:
+    InternedString() = default;
+    InternedString(const std::string& s)
+        : entry_(intern(s)) {}
+    InternedString(const char *s)
+        : entry_(intern(s)) {}
+    InternedString(const InternedString& other)
+        : entry_(other.entry_) { retain(entry_); }
+    InternedString(InternedString&& other) noexcept
+        : entry_(other.entry_) { other.entry_ = nullptr; }
+    ~InternedString(){ release(entry_); }
+    InternedString& operator=(InternedString other) noexcept {
+        std::swap(entry_, other.entry_);
+        return *this;
+    }
+    operator const std::string&() const { return str(); }
+    const std::string& str() const { return entry_ ? entry_->str : emptyString(); }
+    const char * c_str() const { return str().c_str(); }
+    size_t size() const { return str().size(); }
+    bool empty() const { return !entry_; }
+    // equal strings always share the same entry
+    friend bool operator==(const InternedString& a, const InternedString& b){
+        return a.entry_ == b.entry_;
+    }
+    friend bool operator!=(const InternedString& a, const InternedString& b){
+        return a.entry_ != b.entry_;
+    }
+    template<typename T>
+    friend bool operator==(const InternedString& a, const T& b){ return a.str() == b; }
+    template<typename T>
+    friend bool operator==(const T& a, const InternedString& b){ return a == b.str(); }
+    template<typename T>
+    friend bool operator!=(const InternedString& a, const T& b){ return a.str() != b; }
+    template<typename T>
+    friend bool operator!=(const T& a, const InternedString& b){ return a != b.str(); }
+    // number of pooled strings resp. their total size in bytes
+    static size_t poolCount();
+    static size_t poolSize();
+ private:
+    friend class StringPool;
+    struct Entry {
+        Entry(const std::string& s) : str(s) {}
+        const std::string str;
+        std::atomic<int32_t> refcount{1};
+    };
+    // NB: the empty string is not pooled (nullptr)
+    static Entry* intern(const std::string& s);
+    static void retain(Entry *e){
+        if (e){
+            e->refcount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    static void release(Entry *e){
+        if (e){
+            // only the last reference has to go through the pool
+            auto count = e->refcount.load(std::memory_order_relaxed);
+            while (count > 1){
+                if (e->refcount.compare_exchange_weak(count, count - 1,
+                                                      std::memory_order_acq_rel)){
+                    return;
+                }
+            }
+            releaseLast(e);
+        }
+    }
+    static void releaseLast(Entry *e);
+    static const std::string& emptyString();
+    Entry *entry_ = nullptr;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const InternedString& s){
+    return os << s.str();
+}
+
 struct PluginInfo {
     static const uint32_t NoParamID = 0xffffffff;
 
@@ -235,6 +321,7 @@ struct PluginInfo {
 
     PluginInfo() = default;
     PluginInfo(const std::shared_ptr<const IFactory>& factory);
+    ~PluginInfo();
     void setFactory(const std::shared_ptr<const IFactory>& factory){
         factory_ = factory;
     }
@@ -243,8 +330,9 @@ struct PluginInfo {
     // create new instances
     // throws an Error exception on failure!
     IPlugin::ptr create() const;
-    // read/write plugin description
-    void serialize(std::ostream& file) const;
+    // read/write plugin description.
+    // a summary leaves out the parameters and programs and is marked as partial.
+    void serialize(std::ostream& file, bool summary = false) const;
     void deserialize(std::istream& file);
     void setUniqueID(int _id); // VST2
     int getUniqueID() const {
@@ -257,12 +345,12 @@ struct PluginInfo {
     PluginType type() const { return type_; }
     // info data
     std::string uniqueID;
-    std::string path;
+    InternedString path;
     std::string name;
-    std::string vendor;
-    std::string category;
-    std::string version;
-    std::string sdkVersion;
+    InternedString vendor;
+    InternedString category;
+    InternedString version;
+    InternedString sdkVersion;
     int numInputs = 0;
     int numAuxInputs = 0;
     int numOutputs = 0;
@@ -273,42 +361,33 @@ struct PluginInfo {
 #endif
     // parameters
     struct Param {
-        std::string name;
-        std::string label;
+        InternedString name;
+        InternedString label;
         uint32_t id = 0;
     };
-    std::vector<Param> parameters;
+#if USE_VST3
+    struct ParamIndex {
+        uint32_t id = 0;
+        int index = -1; // -1: empty
+    };
+#endif
     void addParameter(Param param){
-        auto index = parameters.size();
-        // inverse mapping
-        paramMap_[param.name] = index;
-    #if USE_VST3
-        // index -> ID mapping
-        indexToIdMap_[index] = param.id;
-        // ID -> index mapping
-        idToIndexMap_[param.id] = index;
-    #endif
-        // add parameter
-        parameters.push_back(std::move(param));
-    }
-
-    void addParamAlias(int index, const std::string& key){
-        paramMap_[key] = index;
-    }
-    int findParam(const std::string& key) const {
-        auto it = paramMap_.find(key);
-        if (it != paramMap_.end()){
-            return it->second;
-        } else {
-            return -1;
-        }
+        mutableTables().addParameter(std::move(param));
     }
+    // additional name for a parameter (e.g. with whitespace replaced by underscores).
+    // aliases are kept apart from the parameter tables, so they survive eviction
+    // and don't make lazy tables resident. can be called from any thread.
+    void addParamAlias(int index, const std::string& key);
+    // find parameter by name or alias; returns -1 if not found
+    int findParam(const std::string& key) const;
+    // NB: the following table accessors don't pin the tables, so they may only be used
+    // while the tables are pinned, e.g. by a plugin instance. Otherwise use pinTables()!
 #if USE_VST3
     // get VST3 parameter ID from index
     uint32_t getParamID(int index) const {
-        auto it = indexToIdMap_.find(index);
-        if (it != indexToIdMap_.end()){
-            return it->second;
+        auto& ids = tables().paramIDs;
+        if (index >= 0 && index < (int)ids.size()){
+            return ids[index];
         }
         else {
             return 0; // throw?
@@ -316,41 +395,109 @@ struct PluginInfo {
     }
     // get index from VST3 parameter ID
     int getParamIndex(uint32_t _id) const {
-        auto it = idToIndexMap_.find(_id);
-        if (it != idToIndexMap_.end()){
-            return it->second;
-        }
-        else {
-            return -1; // throw?
+        auto& t = tables();
+        if (!t.idToIndex.empty()){
+            auto mask = t.idToIndex.size() - 1;
+            for (auto i = t.hashParamID(_id); ; i = (i + 1) & mask){
+                auto& slot = t.idToIndex[i];
+                if (slot.index < 0){
+                    break; // empty slot
+                } else if (slot.id == _id){
+                    return slot.index;
+                }
+            }
         }
+        return -1; // throw?
     }
 #endif
     int numParameters() const {
-        return parameters.size();
+        return tables().parameters.size();
+    }
+    const Param& getParameter(int index) const {
+        return tables().parameters[index];
     }
     // presets
-    void scanPresets();
-    int numPresets() const { return presets.size(); }
+    // The preset folders are only scanned on first access. Each folder is cached
+    // together with its modification time and only scanned again if it has changed.
+    // presets() returns an immutable snapshot which stays valid while other threads
+    // add, remove or rename presets; use the same snapshot for looking up an index!
+    void scanPresets(); // force rescan
+    std::shared_ptr<const PresetList> presets() const;
+    int numPresets() const { return presets()->size(); }
     int findPreset(const std::string& name) const;
     Preset makePreset(const std::string& name, PresetType type = PresetType::User) const;
     int addPreset(Preset preset);
     bool removePreset(int index, bool del = true);
     bool renamePreset(int index, const std::string& newName);
     std::string getPresetFolder(PresetType type, bool create = false) const;
-    PresetList presets;
     // for thread-safety (if needed)
     Lock writeLock() { return Lock(mutex); }
     SharedLock readLock() const { return SharedLock(mutex); }
 private:
-    void sortPresets(bool userOnly = true);
+    // the following methods must be called with presetMutex_ held
+    void updatePresets() const;
+    void setPresets(std::shared_ptr<const PresetList> presets) const;
+    static void sortPresets(PresetList& presets, bool userOnly = true);
+    struct PresetFolder {
+        PresetType type;
+        bool exists = false;
+        uint64_t mtime = 0;
+        PresetList presets;
+    };
+    mutable std::vector<PresetFolder> presetFolders_; // empty: not scanned yet
+    mutable std::shared_ptr<const PresetList> presets_;
+    mutable std::mutex presetMutex_;
+    // parameter aliases (see addParamAlias())
+    std::unordered_map<std::string, int> paramAliases_;
+    mutable std::mutex aliasMutex_;
     mutable SharedMutex mutex;
     mutable bool didCreatePresetFolder = false;
 public:
     // default programs
-    std::vector<std::string> programs;
+    void addProgram(std::string name){
+        mutableTables().programs.push_back(std::move(name));
+    }
     int numPrograms() const {
-        return programs.size();
+        return tables().programs.size();
+    }
+    const std::string& getProgram(int index) const {
+        return tables().programs[index];
     }
+    // Parameter and program tables. They can be loaded lazily (e.g. from the binary
+    // plugin cache) and tables which haven't been used recently are evicted again
+    // when the memory budget is exceeded (see setParamTableBudget()).
+    // NB: references into lazy tables are only guaranteed to stay valid while
+    // the tables are pinned; plugin instances pin the tables of their PluginInfo,
+    // everybody else has to hold on to the result of pinTables().
+    struct Tables {
+        std::vector<Param> parameters;
+        std::vector<std::string> programs;
+        // param name to param index
+        std::unordered_map<std::string, int> paramMap;
+    #if USE_VST3
+        // param index to ID (VST3 only)
+        std::vector<uint32_t> paramIDs;
+        // param ID to index (VST3 only); open addressing hash table with linear probing.
+        // Both tables are flat arrays, so the lookups in the audio thread are cheap.
+        std::vector<ParamIndex> idToIndex; // size is a power of 2 (or 0)
+        int idToIndexShift = 28; // 32 - log2(size)
+        size_t hashParamID(uint32_t id) const {
+            // Fibonacci hashing, so that consecutive IDs and hashed IDs both work well
+            return (uint32_t)(id * 2654435769u) >> idToIndexShift;
+        }
+        void addParamIndex(uint32_t id, int index);
+    #endif
+        void addParameter(Param param);
+        void clearParameters();
+        // estimated memory usage in bytes
+        size_t memoryUsage() const;
+    };
+    using TablePtr = std::shared_ptr<const Tables>;
+    using TableLoader = std::function<void(Tables&)>;
+    // load tables on demand; the loader might be called several times!
+    void setTableLoader(TableLoader loader);
+    // keep tables resident as long as the returned pointer is alive
+    TablePtr pinTables() const;
     bool hasEditor() const {
         return flags & HasEditor;
     }
@@ -383,6 +530,11 @@ public:
     bool sysexOutput() const {
         return flags & SysexOutput;
     }
+    // only the metadata has been scanned (see IFactory::probe()); the I/O counts
+    // (VST3), parameters and programs are only available after the full probe.
+    bool isPartial() const {
+        return flags & Partial;
+    }
     // flags
     enum Flags {
         HasEditor = 1 << 0,
@@ -392,7 +544,8 @@ public:
         MidiInput = 1 << 4,
         MidiOutput = 1 << 5,
         SysexInput = 1 << 6,
-        SysexOutput = 1 << 7
+        SysexOutput = 1 << 7,
+        Partial = 1 << 8
     };
     uint32_t flags = 0;
 #if USE_VST2
@@ -404,15 +557,21 @@ public:
     std::vector<ShellPlugin> shellPlugins;
 #endif
  private:
+    friend class ParamTableCache;
     std::weak_ptr<const IFactory> factory_;
-    // param name to param index
-    std::unordered_map<std::string, int> paramMap_;
-#if USE_VST3
-    // param index to ID (VST3 only)
-    std::unordered_map<int, uint32_t> indexToIdMap_;
-    // param ID to index (VST3 only)
-    std::unordered_map<uint32_t, int> idToIndexMap_;
-#endif
+    const Tables& tables() const {
+        auto t = currentTables_.load(std::memory_order_acquire);
+        return t ? *t : loadTables();
+    }
+    const Tables& loadTables() const;
+    Tables& mutableTables();
+    mutable std::shared_ptr<Tables> tables_;
+    mutable std::atomic<Tables *> currentTables_{nullptr};
+    TableLoader tableLoader_;
+    // LRU list of lazily loaded tables (see ParamTableCache)
+    mutable size_t tableSize_ = 0;
+    mutable const PluginInfo *lruPrev_ = nullptr;
+    mutable const PluginInfo *lruNext_ = nullptr;
     PluginType type_;
     union ID {
         char uid[16];
@@ -444,7 +603,8 @@ class Error : public std::exception {
         SystemError,
         ModuleError,
         PluginError,
-        UnknownError
+        UnknownError,
+        Timeout
     };
 
     Error(ErrorCode code = NoError)
@@ -472,6 +632,37 @@ struct ProbeResult {
     bool valid() const { return error.code() == Error::NoError; }
 };
 
+// The plugin descriptions of a factory. The list is immutable: addPlugin() publishes
+// a new list, so that other threads can safely keep reading the old one
+// (e.g. while PluginManager::probeFull() replaces a partial plugin).
+struct PluginList {
+    using const_ptr = std::shared_ptr<const PluginList>;
+    static const_ptr make(std::vector<PluginInfo::ptr> plugins = {});
+    // returns a new list where 'desc' has been appended resp. replaces the plugin with the same name
+    const_ptr add(PluginInfo::ptr desc) const;
+    PluginInfo::ptr find(const std::string& name) const;
+
+    std::vector<PluginInfo::ptr> plugins;
+    std::unordered_map<std::string, PluginInfo::ptr> map;
+};
+
+// per-call probe settings, so that concurrent searches don't have to
+// change the global settings (see setProbeTimeout() and setProbeConcurrency()).
+struct ProbeOptions {
+    ProbeOptions(bool _quick = false) : quick(_quick) {}
+    // only scan the metadata, see IFactory::probe()
+    bool quick = false;
+    // max. time (in seconds) a single probe process may take; 0 means no timeout.
+    // < 0 (default): use the global setting.
+    double timeout = -1;
+    // max. number of plugins which are probed in parallel; 0 means automatic.
+    // < 0 (default): use the global setting.
+    int concurrency = -1;
+
+    double getTimeout() const;
+    int getNumParallelProbes() const;
+};
+
 class IFactory : public std::enable_shared_from_this<IFactory> {
  public:
     using ptr = std::shared_ptr<IFactory>;
@@ -480,36 +671,106 @@ class IFactory : public std::enable_shared_from_this<IFactory> {
     using ProbeCallback = std::function<void(const ProbeResult&)>;
     using ProbeFuture = std::function<void(ProbeCallback)>;
 
-    // expects an absolute path to the actual plugin file with or without extension
+    // expects an absolute path to the actual plugin file with or without extension.
+    // 'verify': check that the file exists and has the right CPU architecture.
+    // This can be skipped for modules from the plugin cache which haven't changed
+    // since they have been probed (the caller has already stat'ed the file).
     // throws an Error exception on failure!
-    static IFactory::ptr load(const std::string& path);
+    static IFactory::ptr load(const std::string& path, bool verify = true);
 
     virtual ~IFactory(){}
     virtual void addPlugin(PluginInfo::ptr desc) = 0;
     virtual PluginInfo::const_ptr getPlugin(int index) const = 0;
     virtual int numPlugins() const = 0;
-    void probe(ProbeCallback callback);
-    virtual ProbeFuture probeAsync() = 0;
+    // 'quick': only scan the metadata (name, vendor, category, etc.) without creating
+    // the plugin resp. without enumerating parameters and programs.
+    // The results are marked as partial (see PluginInfo::isPartial()).
+    void probe(ProbeCallback callback, const ProbeOptions& options = ProbeOptions());
+    virtual ProbeFuture probeAsync(const ProbeOptions& options = ProbeOptions()) = 0;
+    // run the full probe for a plugin which has only been scanned.
+    // the new description replaces the old one with addPlugin().
+    // throws an Error exception on failure!
+    PluginInfo::ptr probeFull(const PluginInfo& desc,
+                              const ProbeOptions& options = ProbeOptions());
     virtual bool isProbed() const = 0;
     virtual bool valid() const = 0; // contains at least one valid plugin
     virtual std::string path() const = 0;
     // create a new plugin instance
     // throws an Error on failure!
     virtual IPlugin::ptr create(const std::string& name, bool probe = false) const = 0;
+    // get the plugin metadata without creating the plugin (if possible), see probe()
+    // throws an Error on failure!
+    virtual PluginInfo::const_ptr scan(const std::string& name) const = 0;
  protected:
     using ProbeResultFuture = std::function<ProbeResult()>;
-    ProbeResultFuture probePlugin(const std::string& name, int shellPluginID = 0);
+    ProbeResultFuture probePlugin(const std::string& name, int shellPluginID = 0,
+                                  const ProbeOptions& options = ProbeOptions());
     using ProbeList = std::vector<std::pair<std::string, int>>;
     std::vector<PluginInfo::ptr> probePlugins(const ProbeList& pluginList,
-            ProbeCallback callback);
+            ProbeCallback callback, const ProbeOptions& options = ProbeOptions());
 };
 
 // recursively search 'dir' for VST plug-ins. for each plugin, the callback function is evaluated with the absolute path.
 void search(const std::string& dir, std::function<void(const std::string&)> fn, bool filter = true);
 
+// search several directories concurrently. paths are passed to the callback function
+// (always on the calling thread) as soon as they are found, so probing can start before
+// the traversal has finished. directories reachable via several paths are only searched once.
+void search(const std::vector<std::string>& dirs, std::function<void(const std::string&)> fn, bool filter = true);
+
 // recursively search 'dir' for a VST plugin. returns empty string on failure
 std::string find(const std::string& dir, const std::string& path);
 
+// get the plugin module which contains 'path' (e.g. a file inside a bundle).
+// returns an empty string if 'path' doesn't belong to a plugin module.
+std::string getModulePath(const std::string& path);
+
+// watch directories (recursively) for added, modified and removed files.
+// changes are reported after a short period of inactivity, so that several changes
+// to the same file (e.g. while a plugin is being installed) are merged. the callback
+// is called on the watcher thread with the paths of all changed files and directories.
+// currently only implemented on Linux (inotify).
+class DirectoryWatcher {
+ public:
+    using ptr = std::unique_ptr<DirectoryWatcher>;
+    using Callback = std::function<void(const std::vector<std::string>&)>;
+    // returns nullptr if not supported on this platform
+    // throws an Error exception on failure!
+    static ptr create(Callback callback);
+    virtual ~DirectoryWatcher() {}
+    // watch/unwatch are reference counted; can be called from any thread.
+    virtual void watch(const std::string& dir) = 0;
+    virtual void unwatch(const std::string& dir) = 0;
+};
+
+// max. time (in seconds) a single probe process may take before it is killed.
+// a value <= 0 means no timeout.
+void setProbeTimeout(double seconds);
+
+double getProbeTimeout();
+
+// max. number of plugins which are probed in parallel.
+// 0 (default) means automatic: derived from the number of online CPU cores and the current system load.
+void setProbeConcurrency(int n);
+
+int getProbeConcurrency();
+
+// the actual max. number of parallel probes (see setProbeConcurrency())
+int getNumParallelProbes();
+
+// the DSP load of the host (0.0 - 1.0). new probe processes are throttled while the load is high.
+void setDspLoad(double load);
+
+// add or subtract the load of a single plugin instance (thread-safe), see DspLoadMeter
+void addDspLoad(double delta);
+
+double getDspLoad();
+
+// memory budget (in bytes) for lazily loaded parameter and program tables (see PluginInfo)
+void setParamTableBudget(size_t bytes);
+
+size_t getParamTableBudget();
+
 const std::vector<std::string>& getDefaultSearchPaths();
 
 const std::vector<const char *>& getPluginExtensions();
@@ -0,0 +1,258 @@
+#include "JsonReader.h"
+
+#include <cstring>
+#include <cctype>
+
+namespace vst {
+
+/*/////////////////////// JsonValue ///////////////////////*/
+
+const JsonValue* JsonValue::find(const char *key) const {
+    for (auto& member : object){
+        if (member.first == key){
+            return &member.second;
+        }
+    }
+    return nullptr;
+}
+
+std::string JsonValue::get(const char *key) const {
+    auto value = find(key);
+    return (value && value->type == String) ? value->string : "";
+}
+
+/*/////////////////////// JsonReader ///////////////////////*/
+
+namespace {
+
+class JsonReader {
+ public:
+    JsonReader(const char *text)
+        : pos_(text) {}
+    // read the root value; returns false on syntax error
+    bool readDocument(JsonValue& value);
+ private:
+    // don't blow the stack on malicious files
+    static const int maxDepth = 256;
+
+    bool read(JsonValue& value, int depth);
+    bool skip();
+    bool readString(std::string& result);
+    bool readKey(std::string& result);
+    bool readHex(unsigned int& code);
+    const char *pos_;
+};
+
+static bool isIdentifier(char c){
+    return isalnum((unsigned char)c) || c == '_' || c == '$';
+}
+
+static void encodeUtf8(unsigned int code, std::string& result){
+    if (code < 0x80){
+        result += (char)code;
+    } else if (code < 0x800){
+        result += (char)(0xC0 | (code >> 6));
+        result += (char)(0x80 | (code & 0x3F));
+    } else if (code < 0x10000){
+        result += (char)(0xE0 | (code >> 12));
+        result += (char)(0x80 | ((code >> 6) & 0x3F));
+        result += (char)(0x80 | (code & 0x3F));
+    } else {
+        result += (char)(0xF0 | (code >> 18));
+        result += (char)(0x80 | ((code >> 12) & 0x3F));
+        result += (char)(0x80 | ((code >> 6) & 0x3F));
+        result += (char)(0x80 | (code & 0x3F));
+    }
+}
+
+// skip whitespace and comments; returns false on unterminated block comment
+bool JsonReader::skip(){
+    while (*pos_){
+        if (isspace((unsigned char)*pos_)){
+            pos_++;
+        } else if (pos_[0] == '/' && pos_[1] == '/'){
+            while (*pos_ && *pos_ != '\n') pos_++;
+        } else if (pos_[0] == '/' && pos_[1] == '*'){
+            auto end = strstr(pos_ + 2, "*/");
+            if (!end){
+                return false;
+            }
+            pos_ = end + 2;
+        } else {
+            break;
+        }
+    }
+    return true;
+}
+
+bool JsonReader::readHex(unsigned int& code){
+    code = 0;
+    for (int i = 0; i < 4; ++i, ++pos_){
+        if (!isxdigit((unsigned char)*pos_)){
+            return false;
+        }
+        code = code * 16 + (isdigit((unsigned char)*pos_) ?
+            *pos_ - '0' : (tolower((unsigned char)*pos_) - 'a' + 10));
+    }
+    return true;
+}
+
+// double or single quoted (JSON5)
+bool JsonReader::readString(std::string& result){
+    char quote = *pos_;
+    if (quote != '"' && quote != '\''){
+        return false;
+    }
+    pos_++;
+    result.clear();
+    while (*pos_ && *pos_ != quote){
+        char c = *pos_++;
+        if (c == '\\'){
+            c = *pos_++;
+            switch (c){
+            case 'n': result += '\n'; break;
+            case 't': result += '\t'; break;
+            case 'r': result += '\r'; break;
+            case 'b': result += '\b'; break;
+            case 'f': result += '\f'; break;
+            case 'v': result += '\v'; break;
+            case '\n': break; // line continuation
+            case 'u':
+            {
+                unsigned int code;
+                if (!readHex(code)){
+                    return false;
+                }
+                if (code >= 0xD800 && code < 0xDC00){
+                    // high surrogate; combine with the following low surrogate
+                    unsigned int low;
+                    if (pos_[0] == '\\' && pos_[1] == 'u'){
+                        auto saved = pos_;
+                        pos_ += 2;
+                        if (!readHex(low)){
+                            return false;
+                        }
+                        if (low >= 0xDC00 && low < 0xE000){
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        } else {
+                            pos_ = saved; // not a pair, read again
+                            code = 0xFFFD;
+                        }
+                    } else {
+                        code = 0xFFFD;
+                    }
+                } else if (code >= 0xDC00 && code < 0xE000){
+                    code = 0xFFFD; // lone low surrogate
+                }
+                encodeUtf8(code, result);
+                break;
+            }
+            case 0:
+                return false;
+            default: // '"', '\'', '\\', '/'
+                result += c;
+                break;
+            }
+        } else {
+            result += c;
+        }
+    }
+    if (*pos_ != quote){
+        return false;
+    }
+    pos_++;
+    return true;
+}
+
+// quoted or plain identifier (JSON5)
+bool JsonReader::readKey(std::string& result){
+    if (*pos_ == '"' || *pos_ == '\''){
+        return readString(result);
+    }
+    auto start = pos_;
+    while (isIdentifier(*pos_)){
+        pos_++;
+    }
+    result.assign(start, pos_);
+    return pos_ != start;
+}
+
+bool JsonReader::read(JsonValue& value, int depth){
+    if (!skip()){
+        return false;
+    }
+    if (*pos_ == '{' || *pos_ == '['){
+        if (depth >= maxDepth){
+            return false;
+        }
+        bool isObject = *pos_ == '{';
+        char close = isObject ? '}' : ']';
+        value.type = isObject ? JsonValue::Object : JsonValue::Array;
+        pos_++;
+        while (true){
+            if (!skip()){
+                return false;
+            }
+            if (*pos_ == close){
+                pos_++;
+                return true;
+            }
+            if (isObject){
+                std::string key;
+                if (!readKey(key) || !skip() || *pos_++ != ':'){
+                    return false;
+                }
+                value.object.emplace_back(std::move(key), JsonValue{});
+                if (!read(value.object.back().second, depth + 1)){
+                    return false;
+                }
+            } else {
+                value.array.emplace_back();
+                if (!read(value.array.back(), depth + 1)){
+                    return false;
+                }
+            }
+            if (!skip()){
+                return false;
+            }
+            if (*pos_ == ','){
+                pos_++; // the next iteration also accepts a trailing comma
+            } else if (*pos_ != close){
+                return false;
+            }
+        }
+    } else if (*pos_ == '"' || *pos_ == '\''){
+        value.type = JsonValue::String;
+        return readString(value.string);
+    } else {
+        // number, boolean or null
+        auto start = pos_;
+        while (isIdentifier(*pos_) || (*pos_ && strchr("+-.", *pos_))){
+            pos_++;
+        }
+        value.type = JsonValue::Null;
+        value.string.assign(start, pos_);
+        return pos_ != start;
+    }
+}
+
+bool JsonReader::readDocument(JsonValue& value){
+    // skip UTF-8 BOM
+    if (!strncmp(pos_, "\xEF\xBB\xBF", 3)){
+        pos_ += 3;
+    }
+    if (!read(value, 0) || !skip()){
+        return false;
+    }
+    // only comments and whitespace may follow the root value
+    return *pos_ == 0;
+}
+
+} // namespace
+
+bool parseJson(const std::string& text, JsonValue& value){
+    JsonReader reader(text.c_str());
+    return reader.readDocument(value);
+}
+
+} // vst
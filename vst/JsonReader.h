@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+
+namespace vst {
+
+// A small JSON reader for moduleinfo.json files (see VST3Factory::readModuleInfo()).
+//
+// The files are written as JSON5, so we also accept comments, trailing commas,
+// single-quoted strings and unquoted keys. \u escapes (including surrogate pairs)
+// are decoded to UTF-8. Numbers, booleans and null are stored as raw strings.
+
+struct JsonValue {
+    enum Type {
+        Null,
+        String,
+        Array,
+        Object
+    };
+    Type type = Null;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    // returns nullptr if not found
+    const JsonValue* find(const char *key) const;
+    // returns an empty string if not found or not a string
+    std::string get(const char *key) const;
+};
+
+// returns false on syntax error
+bool parseJson(const std::string& text, JsonValue& value);
+
+} // vst
@@ -16,6 +16,7 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <future>
 #include <deque>
 #include <algorithm>
 
@@ -32,6 +33,12 @@ namespace fs = std::experimental::filesystem;
 # include <sys/wait.h>
 # include <sys/stat.h>
 # include <sys/types.h>
+# include <sys/socket.h>
+# include <fcntl.h>
+# include <poll.h>
+# include <signal.h>
+# include <spawn.h>
+extern char **environ;
 # ifndef ACCESSPERMS
 #  define ACCESSPERMS (S_IRWXU|S_IRWXG|S_IRWXO)
 # endif
@@ -53,6 +60,7 @@ namespace fs = std::experimental::filesystem;
 
 #if defined(__linux__)
 # include <elf.h>
+# include <sys/inotify.h>
 #endif
 
 namespace vst {
@@ -299,6 +307,79 @@ std::string fileBaseName(const std::string& path){
     return path.substr(start, n);
 }
 
+// for bundles we have to check the actual binary (see also VST3Factory::doLoad)
+static std::string getModuleBinary(const std::string& path){
+    if (isDirectory(path)){
+    #if defined(_WIN32)
+        auto binary = path + "/" + getBundleBinaryPath() + "/" + fileName(path);
+    #elif defined(__APPLE__)
+        auto binary = path + "/" + getBundleBinaryPath() + "/" + fileBaseName(path);
+    #else
+        auto binary = path + "/" + getBundleBinaryPath() + "/" + fileBaseName(path) + ".so";
+    #endif
+        if (isFile(binary)){
+            return binary;
+        }
+    }
+    return path;
+}
+
+bool getFileInfo(const std::string& path, FileInfo& info){
+    auto binary = getModuleBinary(path);
+#ifdef _WIN32
+    auto handle = CreateFileW(widen(binary).c_str(), 0,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+    if (handle == INVALID_HANDLE_VALUE){
+        return false;
+    }
+    BY_HANDLE_FILE_INFORMATION fileInfo;
+    bool result = GetFileInformationByHandle(handle, &fileInfo);
+    CloseHandle(handle);
+    if (result){
+        info.size = ((uint64_t)fileInfo.nFileSizeHigh << 32) | fileInfo.nFileSizeLow;
+        info.mtime = ((uint64_t)fileInfo.ftLastWriteTime.dwHighDateTime << 32)
+                | fileInfo.ftLastWriteTime.dwLowDateTime;
+        info.inode = ((uint64_t)fileInfo.nFileIndexHigh << 32) | fileInfo.nFileIndexLow;
+        info.hash = 0;
+    }
+    return result;
+#else
+    struct stat stbuf;
+    if (stat(binary.c_str(), &stbuf) != 0){
+        return false;
+    }
+    info.size = stbuf.st_size;
+#ifdef __APPLE__
+    auto& ts = stbuf.st_mtimespec;
+#else
+    auto& ts = stbuf.st_mtim;
+#endif
+    info.mtime = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    info.inode = stbuf.st_ino;
+    info.hash = 0;
+    return true;
+#endif
+}
+
+uint64_t hashFile(const std::string& path){
+    // 64-bit FNV-1a
+    const uint64_t prime = 0x100000001b3;
+    uint64_t hash = 0xcbf29ce484222325;
+    File file(getModuleBinary(path));
+    if (!file.is_open()){
+        return 0;
+    }
+    char buf[65536];
+    while (file.read(buf, sizeof(buf)), file.gcount() > 0){
+        auto n = file.gcount();
+        for (int i = 0; i < n; ++i){
+            hash = (hash ^ (unsigned char)buf[i]) * prime;
+        }
+    }
+    return hash != 0 ? hash : 1; // 0 means "no hash"
+}
+
 std::string getTmpDirectory(){
 #ifdef _WIN32
     wchar_t tmpDir[MAX_PATH + 1];
@@ -871,76 +952,554 @@ std::string find(const std::string &dir, const std::string &path){
 #endif
 }
 
-// recursively search a directory for VST plugins. for every plugin, 'fn' is called with the full absolute path.
-void search(const std::string &dir, std::function<void(const std::string&)> fn, bool filter) {
-    // extensions
-    std::unordered_set<std::string> extensions;
+namespace {
+
+// Walks one or more directory trees concurrently. Directories are scanned by a small
+// pool of threads while the found paths are passed to the calling thread as soon as
+// they are discovered, so the caller can already start probing while the traversal
+// is still running (which helps a lot with network drives and huge plugin folders).
+// Visited directories are keyed on device + inode, which protects against symlink
+// cycles and directories that can be reached from several roots.
+class DirectoryWalker {
+ public:
+    DirectoryWalker(bool filter);
+    ~DirectoryWalker();
+    void run(const std::vector<std::string>& roots,
+             const std::function<void(const std::string&)>& fn);
+ private:
+    void threadFunction();
+    void scanDirectory(const std::string& dirname);
+    void addEntries(std::vector<std::string>& dirs, std::vector<std::string>& files);
+    bool isDone() const { return dirs_.empty() && numBusy_ == 0; }
+    std::unordered_set<std::string> extensions_;
+    bool filter_;
+    std::vector<std::thread> threads_;
+    std::deque<std::string> dirs_; // pending directories
+    std::vector<std::string> files_; // found plugin paths
+    int numBusy_ = 0;
+    bool quit_ = false;
+    std::mutex mutex_;
+    std::condition_variable dirCondition_;
+    std::condition_variable fileCondition_;
+#ifdef _WIN32
+    // canonical paths of directory links/junctions
+    std::unordered_set<std::wstring> visited_;
+#else
+    struct FileID {
+        dev_t dev;
+        ino_t ino;
+        bool operator==(const FileID& other) const {
+            return dev == other.dev && ino == other.ino;
+        }
+    };
+    struct FileIDHash {
+        size_t operator()(const FileID& id) const {
+            return std::hash<uint64_t>()(((uint64_t)id.dev << 32) ^ (uint64_t)id.ino);
+        }
+    };
+    std::unordered_set<FileID, FileIDHash> visited_;
+#endif
+};
+
+// directory scanning is I/O bound, so we don't need too many threads
+#define SEARCH_THREADS 4
+
+DirectoryWalker::DirectoryWalker(bool filter)
+    : filter_(filter)
+{
     for (auto& ext : platformExtensions) {
-        extensions.insert(ext);
+        extensions_.insert(ext);
     }
-    // search recursively
-#ifdef _WIN32
-    std::function<void(const std::wstring&)> searchDir = [&](const std::wstring& dirname){
-        try {
-            // LOG_DEBUG("searching in " << shorten(dirname));
-            for (auto& entry : fs::directory_iterator(dirname)) {
-                // check the extension
-                auto path = entry.path();
-                auto ext = path.extension().u8string();
-                if (extensions.count(ext)) {
-                    // found a VST2 plugin (file or bundle)
-                    fn(path.u8string());
-                } else if (fs::is_directory(path)){
-                    // otherwise search it if it's a directory
-                    searchDir(path);
-                } else if (!filter && fs::is_regular_file(path)){
-                    fn(path.u8string());
-                }
+}
+
+DirectoryWalker::~DirectoryWalker(){
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    dirCondition_.notify_all();
+    for (auto& thread : threads_){
+        if (thread.joinable()){
+            thread.join();
+        }
+    }
+}
+
+void DirectoryWalker::run(const std::vector<std::string>& roots,
+                          const std::function<void(const std::string&)>& fn)
+{
+    for (auto& root : roots){
+        if (root.empty()){
+            continue;
+        }
+    #ifndef _WIN32
+        // force no trailing slash
+        if (root.size() > 1 && root.back() == '/'){
+            dirs_.push_back(root.substr(0, root.size() - 1));
+            continue;
+        }
+    #endif
+        dirs_.push_back(root);
+    }
+    if (dirs_.empty()){
+        return;
+    }
+    for (int i = 0; i < SEARCH_THREADS; ++i){
+        threads_.emplace_back(&DirectoryWalker::threadFunction, this);
+    }
+    // pass found paths to the callback (in the calling thread!)
+    std::vector<std::string> files;
+    for (;;){
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            fileCondition_.wait(lock, [&](){
+                return !files_.empty() || isDone();
+            });
+            if (files_.empty()){
+                break; // done
             }
-        } catch (const fs::filesystem_error& e) {
-            LOG_DEBUG(e.what());
-        };
+            files.swap(files_);
+        }
+        for (auto& file : files){
+            fn(file);
+        }
+        files.clear();
+    }
+}
+
+void DirectoryWalker::threadFunction(){
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;){
+        dirCondition_.wait(lock, [&](){
+            return quit_ || !dirs_.empty() || numBusy_ == 0;
+        });
+        if (quit_ || dirs_.empty()){
+            break; // cancelled or done
+        }
+        auto dir = std::move(dirs_.front());
+        dirs_.pop_front();
+        numBusy_++;
+        lock.unlock();
+
+        scanDirectory(dir);
+
+        lock.lock();
+        numBusy_--;
+        if (isDone()){
+            // wake up the other threads and the caller
+            dirCondition_.notify_all();
+            fileCondition_.notify_one();
+        }
+    }
+}
+
+void DirectoryWalker::addEntries(std::vector<std::string>& dirs, std::vector<std::string>& files){
+    // sort alphabetically (ignoring case)
+    auto sortnocase = [](const std::string& a, const std::string& b){
+        return stringCompare(a, b);
     };
-    searchDir(widen(dir));
-#else // Unix
-    // force no trailing slash
-    auto root = (dir.back() == '/') ? dir.substr(0, dir.size() - 1) : dir;
-    std::function<void(const std::string&)> searchDir = [&](const std::string& dirname) {
-        // search alphabetically (ignoring case)
-        struct dirent **dirlist;
-        auto sortnocase = [](const struct dirent** a, const struct dirent **b) -> int {
-            return strcasecmp((*a)->d_name, (*b)->d_name);
-        };
-        int n = scandir(dirname.c_str(), &dirlist, NULL, sortnocase);
-        if (n >= 0) {
-            for (int i = 0; i < n; ++i) {
-                auto entry = dirlist[i];
-                std::string name(entry->d_name);
-                std::string absPath = dirname + "/" + name;
-                // check the extension
-                std::string ext;
-                auto extPos = name.find_last_of('.');
-                if (extPos != std::string::npos){
-                    ext = name.substr(extPos);
-                }
-                if (extensions.count(ext)){
-                    // found a VST2 plugin (file or bundle)
-                    fn(absPath);
-                } else if (isDirectory(dirname, entry)){
-                    // otherwise search it if it's a directory
-                    searchDir(absPath);
-                } else if (!filter && isFile(absPath)){
-                    fn(absPath);
+    std::sort(dirs.begin(), dirs.end(), sortnocase);
+    std::sort(files.begin(), files.end(), sortnocase);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& dir : dirs){
+            dirs_.push_back(std::move(dir));
+        }
+        for (auto& file : files){
+            files_.push_back(std::move(file));
+        }
+    }
+    if (dirs.size() > 1){
+        dirCondition_.notify_all();
+    } else if (!dirs.empty()){
+        dirCondition_.notify_one();
+    }
+    if (!files.empty()){
+        fileCondition_.notify_one();
+    }
+}
+
+#ifdef _WIN32
+void DirectoryWalker::scanDirectory(const std::string& dirname){
+    std::vector<std::string> dirs, files;
+    try {
+        // LOG_DEBUG("searching in " << dirname);
+        for (auto& entry : fs::directory_iterator(widen(dirname))) {
+            // check the extension
+            auto& path = entry.path();
+            auto ext = path.extension().u8string();
+            if (extensions_.count(ext)) {
+                // found a VST plugin (file or bundle)
+                files.push_back(path.u8string());
+            } else if (fs::is_directory(entry.status())){
+                // otherwise search it if it's a directory.
+                // directory links and junctions might create cycles!
+                if (fs::is_symlink(entry.symlink_status())){
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (!visited_.insert(fs::canonical(path).wstring()).second){
+                        continue;
+                    }
                 }
-                free(entry);
+                dirs.push_back(path.u8string());
+            } else if (!filter_ && fs::is_regular_file(entry.status())){
+                files.push_back(path.u8string());
             }
-            free(dirlist);
         }
+    } catch (const fs::filesystem_error& e) {
+        LOG_DEBUG(e.what());
     };
-    searchDir(root);
+    addEntries(dirs, files);
+}
+#else
+void DirectoryWalker::scanDirectory(const std::string& dirname){
+    DIR *directory = opendir(dirname.c_str());
+    if (!directory){
+        return;
+    }
+    int fd = dirfd(directory);
+    // check if we've already been here (e.g. symlink cycle).
+    // fstat() on the open directory is cheaper than stat() on the path.
+    struct stat stbuf;
+    if (fstat(fd, &stbuf) == 0){
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!visited_.insert(FileID { stbuf.st_dev, stbuf.st_ino }).second){
+            closedir(directory);
+            return;
+        }
+    }
+    std::vector<std::string> dirs, files;
+    struct dirent *entry;
+    while ((entry = readdir(directory))){
+        // we don't count "." and ".."
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0){
+            continue;
+        }
+        std::string name(entry->d_name);
+        std::string absPath = dirname + "/" + name;
+        // check the extension
+        std::string ext;
+        auto extPos = name.find_last_of('.');
+        if (extPos != std::string::npos){
+            ext = name.substr(extPos);
+        }
+        if (extensions_.count(ext)){
+            // found a VST plugin (file or bundle)
+            files.push_back(std::move(absPath));
+            continue;
+        }
+        // only call stat() if we don't know the file type;
+        // we want to follow symlinks.
+        bool isDir = false, isReg = false;
+    #ifdef DT_UNKNOWN
+        if (entry->d_type != DT_UNKNOWN && entry->d_type != DT_LNK){
+            isDir = entry->d_type == DT_DIR;
+            isReg = entry->d_type == DT_REG;
+        } else
+    #endif
+        if (fstatat(fd, entry->d_name, &stbuf, 0) == 0){
+            isDir = S_ISDIR(stbuf.st_mode);
+            isReg = S_ISREG(stbuf.st_mode);
+        }
+        if (isDir){
+            // otherwise search it if it's a directory
+            dirs.push_back(std::move(absPath));
+        } else if (!filter_ && isReg){
+            files.push_back(std::move(absPath));
+        }
+    }
+    closedir(directory);
+    addEntries(dirs, files);
+}
 #endif
+
+} // namespace
+
+// recursively search directories for VST plugins. for every plugin, 'fn' is called with the full absolute path.
+void search(const std::vector<std::string> &dirs, std::function<void(const std::string&)> fn, bool filter) {
+    DirectoryWalker walker(filter);
+    walker.run(dirs, fn);
+}
+
+void search(const std::string &dir, std::function<void(const std::string&)> fn, bool filter) {
+    search(std::vector<std::string> { dir }, std::move(fn), filter);
+}
+
+std::string getModulePath(const std::string& path){
+    // take the outermost match, e.g. "Foo.vst3" for "Foo.vst3/Contents/x86_64-linux/Foo.so"
+    auto hasExtension = [](const std::string& p, size_t end){
+        for (auto& ext : platformExtensions){
+            auto len = strlen(ext);
+            if (end >= len && !p.compare(end - len, len, ext)){
+                return true;
+            }
+        }
+        return false;
+    };
+    for (size_t i = 1; i <= path.size(); ++i){
+        if ((i == path.size() || path[i] == '/' || path[i] == '\\') && hasExtension(path, i)){
+            return path.substr(0, i);
+        }
+    }
+    return std::string{};
+}
+
+/*/////////// DirectoryWatcher //////////////////*/
+
+#ifdef __linux__
+
+namespace {
+
+// wait for this many milliseconds without any new events before reporting changes
+#define WATCH_DELAY 1000
+// ...but don't hold back changes longer than this while events keep coming in
+#define WATCH_MAX_DELAY 10000
+
+class InotifyWatcher final : public DirectoryWatcher {
+ public:
+    InotifyWatcher(Callback callback);
+    ~InotifyWatcher();
+    void watch(const std::string& dir) override;
+    void unwatch(const std::string& dir) override;
+ private:
+    void run();
+    void addWatch(const std::string& dir, std::unordered_set<std::string> *visited = nullptr);
+    void removeWatches(const std::string& dir);
+    void rescan(std::unordered_set<std::string>& pending);
+    Callback callback_;
+    int fd_ = -1;
+    int pipe_[2] = { -1, -1 }; // to wake up the thread
+    std::thread thread_;
+    std::mutex mutex_;
+    std::unordered_map<int, std::string> dirs_; // watch descriptor -> directory
+    std::unordered_map<std::string, int> watches_; // directory -> watch descriptor
+    std::unordered_map<std::string, int> roots_; // root directory -> ref count
+};
+
+static bool isSubPath(const std::string& path, const std::string& dir){
+    return path.size() > dir.size() && path[dir.size()] == '/'
+            && !path.compare(0, dir.size(), dir);
+}
+
+InotifyWatcher::InotifyWatcher(Callback callback)
+    : callback_(std::move(callback))
+{
+    fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd_ < 0){
+        throw Error(Error::SystemError, "inotify_init1() failed: " + errorMessage(errno));
+    }
+    if (pipe2(pipe_, O_CLOEXEC) != 0){
+        close(fd_);
+        throw Error(Error::SystemError, "pipe2() failed: " + errorMessage(errno));
+    }
+    thread_ = std::thread(&InotifyWatcher::run, this);
+}
+
+InotifyWatcher::~InotifyWatcher(){
+    // wake up and quit
+    char c = 0;
+    if (write(pipe_[1], &c, 1) < 0){
+        LOG_ERROR("InotifyWatcher: couldn't wake up thread");
+    }
+    if (thread_.joinable()){
+        thread_.join();
+    }
+    close(pipe_[0]);
+    close(pipe_[1]);
+    close(fd_);
+}
+
+void InotifyWatcher::watch(const std::string& dir){
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (roots_[dir]++ == 0){
+        addWatch(dir);
+    }
+}
+
+void InotifyWatcher::unwatch(const std::string& dir){
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = roots_.find(dir);
+    if (it != roots_.end() && --it->second == 0){
+        roots_.erase(it);
+        // keep directories which are also part of another root
+        for (auto& root : roots_){
+            if (root.first == dir || isSubPath(dir, root.first)){
+                return;
+            }
+        }
+        removeWatches(dir);
+    }
+}
+
+// add watches for 'dir' and all its subdirectories. If 'visited' is not NULL,
+// we also descend into directories which are already watched (see rescan()).
+void InotifyWatcher::addWatch(const std::string& dir, std::unordered_set<std::string> *visited){
+    if (visited){
+        if (!visited->insert(dir).second){
+            return;
+        }
+    } else if (watches_.count(dir)){
+        return;
+    }
+    if (!watches_.count(dir)){
+        const uint32_t mask = IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM
+                | IN_DELETE | IN_ONLYDIR;
+        int wd = inotify_add_watch(fd_, dir.c_str(), mask);
+        if (wd < 0){
+            if (errno == ENOSPC){
+                LOG_WARNING("can't watch " << dir << ": too many watches "
+                            "(see /proc/sys/fs/inotify/max_user_watches)");
+            } else if (errno != ENOENT && errno != ENOTDIR){
+                LOG_ERROR("can't watch " << dir << ": " << errorMessage(errno));
+            }
+            return;
+        }
+        dirs_[wd] = dir;
+        watches_[dir] = wd;
+    }
+    DIR *d = opendir(dir.c_str());
+    if (d){
+        struct dirent *entry;
+        while ((entry = readdir(d))){
+            if (isDirectory(dir, entry)){
+                addWatch(dir + "/" + entry->d_name, visited);
+            }
+        }
+        closedir(d);
+    }
+}
+
+// remove watches for 'dir' and all its subdirectories
+void InotifyWatcher::removeWatches(const std::string& dir){
+    for (auto it = watches_.begin(); it != watches_.end(); ){
+        if (it->first == dir || isSubPath(it->first, dir)){
+            inotify_rm_watch(fd_, it->second);
+            dirs_.erase(it->second);
+            it = watches_.erase(it);
+        } else {
+            ++it;
+        }
+    }
 }
 
+// after an event queue overflow we don't know what has changed, so we update
+// the watches (we might have missed new or removed subdirectories) and report all roots.
+// NB: we don't recreate existing watches because removing them would generate
+// IN_IGNORED events, which could overflow the queue again.
+void InotifyWatcher::rescan(std::unordered_set<std::string>& pending){
+    for (auto it = watches_.begin(); it != watches_.end(); ){
+        if (!isDirectory(it->first)){
+            // the IN_IGNORED event might have been lost
+            dirs_.erase(it->second);
+            it = watches_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    std::unordered_set<std::string> visited;
+    for (auto& root : roots_){
+        addWatch(root.first, &visited);
+        pending.insert(root.first);
+    }
+}
+
+void InotifyWatcher::run(){
+    using clock = std::chrono::steady_clock;
+    LOG_DEBUG("InotifyWatcher: start");
+    std::vector<std::string> changes;
+    std::unordered_set<std::string> pending;
+    clock::time_point deadline; // report pending changes at the latest
+    // NB: 'buffer' must be suitably aligned for inotify_event
+    alignas(inotify_event) char buffer[4096];
+    for (;;){
+        pollfd fds[2];
+        fds[0].fd = fd_;
+        fds[0].events = POLLIN;
+        fds[1].fd = pipe_[0];
+        fds[1].events = POLLIN;
+        int timeout = -1;
+        if (!pending.empty()){
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - clock::now()).count();
+            timeout = std::max<int>(0, std::min<int>(WATCH_DELAY, remaining));
+        }
+        int result = poll(fds, 2, timeout);
+        if (result < 0){
+            if (errno == EINTR){
+                continue;
+            }
+            LOG_ERROR("InotifyWatcher: poll() failed: " << errorMessage(errno));
+            break;
+        }
+        if (fds[1].revents){
+            break; // quit
+        }
+        if (result == 0 || (!pending.empty() && clock::now() >= deadline)){
+            // no more events for WATCH_DELAY ms or WATCH_MAX_DELAY ms have passed
+            changes.assign(pending.begin(), pending.end());
+            pending.clear();
+            std::sort(changes.begin(), changes.end());
+            callback_(changes);
+            continue;
+        }
+        auto n = read(fd_, buffer, sizeof(buffer));
+        if (n <= 0){
+            continue; // EAGAIN or EINTR
+        }
+        if (pending.empty()){
+            deadline = clock::now() + std::chrono::milliseconds(WATCH_MAX_DELAY);
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (char *ptr = buffer; ptr < buffer + n; ){
+            auto event = reinterpret_cast<const inotify_event *>(ptr);
+            ptr += sizeof(inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW){
+                LOG_WARNING("InotifyWatcher: event queue overflow - rescanning");
+                rescan(pending);
+                continue;
+            }
+            auto dir = dirs_.find(event->wd);
+            if (dir == dirs_.end()){
+                continue;
+            }
+            if (event->mask & IN_IGNORED){
+                // directory has been removed
+                watches_.erase(dir->second);
+                dirs_.erase(dir);
+                continue;
+            }
+            if (!event->len){
+                continue;
+            }
+            auto path = dir->second + "/" + event->name;
+            if (event->mask & IN_ISDIR){
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)){
+                    // NB: files might have been added before the watch
+                    // has been created, so we report the directory itself.
+                    addWatch(path);
+                } else if (event->mask & IN_MOVED_FROM){
+                    removeWatches(path);
+                }
+            }
+            pending.insert(path);
+        }
+    }
+    LOG_DEBUG("InotifyWatcher: quit");
+}
+
+} // namespace
+
+DirectoryWatcher::ptr DirectoryWatcher::create(Callback callback){
+    return std::make_unique<InotifyWatcher>(std::move(callback));
+}
+
+#else
+
+DirectoryWatcher::ptr DirectoryWatcher::create(Callback callback){
+    return nullptr; // not implemented (yet)
+}
+
+#endif
+
 /*/////////// Message Loop //////////////////*/
 
 namespace UIThread {
@@ -1169,7 +1728,7 @@ std::unique_ptr<IModule> IModule::load(const std::string& path){
 
 /*///////////////////// IFactory ////////////////////////*/
 
-IFactory::ptr IFactory::load(const std::string& path){
+IFactory::ptr IFactory::load(const std::string& path, bool verify){
 #ifdef _WIN32
     const char *ext = ".dll";
 #elif defined(__APPLE__)
@@ -1180,13 +1739,15 @@ IFactory::ptr IFactory::load(const std::string& path){
     // LOG_DEBUG("IFactory: loading " << path);
     if (path.find(".vst3") != std::string::npos){
     #if USE_VST3
-        if (!pathExists(path)){
-            throw Error(Error::ModuleError, "No such file");
-        }
-        auto arch = getCpuArchitectures(path);
-        if (std::find(arch.begin(), arch.end(), getHostCpuArchitecture()) == arch.end()){
-            // TODO try bridging
-            throw Error(Error::ModuleError, "Wrong CPU architecture");
+        if (verify){
+            if (!pathExists(path)){
+                throw Error(Error::ModuleError, "No such file");
+            }
+            auto arch = getCpuArchitectures(path);
+            if (std::find(arch.begin(), arch.end(), getHostCpuArchitecture()) == arch.end()){
+                // TODO try bridging
+                throw Error(Error::ModuleError, "Wrong CPU architecture");
+            }
         }
         return std::make_shared<VST3Factory>(path);
     #else
@@ -1198,13 +1759,15 @@ IFactory::ptr IFactory::load(const std::string& path){
         if (path.find(ext) == std::string::npos){
             realPath += ext;
         }
-        if (!pathExists(realPath)){
-            throw Error(Error::ModuleError, "No such file");
-        }
-        auto arch = getCpuArchitectures(realPath);
-        if (std::find(arch.begin(), arch.end(), getHostCpuArchitecture()) == arch.end()){
-            // TODO try bridging
-            throw Error(Error::ModuleError, "Wrong CPU architecture");
+        if (verify){
+            if (!pathExists(realPath)){
+                throw Error(Error::ModuleError, "No such file");
+            }
+            auto arch = getCpuArchitectures(realPath);
+            if (std::find(arch.begin(), arch.end(), getHostCpuArchitecture()) == arch.end()){
+                // TODO try bridging
+                throw Error(Error::ModuleError, "Wrong CPU architecture");
+            }
         }
         return std::make_shared<VST2Factory>(realPath);
     #else
@@ -1231,143 +1794,646 @@ public:
 // should probe.exe inherit file handles and print to stdout/stderr?
 #define PROBE_LOG 0
 
-// probe a plugin in a seperate process and return the info in a file
-IFactory::ProbeResultFuture IFactory::probePlugin(const std::string& name, int shellPluginID) {
-    auto desc = std::make_shared<PluginInfo>(shared_from_this());
-    // put the information we already have (might be overriden)
-    desc->name = name;
-    desc->path = path();
-    // we pass the shell plugin ID instead of the name to probe.exe
-    std::string pluginName = shellPluginID ? std::to_string(shellPluginID) : name;
-    // create temp file path
-    std::stringstream ss;
-    ss << "/vst_" << desc.get(); // desc address should be unique as long as PluginInfos are retained.
-    std::string tmpPath = getTmpDirectory() + ss.str();
-    // LOG_DEBUG("temp path: " << tmpPath);
-#ifdef _WIN32
-    // get full path to probe exe
-    std::wstring probePath = getModuleDirectory() + L"\\probe.exe";
-    /// LOG_DEBUG("probe path: " << shorten(probePath));
-    // on Windows we need to quote the arguments for _spawn to handle spaces in file names.
-    std::stringstream cmdLineStream;
-    cmdLineStream << "probe.exe "
-            << "\"" << path() << "\" "
-            << "\"" << pluginName << "\" "
-            << "\"" << tmpPath + "\"";
-    auto cmdLine = widen(cmdLineStream.str());
-    STARTUPINFOW si;
-    PROCESS_INFORMATION pi;
-    ZeroMemory(&si, sizeof(si));
-    si.cb = sizeof(si);
-    ZeroMemory(&pi, sizeof(pi));
+#define PROBE_TIMEOUT 60 // default probe timeout in seconds
 
-    if (!CreateProcessW(probePath.c_str(), &cmdLine[0], NULL, NULL,
-                        PROBE_LOG, DETACHED_PROCESS, NULL, NULL, &si, &pi)){
-        auto err = GetLastError();
-        std::stringstream ss;
-        ss << "couldn't open probe process (" << errorMessage(err) << ")";
-        throw Error(Error::SystemError, ss.str());
+static std::atomic<double> gProbeTimeout{PROBE_TIMEOUT};
+
+void setProbeTimeout(double seconds){
+    gProbeTimeout.store(seconds);
+}
+
+double getProbeTimeout(){
+    return gProbeTimeout.load();
+}
+
+// don't start new probe processes while the DSP load is above this threshold
+#define PROBE_DSP_LOAD_LIMIT 0.7
+
+static std::atomic<int> gProbeConcurrency{0}; // 0: automatic
+static std::atomic<int> gNumActiveProbes{0}; // currently running probe jobs
+static std::atomic<double> gDspLoad{0};
+
+void setProbeConcurrency(int n){
+    gProbeConcurrency.store(std::max<int>(0, n));
+}
+
+int getProbeConcurrency(){
+    return gProbeConcurrency.load();
+}
+
+static int autoNumParallelProbes();
+
+int getNumParallelProbes(){
+    int n = gProbeConcurrency.load();
+    return n > 0 ? n : autoNumParallelProbes();
+}
+
+double ProbeOptions::getTimeout() const {
+    return timeout >= 0 ? timeout : getProbeTimeout();
+}
+
+int ProbeOptions::getNumParallelProbes() const {
+    if (concurrency > 0){
+        return concurrency;
+    } else if (concurrency == 0){
+        return autoNumParallelProbes();
+    } else {
+        return vst::getNumParallelProbes(); // global setting
     }
-    auto wait = [pi](){
-        if (WaitForSingleObject(pi.hProcess, INFINITE) != 0){
-            throw Error(Error::SystemError, "couldn't wait for probe process!");
-        }
-        DWORD code = -1;
-        if (!GetExitCodeProcess(pi.hProcess, &code)){
-            throw Error(Error::SystemError, "couldn't retrieve exit code for probe process!");
-        }
-        CloseHandle(pi.hProcess);
-        CloseHandle(pi.hThread);
-        return code;
-    };
-#else // Unix
+}
+
+static int autoNumParallelProbes(){
+    // the system load is updated only every few seconds, so we don't need to check it every time.
+    static std::atomic<int> lastValue{0};
+    static std::atomic<int64_t> lastTime{0};
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (lastValue.load() > 0 && (now - lastTime.load()) < 1000){
+        return lastValue.load();
+    }
+    int cores = std::thread::hardware_concurrency(); // online cores
+    if (cores <= 0){
+        cores = 1;
+    }
+    int n = cores - 1; // leave one core for the audio thread
+#ifndef _WIN32
+    double load;
+    if (getloadavg(&load, 1) == 1){
+        // don't count our own probe processes
+        double other = std::max<double>(0, load - gNumActiveProbes.load());
+        n -= (int)other;
+    }
+#endif
+    n = std::max<int>(1, n);
+    lastValue.store(n);
+    lastTime.store(now);
+    return n;
+}
+
+void setDspLoad(double load){
+    gDspLoad.store(load);
+}
+
+void addDspLoad(double delta){
+    auto load = gDspLoad.load(std::memory_order_relaxed);
+    while (!gDspLoad.compare_exchange_weak(load, load + delta, std::memory_order_relaxed)) ;
+}
+
+double getDspLoad(){
+    return gDspLoad.load(std::memory_order_relaxed);
+}
+
+static bool dspLoadTooHigh(){
+    return getDspLoad() > PROBE_DSP_LOAD_LIMIT;
+}
+
+// special exit status for probe processes (see IFactory::probePlugin)
+enum ProbeStatus {
+    ProbeCrash = -1,
+    ProbeTimeout = -2,
+    ProbeAborted = -3 // batch aborted before reaching this plugin
+};
+
+// exit status + result data (plugin info or error message)
+struct ProbeReply {
+    int status = EXIT_FAILURE;
+    std::string data;
+};
+
+// make an error reply (in the format expected by IFactory::probePlugin)
+static ProbeReply makeProbeError(Error::ErrorCode code, const std::string& msg){
+    ProbeReply reply;
+    reply.status = EXIT_FAILURE;
+    reply.data = std::to_string(static_cast<int>(code)) + "\n" + msg + "\n";
+    return reply;
+}
+
+#ifndef _WIN32
+
+static std::string getProbePath(){
     Dl_info dlinfo;
     // get full path to probe exe
-    // hack: obtain library info through a function pointer (vst::search)
-    if (!dladdr((void *)search, &dlinfo)) {
+    // hack: obtain library info through a function pointer
+    if (!dladdr((void *)getProbePath, &dlinfo)) {
         throw Error(Error::SystemError, "couldn't get module path!");
     }
     std::string modulePath = dlinfo.dli_fname;
     auto end = modulePath.find_last_of('/');
-    std::string probePath = modulePath.substr(0, end) + "/probe";
-    // fork
-    pid_t pid = fork();
-    if (pid == -1) {
-        throw Error(Error::SystemError, "fork() failed!");
-    }
-    else if (pid == 0) {
-        // child process: start new process with plugin path and temp file path as arguments.
-        // we must not quote arguments to exec!
-    #if !PROBE_LOG
-        // disable stdout and stderr
-        auto nullOut = fopen("/dev/null", "w");
-        fflush(stdout);
-        dup2(fileno(nullOut), STDOUT_FILENO);
-        fflush(stderr);
-        dup2(fileno(nullOut), STDERR_FILENO);
-    #endif
-        if (execl(probePath.c_str(), "probe", path().c_str(), pluginName.c_str(), tmpPath.c_str(), nullptr) < 0) {
-            // write error to temp file
-            int err = errno;
-            File file(tmpPath, File::WRITE);
-            if (file.is_open()){
-                file << static_cast<int>(Error::SystemError) << "\n";
-                file << "couldn't open probe process (" << errorMessage(err) << ")\n";
-            }
+    return modulePath.substr(0, end) + "/probe";
+}
+
+// Spawning a new probe process for every single plugin is expensive, especially
+// with thousands of plugins, so we keep a few long-lived worker processes around.
+// Each worker is driven by a thread which sends probe jobs over a socket and waits
+// for the exit status. A worker is only replaced after it has crashed (or after
+// a certain number of jobs, to contain leaks of badly behaved plugins);
+// idle workers are shut down after a while.
+// The results are sent back over the same socket, one frame per plugin
+// (see probe.cpp), so we don't need any tmp files.
+// A job can contain several (sub-)plugins of the same module, so that the module
+// only has to be loaded once (see probeBatch()).
+// The number of busy workers is limited by the concurrency of the front-most job
+// (see ProbeOptions::getNumParallelProbes()) and only a single
+// worker may run while the DSP load is high. The worker processes run with
+// the lowest possible CPU and I/O priority (see probe.cpp).
+#define PROBE_WORKER_MAX_JOBS 64 // recycle worker after n jobs
+#define PROBE_WORKER_TIMEOUT 5 // shut down idle workers after n seconds
+
+class ProbeWorkerPool {
+ public:
+    static ProbeWorkerPool& instance(){
+        static ProbeWorkerPool pool;
+        return pool;
+    }
+    ~ProbeWorkerPool();
+    // the reply status is EXIT_SUCCESS, EXIT_FAILURE, ProbeCrash or ProbeTimeout
+    // 'options.quick': only scan the plugin metadata (see IFactory::scan())
+    std::shared_future<ProbeReply> push(const std::string& path, const std::string& name,
+                                        const ProbeOptions& options);
+    // probe several plugins of the same module in a single worker.
+    // the callback is called (on the pool thread) exactly once for each plugin, in order.
+    // if the worker dies, the remaining plugins get the ProbeAborted status.
+    using ReplyCallback = std::function<void(int, ProbeReply&)>;
+    void push(const std::string& path, const std::vector<std::string>& names,
+              ReplyCallback callback, const ProbeOptions& options);
+ private:
+    struct Job {
+        std::string path;
+        std::vector<std::string> names;
+        ReplyCallback callback;
+        bool quick;
+        double timeout;
+        int concurrency;
+    };
+    struct Worker {
+        pid_t pid = -1;
+        int socket = -1;
+        int numJobs = 0;
+        std::string buffer; // received data
+        bool running() const { return pid >= 0; }
+        void start(const std::string& probePath);
+        int stop(bool kill = false); // returns the exit status
+    };
+    void threadFunction();
+    void doJob(Worker& worker, Job& job);
+    ProbeReply readReply(Worker& worker, bool first, double timeout);
+
+    std::deque<std::unique_ptr<Job>> jobs_;
+    std::vector<std::thread> threads_;
+    int numIdleThreads_ = 0;
+    int numBusyThreads_ = 0;
+    bool running_ = true;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::string probePath_;
+    static std::mutex spawnMutex_;
+};
+
+std::mutex ProbeWorkerPool::spawnMutex_;
+
+ProbeWorkerPool::~ProbeWorkerPool(){
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cond_.notify_all();
+    for (auto& thread : threads_){
+        if (thread.joinable()){
+            thread.join();
         }
-        std::exit(EXIT_FAILURE);
     }
-    // parent process: wait for child
-    auto wait = [pid](){
-        int status = 0;
-        waitpid(pid, &status, 0);
-        if (WIFEXITED(status)) {
-            return WEXITSTATUS(status);
+}
+
+std::shared_future<ProbeReply> ProbeWorkerPool::push(const std::string& path,
+                                                     const std::string& name,
+                                                     const ProbeOptions& options){
+    auto promise = std::make_shared<std::promise<ProbeReply>>();
+    std::shared_future<ProbeReply> future = promise->get_future().share();
+    push(path, { name }, [promise](int, ProbeReply& reply){
+        promise->set_value(std::move(reply));
+    }, options);
+    return future;
+}
+
+void ProbeWorkerPool::push(const std::string& path, const std::vector<std::string>& names,
+                           ReplyCallback callback, const ProbeOptions& options){
+    std::unique_ptr<Job> job(new Job);
+    job->path = path;
+    job->names = names;
+    job->callback = std::move(callback);
+    job->quick = options.quick;
+    job->timeout = options.getTimeout();
+    job->concurrency = options.getNumParallelProbes();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (probePath_.empty()){
+        probePath_ = getProbePath(); // throws on error
+    }
+    jobs_.push_back(std::move(job));
+    // spawn a new thread if necessary
+    // NB: other searches might have a different concurrency
+    int maxNumThreads = std::max<int>(getNumParallelProbes(), jobs_.back()->concurrency);
+    if ((int)jobs_.size() > numIdleThreads_ && (int)threads_.size() < maxNumThreads){
+        threads_.push_back(std::thread(&ProbeWorkerPool::threadFunction, this));
+    }
+    lock.unlock();
+    cond_.notify_one();
+}
+
+void ProbeWorkerPool::threadFunction(){
+    Worker worker;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_){
+        if (jobs_.empty()){
+            numIdleThreads_++;
+            if (worker.running()){
+                // shut down worker process if we're idle for too long
+                auto timeout = std::chrono::seconds(PROBE_WORKER_TIMEOUT);
+                if (!cond_.wait_for(lock, timeout, [&](){ return !jobs_.empty() || !running_; })){
+                    lock.unlock();
+                    LOG_DEBUG("probe worker " << worker.pid << " idle - shut down");
+                    worker.stop();
+                    lock.lock();
+                }
+            } else {
+                cond_.wait(lock);
+            }
+            numIdleThreads_--;
+        } else if (numBusyThreads_ > 0 &&
+                   (numBusyThreads_ >= jobs_.front()->concurrency || dspLoadTooHigh())){
+            // throttle; check again later
+            cond_.wait_for(lock, std::chrono::milliseconds(100));
         } else {
-            return -1;
+            auto job = std::move(jobs_.front());
+            jobs_.pop_front();
+            numBusyThreads_++;
+            gNumActiveProbes++;
+            lock.unlock();
+
+            doJob(worker, *job);
+
+            lock.lock();
+            numBusyThreads_--;
+            gNumActiveProbes--;
+        }
+    }
+    lock.unlock();
+    if (worker.running()){
+        worker.stop();
+    }
+}
+
+void ProbeWorkerPool::doJob(Worker& worker, Job& job){
+    int numPlugins = job.names.size();
+    auto fail = [&](const ProbeReply& error){
+        for (int i = 0; i < numPlugins; ++i){
+            auto reply = error; // copy!
+            job.callback(i, reply);
         }
     };
-#endif
-    return [desc=std::move(desc), tmpPath=std::move(tmpPath), wait=std::move(wait)](){
-        ProbeResult result;
-        result.plugin = std::move(desc);
-        result.total = 1;
-        auto ret = wait(); // wait for process to finish
-        /// LOG_DEBUG("return code: " << ret);
-        TmpFile file(tmpPath); // removes the file on destruction
-        if (ret == EXIT_SUCCESS) {
-            // get info from temp file
-            if (file.is_open()) {
-                desc->deserialize(file);
+    // recycle worker after too many jobs
+    if (worker.running() && worker.numJobs >= PROBE_WORKER_MAX_JOBS){
+        worker.stop();
+    }
+    // message format: number of plugins (+ optional "quick" flag), plugin path
+    // and plugin names, separated by newlines
+    std::string msg = std::to_string(numPlugins) + (job.quick ? " quick\n" : "\n")
+            + job.path + "\n";
+    for (auto& name : job.names){
+        msg += name + "\n";
+    }
+    // try to send the job; if the worker is dead, we restart it once.
+    for (int i = 0; i < 2; ++i){
+        if (!worker.running()){
+            try {
+                worker.start(probePath_);
+            } catch (const Error& e){
+                fail(makeProbeError(e.code(), e.what()));
+                return;
             }
-            else {
-                result.error = Error(Error::SystemError, "couldn't read temp file!");
+        }
+    #ifdef MSG_NOSIGNAL
+        const int flags = MSG_NOSIGNAL; // avoid SIGPIPE
+    #else
+        const int flags = 0; // see SO_NOSIGPIPE
+    #endif
+        if (send(worker.socket, msg.data(), msg.size(), flags) == (ssize_t)msg.size()){
+            break;
+        } else {
+            LOG_DEBUG("couldn't send job to probe worker " << worker.pid);
+            worker.stop();
+            if (i > 0){
+                fail(makeProbeError(Error::SystemError,
+                                    "couldn't send job to probe process"));
+                return;
             }
         }
-        else if (ret == EXIT_FAILURE) {
-            // get error from temp file
-            if (file.is_open()) {
-                int code;
-                std::string msg;
-                file >> code;
-                if (!file){
-                    // happens in certain cases, e.g. the plugin destructor
-                    // terminates the probe process with exit code 1.
-                    code = (int)Error::UnknownError;
-                }
-                std::getline(file, msg); // skip newline
-                std::getline(file, msg); // read message
-                LOG_DEBUG("code: " << code << ", msg: " << msg);
-                result.error = Error((Error::ErrorCode)code, msg);
+    }
+    worker.numJobs++;
+    bool first = worker.numJobs == 1;
+    // one reply per plugin
+    int index = 0;
+    for (; index < numPlugins; ++index){
+        auto reply = readReply(worker, first && index == 0, job.timeout);
+        bool alive = worker.running();
+        job.callback(index, reply);
+        if (!alive){
+            break;
+        }
+    }
+    // the worker has died, skip the remaining plugins
+    for (++index; index < numPlugins; ++index){
+        ProbeReply reply;
+        reply.status = ProbeAborted;
+        job.callback(index, reply);
+    }
+}
+
+ProbeReply ProbeWorkerPool::readReply(Worker& worker, bool first, double timeout){
+    // wait for reply frame: data size (uint32_t) + exit status (int32_t) + data
+    auto deadline = std::chrono::steady_clock::now()
+            + std::chrono::milliseconds((int64_t)(timeout * 1000.0));
+    const size_t headerSize = sizeof(uint32_t) + sizeof(int32_t);
+    ProbeReply reply;
+    auto& buffer = worker.buffer; // might already contain (parts of) the next frame
+    while (true){
+        if (buffer.size() >= headerSize){
+            uint32_t size;
+            int32_t status;
+            memcpy(&size, &buffer[0], sizeof(size));
+            memcpy(&status, &buffer[sizeof(size)], sizeof(status));
+            size_t frameSize = headerSize + size;
+            if (buffer.size() >= frameSize){
+                reply.status = status;
+                reply.data = buffer.substr(headerSize, size);
+                buffer.erase(0, frameSize);
+                return reply;
             }
-            else {
-                result.error = Error(Error::SystemError, "couldn't read temp file!");
+            buffer.reserve(frameSize);
+        }
+        // poll() also returns when the worker has died and closed its socket
+        int ms = -1; // infinite
+        if (timeout > 0){
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - std::chrono::steady_clock::now()).count();
+            ms = std::max<int64_t>(0, remaining);
+        }
+        pollfd pfd;
+        pfd.fd = worker.socket;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int ret = poll(&pfd, 1, ms);
+        if (ret < 0){
+            if (errno == EINTR){
+                continue;
             }
+            LOG_ERROR("probe worker: poll() failed (" << errorMessage(errno) << ")");
+            worker.stop(true);
+            reply.status = ProbeCrash;
+            return reply;
+        } else if (ret == 0){
+            // the plugin hangs - kill the worker
+            LOG_DEBUG("probe worker " << worker.pid << " timed out");
+            worker.stop(true);
+            reply.status = ProbeTimeout;
+            return reply;
+        }
+        char buf[4096];
+        auto n = read(worker.socket, buf, sizeof(buf));
+        if (n > 0){
+            buffer.append(buf, n);
+        } else if (n < 0 && errno == EINTR){
+            continue;
+        } else {
+            break;
+        }
+    }
+    // the worker has died before sending a complete frame, e.g. because the plugin
+    // crashed or because it called exit() in its constructor or destructor.
+    // NB: this is always abnormal, so we must never pass on the exit status;
+    // EXIT_SUCCESS would make us deserialize an empty plugin description!
+    int status = worker.stop();
+    if (first && status == EXIT_FAILURE){
+        // most likely the probe exe couldn't be executed
+        return makeProbeError(Error::SystemError, "couldn't open probe process");
+    }
+    if (status == ProbeCrash){
+        reply.status = ProbeCrash;
+        return reply;
+    }
+    return makeProbeError(Error::Crash, "probe process exited unexpectedly (exit code "
+                          + std::to_string(status) + ")");
+}
+
+void ProbeWorkerPool::Worker::start(const std::string& probePath){
+    int fd[2];
+    // prevent other pool threads from inheriting our sockets!
+    std::lock_guard<std::mutex> lock(spawnMutex_);
+#ifdef SOCK_CLOEXEC
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fd) != 0){
+#else
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fd) != 0){
+#endif
+        throw Error(Error::SystemError, "socketpair() failed: " + errorMessage(errno));
+    }
+#ifndef SOCK_CLOEXEC
+    fcntl(fd[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fd[1], F_SETFD, FD_CLOEXEC);
+#endif
+#ifdef SO_NOSIGPIPE
+    int set = 1;
+    setsockopt(fd[0], SOL_SOCKET, SO_NOSIGPIPE, &set, sizeof(set));
+#endif
+    // Use posix_spawn() instead of fork() + exec(): fork() has to copy the page tables
+    // of the host process (which can be huge), while posix_spawn() typically uses vfork()
+    // or clone() semantics. The child socket is dup'ed to a fixed file descriptor,
+    // which clears FD_CLOEXEC so that it survives exec().
+    int childFd = (fd[1] == 3) ? 4 : 3;
+    auto fdString = std::to_string(childFd);
+    const char *argv[] = { "probe", "-w", fdString.c_str(), nullptr };
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+#if !PROBE_LOG
+    // disable stdout and stderr
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+#endif
+    posix_spawn_file_actions_adddup2(&actions, fd[1], childFd);
+    // don't inherit the signal mask of the calling thread
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t mask;
+    sigemptyset(&mask);
+    posix_spawnattr_setsigmask(&attr, &mask);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+
+    pid_t child;
+    int err = posix_spawn(&child, probePath.c_str(), &actions, &attr,
+                          (char * const *)argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    if (err != 0){
+        close(fd[0]);
+        close(fd[1]);
+        throw Error(Error::SystemError, "couldn't open probe process ("
+                    + errorMessage(err) + ")");
+    }
+    // parent process
+    close(fd[1]);
+    pid = child;
+    socket = fd[0];
+    numJobs = 0;
+    buffer.clear();
+    LOG_DEBUG("started probe worker " << pid);
+}
+
+int ProbeWorkerPool::Worker::stop(bool kill){
+    if (kill){
+        ::kill(pid, SIGKILL);
+    }
+    // closing the socket tells the worker to quit
+    close(socket);
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) ;
+    LOG_DEBUG("stopped probe worker " << pid);
+    pid = -1;
+    socket = -1;
+    numJobs = 0;
+    buffer.clear();
+    if (WIFEXITED(status)) {
+        return WEXITSTATUS(status);
+    } else {
+        return ProbeCrash;
+    }
+}
+#endif
+
+// get the plugin info resp. the error from a probe reply
+static void parseProbeReply(const ProbeReply& reply, ProbeResult& result,
+                            double timeout){
+    std::stringstream stream(reply.data);
+    if (reply.status == EXIT_SUCCESS) {
+        // get plugin info
+        result.plugin->deserialize(stream);
+    }
+    else if (reply.status == EXIT_FAILURE) {
+        // get error code and message
+        int code;
+        std::string msg;
+        stream >> code;
+        if (!stream){
+            // happens in certain cases, e.g. the plugin destructor
+            // terminates the probe process with exit code 1.
+            code = (int)Error::UnknownError;
         }
-        else {
-            // ignore temp file
-            result.error = Error(Error::Crash);
+        std::getline(stream, msg); // skip newline
+        std::getline(stream, msg); // read message
+        LOG_DEBUG("code: " << code << ", msg: " << msg);
+        result.error = Error((Error::ErrorCode)code, msg);
+    }
+    else if (reply.status == ProbeTimeout) {
+        std::stringstream ss;
+        ss << "timed out after " << timeout << " seconds";
+        result.error = Error(Error::Timeout, ss.str());
+    }
+    else {
+        result.error = Error(Error::Crash);
+    }
+}
+
+// probe a plugin in a seperate process and return the info in a file
+IFactory::ProbeResultFuture IFactory::probePlugin(const std::string& name,
+                                                  int shellPluginID,
+                                                  const ProbeOptions& options) {
+    auto desc = std::make_shared<PluginInfo>(shared_from_this());
+    // put the information we already have (might be overriden)
+    desc->name = name;
+    desc->path = path();
+    // we pass the shell plugin ID instead of the name to probe.exe
+    std::string pluginName = shellPluginID ? std::to_string(shellPluginID) : name;
+#ifdef _WIN32
+    // create temp file path
+    std::stringstream ss;
+    ss << "/vst_" << desc.get(); // desc address should be unique as long as PluginInfos are retained.
+    std::string tmpPath = getTmpDirectory() + ss.str();
+    // LOG_DEBUG("temp path: " << tmpPath);
+    // get full path to probe exe
+    std::wstring probePath = getModuleDirectory() + L"\\probe.exe";
+    /// LOG_DEBUG("probe path: " << shorten(probePath));
+    // on Windows we need to quote the arguments for _spawn to handle spaces in file names.
+    std::stringstream cmdLineStream;
+    cmdLineStream << "probe.exe " << (options.quick ? "-q " : "")
+            << "\"" << path() << "\" "
+            << "\"" << pluginName << "\" "
+            << "\"" << tmpPath + "\"";
+    auto cmdLine = widen(cmdLineStream.str());
+    // throttle new probe processes while the DSP load is high
+    while (dspLoadTooHigh()){
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    STARTUPINFOW si;
+    PROCESS_INFORMATION pi;
+    ZeroMemory(&si, sizeof(si));
+    si.cb = sizeof(si);
+    ZeroMemory(&pi, sizeof(pi));
+
+    if (!CreateProcessW(probePath.c_str(), &cmdLine[0], NULL, NULL,
+                        PROBE_LOG, DETACHED_PROCESS, NULL, NULL, &si, &pi)){
+        auto err = GetLastError();
+        std::stringstream ss;
+        ss << "couldn't open probe process (" << errorMessage(err) << ")";
+        throw Error(Error::SystemError, ss.str());
+    }
+    auto timeout = options.getTimeout();
+    auto wait = [pi, tmpPath, timeout](){
+        ProbeReply reply;
+        auto ret = WaitForSingleObject(pi.hProcess,
+                                       timeout > 0 ? timeout * 1000.0 : INFINITE);
+        if (ret == WAIT_TIMEOUT){
+            TerminateProcess(pi.hProcess, EXIT_FAILURE);
+            WaitForSingleObject(pi.hProcess, INFINITE);
+            CloseHandle(pi.hProcess);
+            CloseHandle(pi.hThread);
+            removeFile(tmpPath);
+            reply.status = ProbeTimeout;
+            return reply;
+        } else if (ret != 0){
+            throw Error(Error::SystemError, "couldn't wait for probe process!");
+        }
+        DWORD code = -1;
+        if (!GetExitCodeProcess(pi.hProcess, &code)){
+            throw Error(Error::SystemError, "couldn't retrieve exit code for probe process!");
         }
+        CloseHandle(pi.hProcess);
+        CloseHandle(pi.hThread);
+        reply.status = code;
+        // get the result from the temp file
+        TmpFile file(tmpPath); // removes the file on destruction
+        if (file.is_open()){
+            std::stringstream ss;
+            ss << file.rdbuf();
+            reply.data = ss.str();
+        } else if (code == EXIT_SUCCESS || code == EXIT_FAILURE){
+            return makeProbeError(Error::SystemError, "couldn't read temp file!");
+        }
+        return reply;
+    };
+#else // Unix
+    // hand the job to a (persistent) worker process, see ProbeWorkerPool
+    auto future = ProbeWorkerPool::instance().push(path(), pluginName, options);
+    auto wait = [future](){
+        return future.get();
+    };
+    auto timeout = options.getTimeout();
+#endif
+    return [desc=std::move(desc), wait=std::move(wait), timeout](){
+        ProbeResult result;
+        result.plugin = std::move(desc);
+        result.total = 1;
+        auto reply = wait(); // wait for process to finish
+        /// LOG_DEBUG("return code: " << reply.status);
+        parseProbeReply(reply, result, timeout);
         return result;
     };
 }
@@ -1378,8 +2444,8 @@ IFactory::ProbeResultFuture IFactory::probePlugin(const std::string& name, int s
 // We probe sub-plugins asynchronously with "futures" or worker threads.
 // The latter are just wrappers around futures, but we can gather results as soon as they are available.
 // Both methods are about equally fast, the worker threads just look more responsive.
-#define PROBE_FUTURES 8 // number of futures to wait for
-#define PROBE_THREADS 8 // number of worker threads (0: use futures instead of threads)
+// The number of futures resp. threads is given by ProbeOptions::getNumParallelProbes().
+#define PROBE_THREADS 1 // use worker threads (0: use futures instead of threads)
 
 #if 0
 static std::mutex gLogMutex;
@@ -1388,31 +2454,137 @@ static std::mutex gLogMutex;
 #define DEBUG_THREAD(x)
 #endif
 
+#ifndef _WIN32
+#define PROBE_BATCH 1 // probe sub-plugins in batches (see probeBatch())
+#else
+#define PROBE_BATCH 0 // the Windows probe process can only handle a single plugin
+#endif
+
+#if PROBE_BATCH
+// Loading a module can take a long time (think of Waves shell plugins), so we don't
+// want every sub-plugin to load it again. Instead, the sub-plugins are split into
+// ProbeOptions::getNumParallelProbes() contiguous batches and each batch is probed by a single
+// worker process which loads the module only once.
+// If a worker crashes, the affected plugins and the rest of its batch are returned
+// in 'remaining', so that they can be probed one by one.
+static void probeBatch(IFactory& factory,
+                       const std::vector<std::pair<std::string, int>>& pluginList, int numPlugins,
+                       const std::function<void(ProbeResult&)>& fn, std::vector<int>& remaining,
+                       const ProbeOptions& options)
+{
+    struct Item {
+        int index;
+        ProbeReply reply;
+    };
+    std::deque<Item> replies;
+    std::mutex mutex;
+    std::condition_variable cond;
+    int numPending = 0;
+
+    int numBatches = std::min<int>(numPlugins, options.getNumParallelProbes());
+    int batchSize = (numPlugins + numBatches - 1) / numBatches;
+    for (int onset = 0; onset < numPlugins; onset += batchSize){
+        int n = std::min<int>(batchSize, numPlugins - onset);
+        std::vector<std::string> names;
+        for (int i = onset; i < onset + n; ++i){
+            auto& name = pluginList[i].first;
+            auto& id = pluginList[i].second;
+            // we pass the shell plugin ID instead of the name to probe.exe
+            names.push_back(id ? std::to_string(id) : name);
+        }
+        try {
+            ProbeWorkerPool::instance().push(factory.path(), names,
+                                             [&, onset](int index, ProbeReply& reply){
+                std::lock_guard<std::mutex> lock(mutex);
+                replies.push_back(Item { onset + index, std::move(reply) });
+                cond.notify_one();
+            }, options);
+            numPending += n;
+        } catch (const Error& e){
+            LOG_DEBUG("couldn't probe batch: " << e.what());
+            for (int i = onset; i < onset + n; ++i){
+                remaining.push_back(i);
+            }
+        }
+    }
+    // collect results
+    std::unique_lock<std::mutex> lock(mutex);
+    while (numPending > 0){
+        cond.wait(lock, [&](){ return !replies.empty(); });
+        auto item = std::move(replies.front());
+        replies.pop_front();
+        numPending--;
+        lock.unlock();
+
+        auto status = item.reply.status;
+        if (status == EXIT_SUCCESS || status == EXIT_FAILURE || status == ProbeTimeout){
+            ProbeResult result;
+            result.plugin = std::make_shared<PluginInfo>(factory.shared_from_this());
+            result.plugin->name = pluginList[item.index].first;
+            result.plugin->path = factory.path();
+            parseProbeReply(item.reply, result, options.getTimeout());
+            fn(result);
+        } else {
+            // the crash might have been caused by a previous plugin,
+            // so we probe it again in its own process.
+            DEBUG_THREAD("batch aborted at " << pluginList[item.index].first);
+            remaining.push_back(item.index);
+        }
+
+        lock.lock();
+    }
+    std::sort(remaining.begin(), remaining.end());
+}
+#endif
+
 std::vector<PluginInfo::ptr> IFactory::probePlugins(
-        const ProbeList& pluginList, ProbeCallback callback){
+        const ProbeList& pluginList, ProbeCallback callback, const ProbeOptions& options){
     // shell plugin!
     int numPlugins = pluginList.size();
     std::vector<PluginInfo::ptr> results;
 #ifdef PLUGIN_LIMIT
     numPlugins = std::min<int>(numPlugins, PLUGIN_LIMIT);
 #endif
+    int count = 0;
+    auto addResult = [&](ProbeResult& result){
+        result.index = count++;
+        result.total = numPlugins;
+        if (result.valid()) {
+            results.push_back(result.plugin);
+            DEBUG_THREAD("got plugin " << result.plugin->name
+                << " (" << (result.index + 1) << " of " << numPlugins << ")");
+        }
+        if (callback){
+            callback(result);
+        }
+    };
+    // plugins which have to be probed one by one
+    std::vector<int> pending;
+#if PROBE_BATCH
+    probeBatch(*this, pluginList, numPlugins, addResult, pending, options);
+#else
+    for (int i = 0; i < numPlugins; ++i){
+        pending.push_back(i);
+    }
+#endif
+    int numPending = pending.size();
 #if !PROBE_THREADS
-    /// LOG_DEBUG("numPlugins: " << numPlugins);
-    std::vector<std::pair<int, ProbeResultFuture>> futures;
+    /// LOG_DEBUG("numPending: " << numPending);
+    std::vector<ProbeResultFuture> futures;
     int i = 0;
-    while (i < numPlugins){
+    while (i < numPending){
         futures.clear();
         // probe the next n plugins
-        int n = std::min<int>(numPlugins - i, PROBE_FUTURES);
+        int n = std::min<int>(numPending - i, options.getNumParallelProbes());
         for (int j = 0; j < n; ++j, ++i){
-            auto& name = pluginList[i].first;
-            auto& id = pluginList[i].second;
+            auto& name = pluginList[pending[i]].first;
+            auto& id = pluginList[pending[i]].second;
             /// LOG_DEBUG("probing '" << name << "'");
             try {
-                futures.emplace_back(i, probePlugin(name, id));
+                futures.push_back(probePlugin(name, id, options));
             } catch (const Error& e){
                 // return error future
-                futures.emplace_back(i, [=](){
+                futures.push_back([=](){
                     ProbeResult result;
                     result.error = e;
                     return result;
@@ -1420,43 +2592,36 @@ std::vector<PluginInfo::ptr> IFactory::probePlugins(
             }
         }
         // collect results
-        for (auto& it : futures) {
-            auto result = it.second(); // wait on future
-            result.index = it.first;
-            result.total = numPlugins;
-            if (result.valid()) {
-                results.push_back(result.plugin);
-            }
-            if (callback){
-                callback(result);
-            }
+        for (auto& f : futures) {
+            auto result = f(); // wait on future
+            addResult(result);
         }
     }
 #else
-    DEBUG_THREAD("numPlugins: " << numPlugins);
+    DEBUG_THREAD("numPending: " << numPending);
     std::vector<ProbeResult> probeResults;
     int head = 0;
     int tail = 0;
 
     std::mutex mutex;
     std::condition_variable cond;
-    int numThreads = std::min<int>(numPlugins, PROBE_THREADS);
+    int numThreads = std::min<int>(numPending, options.getNumParallelProbes());
     std::vector<std::thread> threads;
 
     // thread function
     auto threadFun = [&](int i){
         DEBUG_THREAD("worker thread " << i << " started");
         std::unique_lock<std::mutex> lock(mutex);
-        while (head < numPlugins){
-            auto& name = pluginList[head].first;
-            auto& id = pluginList[head].second;
+        while (head < numPending){
+            auto& name = pluginList[pending[head]].first;
+            auto& id = pluginList[pending[head]].second;
             head++;
             lock.unlock();
 
             DEBUG_THREAD("thread " << i << ": probing '" << name << "'");
             ProbeResult result;
             try {
-                result = probePlugin(name, id)(); // call future
+                result = probePlugin(name, id, options)(); // call future
             } catch (const Error& e){
                 DEBUG_THREAD("probe error " << e.what());
                 result.error = e;
@@ -1479,24 +2644,15 @@ std::vector<PluginInfo::ptr> IFactory::probePlugins(
     while (true) {
         // process available data
         while (tail < (int)probeResults.size()){
-            auto result = probeResults[tail]; // copy!
+            auto result = probeResults[tail++]; // copy!
             lock.unlock();
 
-            result.index = tail++;
-            result.total = numPlugins;
-            if (result.valid()) {
-                results.push_back(result.plugin);
-                DEBUG_THREAD("got plugin " << result.plugin->name
-                    << " (" << (result.index + 1) << " of " << numPlugins << ")");
-            }
-            if (callback){
-                callback(result);
-            }
+            addResult(result);
 
             lock.lock();
         }
         // wait for more data if needed
-        if ((int)probeResults.size() < numPlugins){
+        if ((int)probeResults.size() < numPending){
             DEBUG_THREAD("wait...");
             cond.wait(lock);
         } else {
@@ -1517,8 +2673,65 @@ std::vector<PluginInfo::ptr> IFactory::probePlugins(
     return results;
 }
 
-void IFactory::probe(ProbeCallback callback){
-    probeAsync()(std::move(callback));
+PluginList::const_ptr PluginList::make(std::vector<PluginInfo::ptr> plugins){
+    auto list = std::make_shared<PluginList>();
+    for (auto& desc : plugins){
+        list->map[desc->name] = desc;
+    }
+    list->plugins = std::move(plugins);
+    return list;
+}
+
+PluginList::const_ptr PluginList::add(PluginInfo::ptr desc) const {
+    auto list = std::make_shared<PluginList>(*this);
+    auto it = list->map.find(desc->name);
+    if (it == list->map.end()){
+        list->plugins.push_back(desc);
+        list->map[desc->name] = desc;
+    } else {
+        // replace existing plugin info, e.g. after a full probe (see IFactory::probeFull())
+        std::replace(list->plugins.begin(), list->plugins.end(), it->second, desc);
+        it->second = desc;
+    }
+    return list;
+}
+
+PluginInfo::ptr PluginList::find(const std::string& name) const {
+    auto it = map.find(name);
+    return it != map.end() ? it->second : nullptr;
+}
+
+void IFactory::probe(ProbeCallback callback, const ProbeOptions& options){
+    probeAsync(options)(std::move(callback));
+}
+
+PluginInfo::ptr IFactory::probeFull(const PluginInfo& desc, const ProbeOptions& _options){
+    auto options = _options;
+    options.quick = false;
+    ProbeResultFuture future;
+    if (desc.type() == PluginType::VST2){
+        // shell sub-plugins are probed by their ID, other VST2 plugins
+        // don't need a name (see VST2Factory::probeAsync())
+        if (numPlugins() > 1){
+            future = probePlugin(desc.name, desc.getUniqueID(), options);
+        } else {
+            future = probePlugin("", 0, options);
+        }
+    } else {
+        future = probePlugin(desc.name, 0, options);
+    }
+    auto result = future(); // wait for result
+    if (!result.valid()){
+        throw result.error;
+    }
+    auto plugin = result.plugin;
+    if (plugin->isPartial()){
+        // shouldn't happen...
+        throw Error(Error::PluginError, "couldn't probe plugin parameters");
+    }
+    plugin->setFactory(shared_from_this());
+    plugin->path = path();
+    return plugin;
 }
 
 /*////////////////////// preset ///////////////////////*/
@@ -1596,16 +2809,385 @@ static std::string getPresetLocation(PresetType presetType, PluginType pluginTyp
 #endif
 }
 
+/*///////////////////// ParamTableCache /////////////////////*/
+
+#define PARAM_TABLE_BUDGET (16 * 1024 * 1024)
+
+// keeps track of lazily loaded parameter/program tables (in LRU order)
+// and evicts unpinned tables when the memory budget is exceeded.
+class ParamTableCache {
+ public:
+    static ParamTableCache& instance(){
+        // leaked on purpose, because PluginInfo objects might outlive static objects
+        static ParamTableCache *cache = new ParamTableCache();
+        return *cache;
+    }
+    const PluginInfo::Tables& load(const PluginInfo& info);
+    PluginInfo::TablePtr pin(const PluginInfo& info);
+    void detach(PluginInfo& info);
+    void remove(const PluginInfo& info);
+    void setBudget(size_t bytes){
+        budget_.store(bytes);
+    }
+    size_t getBudget() const {
+        return budget_.load();
+    }
+ private:
+    void doLoad(const PluginInfo& info);
+    void evict(const PluginInfo& keep);
+    void pushFront(const PluginInfo& info);
+    void unlink(const PluginInfo& info);
+    std::mutex mutex_;
+    const PluginInfo *head_ = nullptr; // most recently used
+    const PluginInfo *tail_ = nullptr; // least recently used
+    size_t used_ = 0;
+    std::atomic<size_t> budget_{PARAM_TABLE_BUDGET};
+};
+
+const PluginInfo::Tables& ParamTableCache::load(const PluginInfo& info){
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!info.tables_){
+        doLoad(info);
+    } else {
+        unlink(info);
+        pushFront(info);
+    }
+    return *info.tables_;
+}
+
+PluginInfo::TablePtr ParamTableCache::pin(const PluginInfo& info){
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!info.tables_){
+        doLoad(info);
+    } else {
+        unlink(info);
+        pushFront(info);
+    }
+    return info.tables_;
+}
+
+void ParamTableCache::detach(PluginInfo& info){
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!info.tables_){
+        auto tables = std::make_shared<PluginInfo::Tables>();
+        info.tableLoader_(*tables);
+        info.tables_ = tables;
+        info.currentTables_.store(tables.get(), std::memory_order_release);
+    } else {
+        unlink(info);
+        used_ -= info.tableSize_;
+    }
+    info.tableLoader_ = nullptr;
+}
+
+void ParamTableCache::remove(const PluginInfo& info){
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (info.tables_){
+        unlink(info);
+        used_ -= info.tableSize_;
+    }
+}
+
+void ParamTableCache::doLoad(const PluginInfo& info){
+    auto tables = std::make_shared<PluginInfo::Tables>();
+    info.tableLoader_(*tables);
+    info.tableSize_ = tables->memoryUsage();
+    info.tables_ = tables;
+    info.currentTables_.store(tables.get(), std::memory_order_release);
+    pushFront(info);
+    used_ += info.tableSize_;
+    LOG_DEBUG("loaded parameter tables for " << info.name
+              << " (" << info.tableSize_ << " bytes, total: " << used_ << " bytes)");
+    evict(info);
+}
+
+void ParamTableCache::evict(const PluginInfo& keep){
+    auto budget = budget_.load();
+    auto info = tail_;
+    while (used_ > budget && info){
+        auto prev = info->lruPrev_;
+        // skip pinned tables
+        if (info != &keep && info->tables_.use_count() == 1){
+            LOG_DEBUG("evict parameter tables for " << info->name);
+            unlink(*info);
+            used_ -= info->tableSize_;
+            info->currentTables_.store(nullptr, std::memory_order_release);
+            info->tables_ = nullptr;
+        }
+        info = prev;
+    }
+}
+
+void ParamTableCache::pushFront(const PluginInfo& info){
+    info.lruPrev_ = nullptr;
+    info.lruNext_ = head_;
+    if (head_){
+        head_->lruPrev_ = &info;
+    } else {
+        tail_ = &info;
+    }
+    head_ = &info;
+}
+
+void ParamTableCache::unlink(const PluginInfo& info){
+    if (info.lruPrev_){
+        info.lruPrev_->lruNext_ = info.lruNext_;
+    } else if (head_ == &info){
+        head_ = info.lruNext_;
+    }
+    if (info.lruNext_){
+        info.lruNext_->lruPrev_ = info.lruPrev_;
+    } else if (tail_ == &info){
+        tail_ = info.lruPrev_;
+    }
+    info.lruPrev_ = info.lruNext_ = nullptr;
+}
+
+void setParamTableBudget(size_t bytes){
+    ParamTableCache::instance().setBudget(bytes);
+}
+
+size_t getParamTableBudget(){
+    return ParamTableCache::instance().getBudget();
+}
+
+/*///////////////////// InternedString /////////////////////*/
+
+// The entries are reference counted (see InternedString). The last reference is always
+// released with the mutex locked, so intern() can't resurrect an entry which is about
+// to be deleted. The map keys point to the entry strings.
+class StringPool {
+ public:
+    using Entry = InternedString::Entry;
+
+    static StringPool& instance(){
+        // never destroyed, so we can safely release strings in static destructors
+        static StringPool *pool = new StringPool();
+        return *pool;
+    }
+    Entry * intern(const std::string& s){
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = map_.find(&s);
+        if (it != map_.end()){
+            it->second->refcount.fetch_add(1, std::memory_order_relaxed);
+            return it->second;
+        }
+        auto entry = new Entry(s);
+        map_.emplace(&entry->str, entry);
+        size_ += entry->str.capacity();
+        return entry;
+    }
+    void release(Entry *entry){
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (entry->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1){
+            map_.erase(&entry->str);
+            size_ -= entry->str.capacity();
+            delete entry;
+        }
+    }
+    size_t count(){
+        std::lock_guard<std::mutex> lock(mutex_);
+        return map_.size();
+    }
+    size_t size(){
+        std::lock_guard<std::mutex> lock(mutex_);
+        return size_;
+    }
+ private:
+    struct Hash {
+        size_t operator()(const std::string *s) const {
+            return std::hash<std::string>()(*s);
+        }
+    };
+    struct Equal {
+        bool operator()(const std::string *a, const std::string *b) const {
+            return *a == *b;
+        }
+    };
+    std::unordered_map<const std::string *, Entry *, Hash, Equal> map_;
+    size_t size_ = 0;
+    std::mutex mutex_;
+};
+
+InternedString::Entry * InternedString::intern(const std::string& s){
+    if (s.empty()){
+        return nullptr;
+    }
+    return StringPool::instance().intern(s);
+}
+
+void InternedString::releaseLast(Entry *e){
+    StringPool::instance().release(e);
+}
+
+const std::string& InternedString::emptyString(){
+    static const std::string empty;
+    return empty;
+}
+
+size_t InternedString::poolCount(){
+    return StringPool::instance().count();
+}
+
+size_t InternedString::poolSize(){
+    return StringPool::instance().size();
+}
+
 /*///////////////////// PluginInfo /////////////////////*/
 
 PluginInfo::PluginInfo(const std::shared_ptr<const IFactory>& factory)
     : path(factory->path()), factory_(factory) {}
 
+PluginInfo::~PluginInfo(){
+    if (tableLoader_){
+        ParamTableCache::instance().remove(*this);
+    }
+}
+
 IPlugin::ptr PluginInfo::create() const {
     std::shared_ptr<const IFactory> factory = factory_.lock();
     return factory ? factory->create(name) : nullptr;
 }
 
+void PluginInfo::Tables::addParameter(Param param){
+    auto index = parameters.size();
+    // inverse mapping
+    paramMap[param.name] = index;
+#if USE_VST3
+    // index -> ID mapping
+    paramIDs.push_back(param.id);
+    // ID -> index mapping
+    // keep the load factor below 50% so that the lookups stay short.
+    if (paramIDs.size() * 2 > idToIndex.size()){
+        auto old = std::move(idToIndex);
+        size_t size = 16;
+        idToIndexShift = 28;
+        while (size < paramIDs.size() * 2){
+            size *= 2;
+            idToIndexShift--;
+        }
+        idToIndex.assign(size, ParamIndex{});
+        for (auto& slot : old){
+            if (slot.index >= 0){
+                addParamIndex(slot.id, slot.index);
+            }
+        }
+    }
+    addParamIndex(param.id, index);
+#endif
+    // add parameter
+    parameters.push_back(std::move(param));
+}
+
+#if USE_VST3
+void PluginInfo::Tables::addParamIndex(uint32_t id, int index){
+    auto mask = idToIndex.size() - 1;
+    for (auto i = hashParamID(id); ; i = (i + 1) & mask){
+        auto& slot = idToIndex[i];
+        if (slot.index < 0 || slot.id == id){
+            // empty slot or duplicate ID (the last one wins)
+            slot.id = id;
+            slot.index = index;
+            return;
+        }
+    }
+}
+#endif
+
+void PluginInfo::Tables::clearParameters(){
+    parameters.clear();
+    paramMap.clear();
+#if USE_VST3
+    paramIDs.clear();
+    idToIndex.clear();
+    idToIndexShift = 28;
+#endif
+}
+
+size_t PluginInfo::Tables::memoryUsage() const {
+    // rough estimate; hash table nodes have (at least) a 'next' pointer and the cached hash.
+    const size_t nodeSize = 2 * sizeof(void *);
+    size_t size = sizeof(Tables);
+    // parameter names and labels are pooled (see InternedString)
+    size += parameters.capacity() * sizeof(Param);
+    size += programs.capacity() * sizeof(std::string);
+    for (auto& pgm : programs){
+        size += pgm.capacity();
+    }
+    size += paramMap.bucket_count() * sizeof(void *);
+    for (auto& it : paramMap){
+        size += nodeSize + sizeof(it) + it.first.capacity();
+    }
+#if USE_VST3
+    size += paramIDs.capacity() * sizeof(uint32_t);
+    size += idToIndex.capacity() * sizeof(ParamIndex);
+#endif
+    return size;
+}
+
+void PluginInfo::setTableLoader(TableLoader loader){
+    if (tableLoader_){
+        ParamTableCache::instance().remove(*this);
+    }
+    currentTables_.store(nullptr);
+    tables_ = nullptr;
+    tableLoader_ = std::move(loader);
+}
+
+void PluginInfo::addParamAlias(int index, const std::string& key){
+    std::lock_guard<std::mutex> lock(aliasMutex_);
+    paramAliases_[key] = index;
+}
+
+int PluginInfo::findParam(const std::string& key) const {
+    {
+        auto tables = pinTables();
+        auto it = tables->paramMap.find(key);
+        if (it != tables->paramMap.end()){
+            return it->second;
+        }
+    }
+    std::lock_guard<std::mutex> lock(aliasMutex_);
+    auto it = paramAliases_.find(key);
+    if (it != paramAliases_.end()){
+        return it->second;
+    } else {
+        return -1;
+    }
+}
+
+PluginInfo::TablePtr PluginInfo::pinTables() const {
+    if (tableLoader_){
+        return ParamTableCache::instance().pin(*this);
+    } else if (tables_){
+        return tables_;
+    } else {
+        return std::make_shared<Tables>();
+    }
+}
+
+const PluginInfo::Tables& PluginInfo::loadTables() const {
+    if (tableLoader_){
+        return ParamTableCache::instance().load(*this);
+    } else {
+        // no parameters/programs
+        static const Tables empty;
+        return empty;
+    }
+}
+
+PluginInfo::Tables& PluginInfo::mutableTables(){
+    if (tableLoader_){
+        // make tables resident
+        ParamTableCache::instance().detach(*this);
+    }
+    if (!tables_){
+        tables_ = std::make_shared<Tables>();
+        currentTables_.store(tables_.get(), std::memory_order_release);
+    }
+    return *tables_;
+}
+
 void PluginInfo::setUniqueID(int _id){
     type_ = PluginType::VST2;
     char buf[9];
@@ -1639,6 +3221,18 @@ static void conformPath(std::string& path){
 }
 
 void PluginInfo::scanPresets(){
+    std::lock_guard<std::mutex> lock(presetMutex_);
+    presetFolders_.clear();
+    updatePresets();
+}
+
+std::shared_ptr<const PresetList> PluginInfo::presets() const {
+    std::lock_guard<std::mutex> lock(presetMutex_);
+    updatePresets();
+    return presets_;
+}
+
+void PluginInfo::updatePresets() const {
     const std::vector<PresetType> presetTypes = {
 #if defined(_WIN32)
         PresetType::User, PresetType::UserFactory, PresetType::SharedFactory
@@ -1648,37 +3242,74 @@ void PluginInfo::scanPresets(){
         PresetType::User, PresetType::SharedFactory, PresetType::Global
 #endif
     };
-    PresetList results;
-    for (auto& presetType : presetTypes){
-        auto folder = getPresetFolder(presetType);
-        if (pathExists(folder)){
-            vst::search(folder, [&](const std::string& path){
+    bool first = presetFolders_.empty();
+    bool changed = first;
+    if (first){
+        for (auto& presetType : presetTypes){
+            PresetFolder folder;
+            folder.type = presetType;
+            presetFolders_.push_back(std::move(folder));
+        }
+    }
+    // only rescan folders which have been modified since the last scan.
+    // NB: adding or removing a preset file changes the folder's mtime.
+    for (auto& folder : presetFolders_){
+        auto path = getPresetFolder(folder.type);
+        FileInfo info;
+        bool exists = !path.empty() && getFileInfo(path, info);
+        if (exists == folder.exists && (!exists || info.mtime == folder.mtime) && !first){
+            continue;
+        }
+        folder.exists = exists;
+        folder.mtime = info.mtime;
+        folder.presets.clear();
+        if (exists){
+            vst::search(path, [&](const std::string& path){
                 auto ext = fileExtension(path);
                 if ((type_ == PluginType::VST3 && ext != "vstpreset") ||
                     (type_ == PluginType::VST2 && ext != "fxp" && ext != "FXP")){
                     return;
                 }
                 Preset preset;
-                preset.type = presetType;
+                preset.type = folder.type;
                 preset.name = fileBaseName(path);
                 preset.path = path;
             #ifdef _WIN32
                 conformPath(preset.path);
             #endif
-                results.push_back(std::move(preset));
+                folder.presets.push_back(std::move(preset));
             }, false);
         }
+        LOG_DEBUG("scanned preset folder " << path);
+        changed = true;
     }
-    presets = std::move(results);
-    sortPresets(false);
-#if 0
-    if (numPresets()){
-        LOG_VERBOSE("presets:");
-        for (auto& preset : presets){
-            LOG_VERBOSE("\t" << preset.path);
+    if (changed){
+        auto presets = std::make_shared<PresetList>();
+        for (auto& folder : presetFolders_){
+            presets->insert(presets->end(), folder.presets.begin(), folder.presets.end());
         }
+        sortPresets(*presets, false);
+        presets_ = std::move(presets);
     }
-#endif
+}
+
+// replace the preset list after adding, removing or renaming a user preset.
+// the cached user folder must be kept in sync, otherwise the change would be lost
+// when another folder is rescanned.
+void PluginInfo::setPresets(std::shared_ptr<const PresetList> presets) const {
+    for (auto& folder : presetFolders_){
+        if (folder.type == PresetType::User){
+            folder.presets.clear();
+            for (auto& preset : *presets){
+                if (preset.type != PresetType::User){
+                    break; // user presets come first
+                }
+                folder.presets.push_back(preset);
+            }
+            break;
+        }
+    }
+    presets_ = std::move(presets);
 }
 
 bool stringCompare(const std::string& lhs, const std::string& rhs){
@@ -1687,8 +3318,7 @@ bool stringCompare(const std::string& lhs, const std::string& rhs){
     );
 }
 
-void PluginInfo::sortPresets(bool userOnly){
-    // don't lock! private method
+void PluginInfo::sortPresets(PresetList& presets, bool userOnly) {
     auto it1 = presets.begin();
     auto it2 = it1;
     if (userOnly){
@@ -1703,8 +3333,9 @@ void PluginInfo::sortPresets(bool userOnly){
 }
 
 int PluginInfo::findPreset(const std::string &name) const {
-    for (int i = 0; i < presets.size(); ++i){
-        if (presets[i].name == name){
+    auto presets = this->presets();
+    for (int i = 0; i < presets->size(); ++i){
+        if ((*presets)[i].name == name){
             return i;
         }
     }
@@ -1712,24 +3343,33 @@ int PluginInfo::findPreset(const std::string &name) const {
 }
 
 bool PluginInfo::removePreset(int index, bool del){
+    std::lock_guard<std::mutex> lock(presetMutex_);
+    updatePresets();
+    auto& presets = *presets_;
     if (index >= 0 && index < presets.size()
             && presets[index].type == PresetType::User
             && (!del || removeFile(presets[index].path))){
-        presets.erase(presets.begin() + index);
+        auto result = std::make_shared<PresetList>(presets);
+        result->erase(result->begin() + index);
+        setPresets(std::move(result));
         return true;
     }
     return false;
 }
 
 bool PluginInfo::renamePreset(int index, const std::string& newName){
-    // make preset before creating the lock!
+    std::lock_guard<std::mutex> lock(presetMutex_);
+    updatePresets();
+    auto& presets = *presets_;
     if (index >= 0 && index < presets.size()
             && presets[index].type == PresetType::User){
         auto preset = makePreset(newName);
         if (!preset.name.empty()){
             if (renameFile(presets[index].path, preset.path)){
-                presets[index] = std::move(preset);
-                sortPresets();
+                auto result = std::make_shared<PresetList>(presets);
+                (*result)[index] = std::move(preset);
+                sortPresets(*result);
+                setPresets(std::move(result));
                 return true;
             }
         }
@@ -1759,21 +3399,27 @@ static std::string bashPath(std::string path){
 }
 
 int PluginInfo::addPreset(Preset preset) {
-    auto it = presets.begin();
+    std::lock_guard<std::mutex> lock(presetMutex_);
+    updatePresets();
+    auto presets = std::make_shared<PresetList>(*presets_);
+    auto it = presets->begin();
     // insert lexicographically
-    while (it != presets.end() && it->type == PresetType::User){
+    while (it != presets->end() && it->type == PresetType::User){
         if (preset.name == it->name){
             // replace
             *it = std::move(preset);
-            return (int)(it - presets.begin());
+            int index = (int)(it - presets->begin());
+            setPresets(std::move(presets));
+            return index;
         }
         if (stringCompare(preset.name, it->name)){
             break;
         }
         ++it;
     }
-    int index = (int)(it - presets.begin()); // before reallocation!
-    presets.insert(it, std::move(preset));
+    int index = (int)(it - presets->begin()); // before reallocation!
+    presets->insert(it, std::move(preset));
+    setPresets(std::move(presets));
     return index;
 }
 
@@ -1854,7 +3500,7 @@ static std::string bashString(std::string name){
 
 #define toHex(x) std::hex << (x) << std::dec
 
-void PluginInfo::serialize(std::ostream& file) const {
+void PluginInfo::serialize(std::ostream& file, bool summary) const {
     file << "[plugin]\n";
     file << "id=" << uniqueID << "\n";
     file << "path=" << path << "\n";
@@ -1871,7 +3517,7 @@ void PluginInfo::serialize(std::ostream& file) const {
     if (numAuxOutputs > 0){
         file << "auxoutputs=" << numAuxOutputs << "\n";
     }
-    file << "flags=" << toHex(flags) << "\n";
+    file << "flags=" << toHex(summary ? (flags | Partial) : flags) << "\n";
 #if USE_VST3
     if (programChange != NoParamID){
         file << "pgmchange=" << toHex(programChange) << "\n";
@@ -1880,16 +3526,22 @@ void PluginInfo::serialize(std::ostream& file) const {
         file << "bypass=" << toHex(bypass) << "\n";
     }
 #endif
+    if (summary){
+        // don't touch the parameter and program tables
+        file << "[parameters]\nn=0\n[programs]\nn=0\n";
+        return;
+    }
+    auto tables = pinTables();
     // parameters
     file << "[parameters]\n";
-    file << "n=" << parameters.size() << "\n";
-    for (auto& param : parameters) {
+    file << "n=" << tables->parameters.size() << "\n";
+    for (auto& param : tables->parameters) {
         file << bashString(param.name) << "," << param.label << "," << toHex(param.id) << "\n";
     }
     // programs
     file << "[programs]\n";
-    file << "n=" << programs.size() << "\n";
-    for (auto& pgm : programs) {
+    file << "n=" << tables->programs.size() << "\n";
+    for (auto& pgm : tables->programs) {
         file << pgm << "\n";
     }
 #if USE_VST2
@@ -1967,6 +3619,10 @@ void parseArg(std::string& lh, const std::string& rh){
     lh = rh;
 }
 
+void parseArg(InternedString& lh, const std::string& rh){
+    lh = rh;
+}
+
 } // namespace
 
 bool getLine(std::istream& stream, std::string& line){
@@ -2001,7 +3657,8 @@ void PluginInfo::deserialize(std::istream& file) {
         if (line == "[plugin]"){
             start = true;
         } else if (line == "[parameters]"){
-            parameters.clear();
+            auto& tables = mutableTables();
+            tables.clearParameters();
             std::getline(file, line);
             int n = getCount(line);
             while (n-- && std::getline(file, line)){
@@ -2014,24 +3671,16 @@ void PluginInfo::deserialize(std::istream& file) {
                 if (args.size() >= 3){
                     param.id = std::stol(args[2], nullptr, 16); // hex
                 }
-                parameters.push_back(std::move(param));
-            }
-            // inverse mapping name -> index
-            for (int i = 0; i < (int)parameters.size(); ++i){
-                auto& param = parameters[i];
-                paramMap_[param.name] = i;
-            #if USE_VST3
-                // for VST3:
-                idToIndexMap_[param.id] = i;
-                indexToIdMap_[i] = param.id;
-            #endif
+                // also creates the inverse mappings
+                tables.addParameter(std::move(param));
             }
         } else if (line == "[programs]"){
-            programs.clear();
+            auto& tables = mutableTables();
+            tables.programs.clear();
             std::getline(file, line);
             int n = getCount(line);
             while (n-- && std::getline(file, line)){
-                programs.push_back(std::move(line));
+                tables.programs.push_back(std::move(line));
             }
             // finished if we're not a shell plugin (a bit hacky...)
             if (category != "Shell"){
@@ -0,0 +1,585 @@
+#include "PluginCache.h"
+
+#include <cstring>
+#include <cerrno>
+#include <map>
+#include <algorithm>
+
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
+namespace vst {
+
+/*/////////////////////// records ///////////////////////*/
+
+namespace {
+
+const char cacheMagic[4] = { 'V', 'S', 'T', 'C' };
+const uint32_t byteOrderMark = 0x01020304;
+
+enum ModuleFlags {
+    HaveInfo = 1 << 0,
+    IsException = 1 << 1
+};
+
+struct ModuleRecord {
+    uint32_t path;
+    uint32_t flags;
+    uint64_t size;
+    uint64_t mtime;
+    uint64_t inode;
+    uint64_t hash;
+    uint32_t firstPlugin;
+    uint32_t numPlugins;
+};
+
+struct PluginRecord {
+    char id[16];
+    uint32_t type;
+    uint32_t module;
+    uint32_t path;
+    uint32_t name;
+    uint32_t vendor;
+    uint32_t category;
+    uint32_t version;
+    uint32_t sdkVersion;
+    int32_t numInputs;
+    int32_t numAuxInputs;
+    int32_t numOutputs;
+    int32_t numAuxOutputs;
+    uint32_t flags;
+    uint32_t programChange;
+    uint32_t bypass;
+    uint32_t firstParam;
+    uint32_t numParams;
+    uint32_t firstProgram;
+    uint32_t numPrograms;
+    uint32_t firstKey;
+    uint32_t numKeys;
+    uint32_t padding;
+};
+
+struct ParamRecord {
+    uint32_t name;
+    uint32_t label;
+    uint32_t id;
+};
+
+struct KeyRecord {
+    uint32_t key;
+    uint32_t plugin;
+};
+
+// programs and plugin keys are just string references
+
+// interned strings: 32-bit length + characters + '\0', aligned to 4 bytes
+class StringTable {
+ public:
+    uint32_t add(const std::string& s){
+        auto it = map_.find(s);
+        if (it != map_.end()){
+            return it->second;
+        }
+        uint32_t ref = data_.size();
+        uint32_t len = s.size();
+        data_.append((const char *)&len, sizeof(len));
+        data_.append(s);
+        data_.push_back('\0');
+        while (data_.size() & 3){
+            data_.push_back('\0');
+        }
+        map_.emplace(s, ref);
+        return ref;
+    }
+    const std::string& data() const { return data_; }
+ private:
+    std::string data_;
+    std::unordered_map<std::string, uint32_t> map_;
+};
+
+uint32_t align(uint32_t offset){
+    return (offset + 7) & ~7;
+}
+
+} // namespace
+
+struct PluginCache::Header {
+    char magic[4];
+    uint32_t byteOrder;
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t fileSize;
+    uint32_t numModules;
+    uint32_t moduleOffset;
+    uint32_t numPlugins;
+    uint32_t pluginOffset;
+    uint32_t numParams;
+    uint32_t paramOffset;
+    uint32_t numPrograms;
+    uint32_t programOffset;
+    uint32_t numKeys;
+    uint32_t keyOffset;
+    uint32_t numPluginKeys;
+    uint32_t pluginKeyOffset;
+    uint32_t stringSize;
+    uint32_t stringOffset;
+};
+
+/*/////////////////////// write ///////////////////////*/
+
+void PluginCache::write(const std::string& path,
+                        const std::unordered_map<std::string, PluginInfo::const_ptr>& plugins,
+                        const std::unordered_set<std::string>& exceptions,
+                        const std::unordered_map<std::string, FileInfo>& modules)
+{
+    // inverse mapping (plugin -> keys)
+    std::unordered_map<PluginInfo::const_ptr, std::vector<std::string>> pluginMap;
+    for (auto& it : plugins){
+        pluginMap[it.second].push_back(it.first);
+    }
+    // group plugins by module (sorted by path)
+    struct ModuleData {
+        std::vector<PluginInfo::const_ptr> plugins;
+        const FileInfo *info = nullptr;
+        bool exception = false;
+    };
+    std::map<std::string, ModuleData> moduleMap;
+    for (auto& it : pluginMap){
+        moduleMap[it.first->path].plugins.push_back(it.first);
+    }
+    for (auto& e : exceptions){
+        moduleMap[e].exception = true;
+    }
+    for (auto& it : modules){
+        moduleMap[it.first].info = &it.second;
+    }
+
+    StringTable strings;
+    std::vector<ModuleRecord> moduleRecords;
+    std::vector<PluginRecord> pluginRecords;
+    std::vector<ParamRecord> paramRecords;
+    std::vector<uint32_t> programRecords;
+    std::vector<KeyRecord> keyRecords;
+    std::vector<uint32_t> pluginKeyRecords;
+
+    for (auto& it : moduleMap){
+        auto& data = it.second;
+        ModuleRecord m;
+        memset(&m, 0, sizeof(m));
+        m.path = strings.add(it.first);
+        m.flags = (data.info ? HaveInfo : 0) | (data.exception ? IsException : 0);
+        if (data.info){
+            m.size = data.info->size;
+            m.mtime = data.info->mtime;
+            m.inode = data.info->inode;
+            m.hash = data.info->hash;
+        }
+        m.firstPlugin = pluginRecords.size();
+        m.numPlugins = data.plugins.size();
+        for (auto& plugin : data.plugins){
+            PluginRecord p;
+            memset(&p, 0, sizeof(p));
+            p.type = (uint32_t)plugin->type();
+            if (plugin->type() == PluginType::VST3){
+                memcpy(p.id, plugin->getUID(), 16);
+            } else {
+                int32_t id = plugin->getUniqueID();
+                memcpy(p.id, &id, sizeof(id));
+            }
+            p.module = moduleRecords.size();
+            p.path = strings.add(plugin->path);
+            p.name = strings.add(plugin->name);
+            p.vendor = strings.add(plugin->vendor);
+            p.category = strings.add(plugin->category);
+            p.version = strings.add(plugin->version);
+            p.sdkVersion = strings.add(plugin->sdkVersion);
+            p.numInputs = plugin->numInputs;
+            p.numAuxInputs = plugin->numAuxInputs;
+            p.numOutputs = plugin->numOutputs;
+            p.numAuxOutputs = plugin->numAuxOutputs;
+            p.flags = plugin->flags;
+        #if USE_VST3
+            p.programChange = plugin->programChange;
+            p.bypass = plugin->bypass;
+        #else
+            p.programChange = PluginInfo::NoParamID;
+            p.bypass = PluginInfo::NoParamID;
+        #endif
+            auto tables = plugin->pinTables();
+            p.firstParam = paramRecords.size();
+            p.numParams = tables->parameters.size();
+            for (auto& param : tables->parameters){
+                paramRecords.push_back({ strings.add(param.name),
+                                         strings.add(param.label), param.id });
+            }
+            p.firstProgram = programRecords.size();
+            p.numPrograms = tables->programs.size();
+            for (auto& pgm : tables->programs){
+                programRecords.push_back(strings.add(pgm));
+            }
+            auto& keys = pluginMap[plugin];
+            // sort by length, so that the short key comes first
+            std::sort(keys.begin(), keys.end(), [](auto& a, auto& b){ return a.size() < b.size(); });
+            p.firstKey = pluginKeyRecords.size();
+            p.numKeys = keys.size();
+            for (auto& key : keys){
+                auto ref = strings.add(key);
+                pluginKeyRecords.push_back(ref);
+                keyRecords.push_back({ ref, (uint32_t)pluginRecords.size() });
+            }
+            pluginRecords.push_back(p);
+        }
+        moduleRecords.push_back(m);
+    }
+    // sort keys for binary search
+    auto& stringData = strings.data();
+    std::sort(keyRecords.begin(), keyRecords.end(), [&](auto& a, auto& b){
+        return strcmp(&stringData[a.key + 4], &stringData[b.key + 4]) < 0;
+    });
+
+    // layout
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.byteOrder = byteOrderMark;
+    header.version = version;
+    header.headerSize = sizeof(Header);
+    uint32_t offset = align(sizeof(Header));
+    auto layout = [&](uint32_t& count, uint32_t& onset, size_t n, size_t size){
+        count = n;
+        onset = offset;
+        offset = align(offset + n * size);
+    };
+    layout(header.numModules, header.moduleOffset, moduleRecords.size(), sizeof(ModuleRecord));
+    layout(header.numPlugins, header.pluginOffset, pluginRecords.size(), sizeof(PluginRecord));
+    layout(header.numParams, header.paramOffset, paramRecords.size(), sizeof(ParamRecord));
+    layout(header.numPrograms, header.programOffset, programRecords.size(), sizeof(uint32_t));
+    layout(header.numKeys, header.keyOffset, keyRecords.size(), sizeof(KeyRecord));
+    layout(header.numPluginKeys, header.pluginKeyOffset, pluginKeyRecords.size(), sizeof(uint32_t));
+    layout(header.stringSize, header.stringOffset, stringData.size(), 1);
+    header.fileSize = offset;
+
+    std::string buffer(offset, '\0');
+    auto put = [&](uint32_t onset, const void *data, size_t size){
+        if (size > 0){
+            memcpy(&buffer[onset], data, size);
+        }
+    };
+    put(0, &header, sizeof(header));
+    put(header.moduleOffset, moduleRecords.data(), moduleRecords.size() * sizeof(ModuleRecord));
+    put(header.pluginOffset, pluginRecords.data(), pluginRecords.size() * sizeof(PluginRecord));
+    put(header.paramOffset, paramRecords.data(), paramRecords.size() * sizeof(ParamRecord));
+    put(header.programOffset, programRecords.data(), programRecords.size() * sizeof(uint32_t));
+    put(header.keyOffset, keyRecords.data(), keyRecords.size() * sizeof(KeyRecord));
+    put(header.pluginKeyOffset, pluginKeyRecords.data(), pluginKeyRecords.size() * sizeof(uint32_t));
+    put(header.stringOffset, stringData.data(), stringData.size());
+
+    // write to temporary file and then replace the actual file.
+    // other processes might still have the old file mapped into memory!
+    auto tmpPath = path + ".tmp";
+    {
+        File file(tmpPath, File::WRITE);
+        if (!file.is_open()){
+            throw Error("couldn't create file " + tmpPath);
+        }
+        file.write(buffer.data(), buffer.size());
+        if (!file){
+            throw Error("couldn't write file " + tmpPath);
+        }
+    }
+    if (!renameFile(tmpPath, path)){
+        removeFile(tmpPath);
+        throw Error("couldn't replace file " + path);
+    }
+    LOG_DEBUG("wrote binary cache file: " << path);
+}
+
+/*/////////////////////// read ///////////////////////*/
+
+PluginCache::ptr PluginCache::open(const std::string& path){
+    ptr cache(new PluginCache());
+#ifdef _WIN32
+    auto file = CreateFileW(widen(path).c_str(), GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE){
+        throw Error("couldn't open file " + path);
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < sizeof(Header)){
+        CloseHandle(file);
+        throw Error("bad file size");
+    }
+    cache->size_ = size.QuadPart;
+    auto mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file); // the mapping stays valid
+    if (!mapping){
+        throw Error("couldn't map file: " + errorMessage(GetLastError()));
+    }
+    cache->mapping_ = mapping;
+    cache->data_ = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!cache->data_){
+        throw Error("couldn't map file: " + errorMessage(GetLastError()));
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0){
+        throw Error("couldn't open file " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)){
+        ::close(fd);
+        throw Error("bad file size");
+    }
+    cache->size_ = st.st_size;
+    void *data = mmap(nullptr, cache->size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping stays valid
+    if (data == MAP_FAILED){
+        throw Error("couldn't map file: " + errorMessage(errno));
+    }
+    cache->data_ = (const char *)data;
+#endif
+    // validate header
+    auto& h = cache->header();
+    if (memcmp(h.magic, cacheMagic, sizeof(cacheMagic)) != 0){
+        throw Error("not a cache file");
+    }
+    if (h.byteOrder != byteOrderMark){
+        throw Error("wrong byte order");
+    }
+    if (h.version != version){
+        throw Error("version mismatch");
+    }
+    if (h.headerSize != sizeof(Header) || h.fileSize != cache->size_){
+        throw Error("bad header");
+    }
+    auto check = [&](uint32_t onset, uint32_t n, size_t size){
+        if (onset % 8 || onset + (uint64_t)n * size > cache->size_){
+            throw Error("bad section");
+        }
+    };
+    check(h.moduleOffset, h.numModules, sizeof(ModuleRecord));
+    check(h.pluginOffset, h.numPlugins, sizeof(PluginRecord));
+    check(h.paramOffset, h.numParams, sizeof(ParamRecord));
+    check(h.programOffset, h.numPrograms, sizeof(uint32_t));
+    check(h.keyOffset, h.numKeys, sizeof(KeyRecord));
+    check(h.pluginKeyOffset, h.numPluginKeys, sizeof(uint32_t));
+    check(h.stringOffset, h.stringSize, 1);
+    LOG_DEBUG("opened binary cache file " << path);
+    return cache;
+}
+
+PluginCache::~PluginCache(){
+#ifdef _WIN32
+    if (data_){
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_){
+        CloseHandle(mapping_);
+    }
+#else
+    if (data_){
+        munmap((void *)data_, size_);
+    }
+#endif
+}
+
+const PluginCache::Header& PluginCache::header() const {
+    return *reinterpret_cast<const Header *>(data_);
+}
+
+std::string PluginCache::getString(uint32_t ref) const {
+    auto& h = header();
+    if ((uint64_t)ref + 4 <= h.stringSize){
+        auto s = data_ + h.stringOffset + ref;
+        uint32_t len;
+        memcpy(&len, s, sizeof(len));
+        if ((uint64_t)ref + 4 + len <= h.stringSize){
+            return std::string(s + 4, len);
+        }
+    }
+    LOG_ERROR("PluginCache: bad string reference");
+    return std::string{};
+}
+
+int PluginCache::compareString(uint32_t ref, const std::string& s) const {
+    auto& h = header();
+    if ((uint64_t)ref + 4 <= h.stringSize){
+        auto str = data_ + h.stringOffset + ref;
+        uint32_t len;
+        memcpy(&len, str, sizeof(len));
+        if ((uint64_t)ref + 4 + len <= h.stringSize){
+            int result = memcmp(str + 4, s.data(), std::min<size_t>(len, s.size()));
+            if (result != 0){
+                return result;
+            } else {
+                return (len < s.size()) ? -1 : (len > s.size());
+            }
+        }
+    }
+    return -1;
+}
+
+int PluginCache::numModules() const {
+    return header().numModules;
+}
+
+PluginCache::Module PluginCache::getModule(int index) const {
+    auto& m = getRecords<ModuleRecord>(header().moduleOffset)[index];
+    Module module;
+    module.path = getString(m.path);
+    module.info.size = m.size;
+    module.info.mtime = m.mtime;
+    module.info.inode = m.inode;
+    module.info.hash = m.hash;
+    module.haveInfo = m.flags & HaveInfo;
+    module.exception = m.flags & IsException;
+    module.firstPlugin = m.firstPlugin;
+    module.numPlugins = m.numPlugins;
+    if (m.firstPlugin + (uint64_t)m.numPlugins > header().numPlugins){
+        LOG_ERROR("PluginCache: bad plugin range");
+        module.numPlugins = 0;
+    }
+    return module;
+}
+
+int PluginCache::findModule(const std::string& path) const {
+    auto modules = getRecords<ModuleRecord>(header().moduleOffset);
+    int lo = 0, hi = (int)header().numModules - 1;
+    while (lo <= hi){
+        int mid = (lo + hi) / 2;
+        int result = compareString(modules[mid].path, path);
+        if (result < 0){
+            lo = mid + 1;
+        } else if (result > 0){
+            hi = mid - 1;
+        } else {
+            return mid;
+        }
+    }
+    return -1;
+}
+
+int PluginCache::numPlugins() const {
+    return header().numPlugins;
+}
+
+int PluginCache::findKey(const std::string& key) const {
+    auto keys = getRecords<KeyRecord>(header().keyOffset);
+    int lo = 0, hi = (int)header().numKeys - 1;
+    while (lo <= hi){
+        int mid = (lo + hi) / 2;
+        int result = compareString(keys[mid].key, key);
+        if (result < 0){
+            lo = mid + 1;
+        } else if (result > 0){
+            hi = mid - 1;
+        } else if (keys[mid].plugin < header().numPlugins){
+            return keys[mid].plugin;
+        } else {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+int PluginCache::getPluginModule(int index) const {
+    auto& p = getRecords<PluginRecord>(header().pluginOffset)[index];
+    return p.module < header().numModules ? (int)p.module : -1;
+}
+
+PluginInfo::ptr PluginCache::makePlugin(int index, IFactory::const_ptr factory,
+                                        std::vector<std::string>& keys) const {
+    auto& h = header();
+    auto& p = getRecords<PluginRecord>(h.pluginOffset)[index];
+    // no factory: summary for queries (see PluginIndex)
+    auto desc = factory ? std::make_shared<PluginInfo>(factory) : std::make_shared<PluginInfo>();
+    if ((PluginType)p.type == PluginType::VST3){
+        desc->setUID(p.id);
+    } else {
+        int32_t id;
+        memcpy(&id, p.id, sizeof(id));
+        desc->setUniqueID(id);
+    }
+    desc->path = getString(p.path);
+    desc->name = getString(p.name);
+    desc->vendor = getString(p.vendor);
+    desc->category = getString(p.category);
+    desc->version = getString(p.version);
+    desc->sdkVersion = getString(p.sdkVersion);
+    desc->numInputs = p.numInputs;
+    desc->numAuxInputs = p.numAuxInputs;
+    desc->numOutputs = p.numOutputs;
+    desc->numAuxOutputs = p.numAuxOutputs;
+    desc->flags = p.flags;
+#if USE_VST3
+    desc->programChange = p.programChange;
+    desc->bypass = p.bypass;
+#endif
+    // parameters and programs are only loaded on demand.
+    // NB: the loader keeps the file mapped.
+    auto self = shared_from_this();
+    desc->setTableLoader([self, index](PluginInfo::Tables& tables){
+        self->loadTables(index, tables);
+    });
+    getKeys(index, keys);
+    return desc;
+}
+
+void PluginCache::getKeys(int index, std::vector<std::string>& keys) const {
+    auto& h = header();
+    auto& p = getRecords<PluginRecord>(h.pluginOffset)[index];
+    keys.clear();
+    if (p.firstKey + (uint64_t)p.numKeys <= h.numPluginKeys){
+        auto pluginKeys = getRecords<uint32_t>(h.pluginKeyOffset) + p.firstKey;
+        for (uint32_t i = 0; i < p.numKeys; ++i){
+            keys.push_back(getString(pluginKeys[i]));
+        }
+    }
+}
+
+PluginCache::Summary PluginCache::getSummary(int index) const {
+    auto& p = getRecords<PluginRecord>(header().pluginOffset)[index];
+    Summary summary;
+    summary.path = getString(p.path);
+    summary.name = getString(p.name);
+    summary.vendor = getString(p.vendor);
+    summary.category = getString(p.category);
+    summary.type = (PluginType)p.type;
+    summary.flags = p.flags;
+    return summary;
+}
+
+void PluginCache::loadTables(int index, PluginInfo::Tables& tables) const {
+    auto& h = header();
+    auto& p = getRecords<PluginRecord>(h.pluginOffset)[index];
+    if (p.firstParam + (uint64_t)p.numParams <= h.numParams){
+        auto params = getRecords<ParamRecord>(h.paramOffset) + p.firstParam;
+        tables.parameters.reserve(p.numParams);
+    #if USE_VST3
+        tables.paramIDs.reserve(p.numParams);
+    #endif
+        for (uint32_t i = 0; i < p.numParams; ++i){
+            PluginInfo::Param param;
+            param.name = getString(params[i].name);
+            param.label = getString(params[i].label);
+            param.id = params[i].id;
+            tables.addParameter(std::move(param));
+        }
+    }
+    if (p.firstProgram + (uint64_t)p.numPrograms <= h.numPrograms){
+        auto programs = getRecords<uint32_t>(h.programOffset) + p.firstProgram;
+        tables.programs.reserve(p.numPrograms);
+        for (uint32_t i = 0; i < p.numPrograms; ++i){
+            tables.programs.push_back(getString(programs[i]));
+        }
+    }
+}
+
+} // vst
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Interface.h"
+#include "Utility.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace vst {
+
+// Binary plugin cache file.
+//
+// The file is memory mapped read-only, so opening it is (almost) free and several
+// processes on the same machine can share the same pages. All records have a fixed
+// size and strings are interned in a single string table. Plugin descriptions are
+// only created on demand (see PluginManager) and their parameter and program tables
+// are only loaded when they are actually used.
+//
+// Layout:
+// header | modules (sorted by path) | plugins | parameters | programs | keys (sorted) | plugin keys | strings
+//
+// Each module contains a contiguous range of plugins, each plugin contains
+// a contiguous range of parameters, programs and keys.
+// The file is written in native byte order; files with a different byte order
+// or version are rejected (the INI file can be used as a fallback).
+
+class PluginCache : public std::enable_shared_from_this<PluginCache> {
+ public:
+    static const uint32_t version = 1;
+
+    using ptr = std::shared_ptr<PluginCache>;
+    // map cache file into memory.
+    // throws an Error exception on failure!
+    static ptr open(const std::string& path);
+    // write cache file (via a temporary file, so that readers never see a partial file).
+    // throws an Error exception on failure!
+    static void write(const std::string& path,
+                      const std::unordered_map<std::string, PluginInfo::const_ptr>& plugins,
+                      const std::unordered_set<std::string>& exceptions,
+                      const std::unordered_map<std::string, FileInfo>& modules);
+
+    ~PluginCache();
+    PluginCache(const PluginCache&) = delete;
+    PluginCache& operator=(const PluginCache&) = delete;
+
+    struct Module {
+        std::string path;
+        FileInfo info;
+        bool haveInfo;
+        bool exception; // black-listed
+        int firstPlugin;
+        int numPlugins;
+    };
+    int numModules() const;
+    Module getModule(int index) const;
+    // returns -1 if not found
+    int findModule(const std::string& path) const;
+    int numPlugins() const;
+    // returns the plugin index or -1 if not found
+    int findKey(const std::string& key) const;
+    int getPluginModule(int index) const;
+    // create a new plugin description and get all its keys ('factory' might be nullptr).
+    // the parameter and program tables are loaded lazily (see PluginInfo::Tables).
+    PluginInfo::ptr makePlugin(int index, IFactory::const_ptr factory,
+                               std::vector<std::string>& keys) const;
+    void getKeys(int index, std::vector<std::string>& keys) const;
+    // the searchable fields of a plugin (see PluginIndex),
+    // read directly from the string table without creating a plugin description.
+    struct Summary {
+        std::string path;
+        std::string name;
+        std::string vendor;
+        std::string category;
+        PluginType type;
+        uint32_t flags;
+    };
+    Summary getSummary(int index) const;
+    void loadTables(int index, PluginInfo::Tables& tables) const;
+ private:
+    PluginCache() = default;
+    struct Header;
+    const Header& header() const;
+    std::string getString(uint32_t ref) const;
+    int compareString(uint32_t ref, const std::string& s) const;
+    template<typename T>
+    const T* getRecords(uint32_t offset) const {
+        return reinterpret_cast<const T *>(data_ + offset);
+    }
+
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void *mapping_ = nullptr;
+#endif
+};
+
+} // vst
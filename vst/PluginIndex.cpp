@@ -0,0 +1,232 @@
+#include "PluginIndex.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace vst {
+
+namespace {
+
+// ASCII only, UTF-8 sequences are left alone
+std::string toLower(const std::string& s){
+    std::string result(s);
+    for (auto& c : result){
+        if (c >= 'A' && c <= 'Z'){
+            c += 'a' - 'A';
+        }
+    }
+    return result;
+}
+
+// non-ASCII characters are treated as part of a word
+bool isWordChar(char c){
+    return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || (unsigned char)c >= 0x80;
+}
+
+bool isWordStart(const std::string& s, size_t pos){
+    return pos == 0 || (isWordChar(s[pos]) && !isWordChar(s[pos - 1]));
+}
+
+uint32_t trigram(const char *s){
+    return ((uint32_t)(unsigned char)s[0] << 16)
+            | ((uint32_t)(unsigned char)s[1] << 8)
+            | (uint32_t)(unsigned char)s[2];
+}
+
+void intersect(std::vector<uint32_t>& a, const std::vector<uint32_t>& b){
+    std::vector<uint32_t> result;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                          std::back_inserter(result));
+    a = std::move(result);
+}
+
+} // namespace
+
+/*/////////////////////// Field ///////////////////////*/
+
+void PluginIndex::Field::add(uint32_t doc, const std::string& text){
+    auto lower = toLower(text);
+    // trigrams
+    for (size_t i = 0; i + 3 <= lower.size(); ++i){
+        auto& list = trigrams_[trigram(&lower[i])];
+        if (list.empty() || list.back() != doc){
+            list.push_back(doc);
+        }
+    }
+    // words
+    for (size_t i = 0; i < lower.size(); ++i){
+        if (isWordChar(lower[i]) && isWordStart(lower, i)){
+            auto end = i;
+            while (end < lower.size() && isWordChar(lower[end])){
+                end++;
+            }
+            words_.emplace_back(lower.substr(i, end - i), doc);
+            i = end;
+        }
+    }
+    text_.push_back(std::move(lower));
+}
+
+void PluginIndex::Field::finish(){
+    std::sort(words_.begin(), words_.end());
+    words_.erase(std::unique(words_.begin(), words_.end()), words_.end());
+    words_.shrink_to_fit();
+}
+
+bool PluginIndex::Field::matches(uint32_t doc, const std::string& query, Match match) const {
+    auto& text = text_[doc];
+    if (match == Match::Prefix){
+        for (size_t i = 0; i + query.size() <= text.size(); ++i){
+            if (isWordStart(text, i) && !text.compare(i, query.size(), query)){
+                return true;
+            }
+        }
+        return false;
+    } else {
+        return text.find(query) != std::string::npos;
+    }
+}
+
+bool PluginIndex::Field::find(const std::string& query, Match match, DocList& result) const {
+    if (query.empty()){
+        return false;
+    }
+    DocList candidates;
+    bool scan = false;
+    if (match == Match::Prefix){
+        // look up the first word of the query
+        size_t end = 0;
+        while (end < query.size() && isWordChar(query[end])){
+            end++;
+        }
+        if (end > 0){
+            auto word = query.substr(0, end);
+            auto it = std::lower_bound(words_.begin(), words_.end(),
+                                       std::make_pair(word, (uint32_t)0));
+            for (; it != words_.end() && !it->first.compare(0, word.size(), word); ++it){
+                candidates.push_back(it->second);
+            }
+            std::sort(candidates.begin(), candidates.end());
+            candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+        } else {
+            scan = true; // starts with a separator
+        }
+    } else if (query.size() >= 3){
+        // intersect the posting lists, starting with the shortest one
+        std::vector<const DocList *> lists;
+        for (size_t i = 0; i + 3 <= query.size(); ++i){
+            auto it = trigrams_.find(trigram(&query[i]));
+            if (it == trigrams_.end()){
+                return true; // no match
+            }
+            lists.push_back(&it->second);
+        }
+        std::sort(lists.begin(), lists.end(), [](const DocList *a, const DocList *b){
+            return a->size() < b->size();
+        });
+        candidates = *lists[0];
+        for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i){
+            intersect(candidates, *lists[i]);
+        }
+    } else {
+        scan = true; // too short for trigrams
+    }
+    // verify
+    if (scan){
+        for (uint32_t i = 0; i < text_.size(); ++i){
+            if (matches(i, query, match)){
+                result.push_back(i);
+            }
+        }
+    } else {
+        for (auto& doc : candidates){
+            if (matches(doc, query, match)){
+                result.push_back(doc);
+            }
+        }
+    }
+    return true;
+}
+
+/*/////////////////////// PluginIndex ///////////////////////*/
+
+PluginIndex::PluginIndex(std::vector<PluginInfo::const_ptr> plugins,
+                         PluginCache::ptr cache, std::vector<int> cachePlugins)
+    : cache_(std::move(cache))
+{
+    struct Entry {
+        Entry(Document doc, std::string name, std::string path,
+              std::string vendor, std::string category)
+            : doc(std::move(doc)), name(std::move(name)), path(std::move(path)),
+              vendor(std::move(vendor)), category(std::move(category)) {}
+        Document doc;
+        std::string name; // lowercased
+        std::string path;
+        std::string vendor;
+        std::string category;
+    };
+    std::vector<Entry> entries;
+    entries.reserve(plugins.size() + cachePlugins.size());
+    for (auto& plugin : plugins){
+        entries.emplace_back(Document(plugin, -1, plugin->type(), plugin->flags),
+                             toLower(plugin->name), plugin->path, plugin->vendor, plugin->category);
+    }
+    for (auto& index : cachePlugins){
+        auto summary = cache_->getSummary(index);
+        entries.emplace_back(Document(nullptr, index, summary.type, summary.flags),
+                             toLower(summary.name), std::move(summary.path),
+                             std::move(summary.vendor), std::move(summary.category));
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b){
+        return a.name != b.name ? a.name < b.name : a.path < b.path;
+    });
+    docs_.reserve(entries.size());
+    for (uint32_t i = 0; i < entries.size(); ++i){
+        auto& e = entries[i];
+        fields_[NameField].add(i, e.name);
+        fields_[VendorField].add(i, e.vendor);
+        fields_[CategoryField].add(i, e.category);
+        docs_.push_back(std::move(e.doc));
+    }
+    for (auto& field : fields_){
+        field.finish();
+    }
+}
+
+std::vector<PluginInfo::const_ptr> PluginIndex::query(const Query& q) const {
+    const std::string *strings[NumFields] = { &q.name, &q.vendor, &q.category };
+    DocList docs;
+    bool all = true;
+    for (int i = 0; i < NumFields; ++i){
+        DocList result;
+        if (fields_[i].find(toLower(*strings[i]), q.match, result)){
+            if (all){
+                docs = std::move(result);
+                all = false;
+            } else {
+                intersect(docs, result);
+            }
+        }
+    }
+    if (all){
+        docs.resize(docs_.size());
+        for (uint32_t i = 0; i < docs.size(); ++i){
+            docs[i] = i;
+        }
+    }
+    std::vector<PluginInfo::const_ptr> result;
+    std::vector<std::string> keys;
+    for (auto& index : docs){
+        auto& doc = docs_[index];
+        if ((q.type < 0 || (int)doc.type == q.type) && (doc.flags & q.flags) == q.flags){
+            if (doc.plugin){
+                result.push_back(doc.plugin);
+            } else {
+                result.push_back(cache_->makePlugin(doc.cacheIndex, nullptr, keys));
+            }
+        }
+    }
+    return result;
+}
+
+} // vst
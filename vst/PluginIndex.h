@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Interface.h"
+#include "PluginCache.h"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace vst {
+
+// Immutable search index over the plugin descriptions (see PluginManager::query()).
+//
+// The name, vendor and category of every plugin are lowercased and indexed twice:
+// an inverted index of character trigrams answers substring queries and a sorted
+// word table answers prefix queries. Candidates are always verified against the
+// actual text, so the indexes only need to narrow down the search.
+// Plugin type and flags are checked on the remaining candidates.
+//
+// Plugins which are still in the binary cache file are indexed directly from its
+// string table; their (summary) descriptions are only created for the query results.
+
+class PluginIndex {
+ public:
+    enum class Match {
+        Substring, // query is contained anywhere in the field
+        Prefix // field or one of its words starts with the query
+    };
+
+    struct Query {
+        // case-insensitive; empty strings match everything
+        std::string name;
+        std::string vendor;
+        std::string category;
+        Match match = Match::Substring;
+        int type = -1; // PluginType or -1 for any type
+        uint32_t flags = 0; // PluginInfo::Flags which must be set
+    };
+
+    // 'plugins' and 'cachePlugins' (plugin indices in 'cache') should be unique.
+    // The results are sorted by name (case-insensitive) and path. Results from the
+    // cache file don't have a factory, so they can't be used to create a plugin.
+    PluginIndex(std::vector<PluginInfo::const_ptr> plugins,
+                PluginCache::ptr cache = nullptr, std::vector<int> cachePlugins = {});
+
+    std::vector<PluginInfo::const_ptr> query(const Query& q) const;
+
+    int size() const { return (int)docs_.size(); }
+ private:
+    using DocList = std::vector<uint32_t>; // sorted plugin indices
+
+    class Field {
+     public:
+        void add(uint32_t doc, const std::string& text);
+        void finish();
+        // returns false if the query matches every document
+        bool find(const std::string& query, Match match, DocList& result) const;
+     private:
+        bool matches(uint32_t doc, const std::string& query, Match match) const;
+        std::vector<std::string> text_; // lowercased, one per document
+        std::unordered_map<uint32_t, DocList> trigrams_;
+        std::vector<std::pair<std::string, uint32_t>> words_; // sorted by word
+    };
+
+    enum FieldIndex {
+        NameField,
+        VendorField,
+        CategoryField,
+        NumFields
+    };
+
+    struct Document {
+        Document(PluginInfo::const_ptr plugin, int cacheIndex, PluginType type, uint32_t flags)
+            : plugin(std::move(plugin)), cacheIndex(cacheIndex), type(type), flags(flags) {}
+        PluginInfo::const_ptr plugin; // nullptr: in the cache file
+        int cacheIndex;
+        PluginType type;
+        uint32_t flags;
+    };
+
+    std::vector<Document> docs_;
+    PluginCache::ptr cache_;
+    Field fields_[NumFields];
+};
+
+} // vst
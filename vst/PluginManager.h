@@ -2,88 +2,1119 @@
 
 #include "Interface.h"
 #include "Utility.h"
+#include "PluginCache.h"
+#include "PluginIndex.h"
 
 #include <unordered_map>
 #include <unordered_set>
+#include <deque>
+#include <chrono>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <memory>
+#include <cinttypes>
+#include <cmath>
+#include <cctype>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
 
 namespace vst {
 
 // thread-safe manager for VST plugins (factories and descriptions)
+//
+// Lookups (findFactory(), findPlugin(), isException()) only read an immutable snapshot
+// of the maps, so they never wait for writers, e.g. a running search or (re)loading
+// the cache file. Writers modify their own copy under a mutex, keep track of the changed
+// keys and publish a new snapshot when they are done.
+//
+// If the plugins are read from a binary cache file, the factories and plugin
+// descriptions of a module are only created when they are actually needed.
+// Lookups materialize such modules under a separate lock and add them to the snapshot
+// with a compare-and-swap, so they don't wait for writers either. The writers merge
+// the materialized modules into their own maps before they publish (see mergeModules()).
+//
+// Added, black-listed and removed modules are recorded, so that the hosts can append
+// them to a journal file instead of rewriting the whole cache after every change.
+// The journal is replayed on top of the cache file and folded into it by compact().
+//
+// Every published change of the plugin descriptions increases the database version
+// and is recorded in a (bounded) change log, so that clients only have to fetch the
+// changes since the last version they have seen (see changes()).
+// Plugins in the binary cache file count as present until their module turns out to be
+// modified or missing, so query() and changes() don't have to load all modules.
 
 class PluginManager {
  public:
+    // compact the journal once it gets larger than this
+    static const uint64_t maxJournalSize = 1 << 20;
+    // max. number of entries in the change log
+    static const size_t maxChangeLog = 4096;
+
+    struct Change {
+        enum Op {
+            Add,
+            Modify,
+            Remove
+        };
+        Op op;
+        std::string key;
+        PluginInfo::const_ptr plugin; // nullptr for Remove
+    };
+
+    ~PluginManager();
     // factories
     void addFactory(const std::string& path, IFactory::ptr factory);
-    IFactory::const_ptr findFactory(const std::string& path) const;
+    IFactory::const_ptr findFactory(const std::string& path);
     // black-listed modules
     void addException(const std::string& path);
     bool isException(const std::string& path) const;
+    // Check if a module has been modified since it has been probed.
+    // If yes, its factory, plugins and black-list entry are removed,
+    // so that it can be probed again. Returns true if the module has been modified.
+    bool checkModule(const std::string& path);
+    // Find an already probed module with identical content (e.g. the same plugin
+    // installed in several places). Returns a new factory for 'path' with copies
+    // of the existing plugin descriptions or nullptr.
+    IFactory::ptr findDuplicate(const std::string& path);
+    // Remove the module at 'path' resp. all modules inside the directory 'path'
+    // (e.g. after the files have been deleted). Returns the removed module paths.
+    // If 'missing' is true, only modules which don't exist anymore are removed.
+    std::vector<std::string> removeModules(const std::string& path, bool missing = false);
     // plugin descriptions
     void addPlugin(const std::string& key, PluginInfo::const_ptr plugin);
-    PluginInfo::const_ptr findPlugin(const std::string& key) const;
+    PluginInfo::const_ptr findPlugin(const std::string& key);
+    // Run the full probe for a plugin which has only been scanned (see PluginInfo::isPartial())
+    // and replace its description under all keys. Returns the new description.
+    // throws an Error exception on failure!
+    PluginInfo::const_ptr probeFull(PluginInfo::const_ptr plugin);
+    // Find all plugins matching the query (see PluginIndex), sorted by name.
+    // The index is built on demand and reused until the plugins change.
+    // Plugins of modules which haven't been loaded from the binary cache yet are returned
+    // as summaries without a factory; use findPlugin() with one of their keys to load them.
+    std::vector<PluginInfo::const_ptr> query(const PluginIndex::Query& q);
+    // The current database version. Versions start at the time of creation (in microseconds),
+    // so versions of different sessions don't overlap.
+    uint64_t version() const;
+    // Get the changes since version 'since', collapsed per key, and return the current version.
+    // If the change log doesn't reach back far enough or 'since' belongs to another session,
+    // 'reset' is set to true and all plugins are returned as additions.
+    // Like in query(), plugins from the binary cache might only be summaries. If a module
+    // turns out to be stale when it is loaded, its plugins are reported as removed.
+    uint64_t changes(uint64_t since, std::vector<Change>& result, bool& reset);
     // remove factories and plugin descriptions
     void clear();
     // (de)serialize
     // throws an Error exception on failure!
     void read(const std::string& path, bool update = true);
-    void write(const std::string& path) const;
+    void write(const std::string& path);
+    // binary cache file (see PluginCache)
+    // throws an Error exception on failure!
+    void readBinary(const std::string& path);
+    void writeBinary(const std::string& path);
+    // journal file; incomplete records (e.g. after a crash) are discarded.
+    // replay the journal on top of the cache file; does nothing if the file doesn't exist.
+    // throws an Error exception on failure!
+    void readJournal(const std::string& path);
+    // append all changes since the last binary cache file has been written.
+    // returns the new size of the journal file (0 if there was nothing to write).
+    // throws an Error exception on failure!
+    uint64_t writeJournal(const std::string& path);
+    // rewrite the binary cache and INI file on a background thread and remove the journal.
+    // the maps are copied under the lock and written without it; requests which come in
+    // while a compaction is running are merged. errors are only logged.
+    void compact(const std::string& cachePath, const std::string& iniPath,
+                 const std::string& journalPath);
+    // Mark the start resp. end of reading the cache files on a background thread.
+    // In the meantime, lookups for missing entries wait until the entry has been
+    // added or the cache has been loaded completely.
+    void beginLoad();
+    void endLoad();
  private:
-    void doWrite(const std::string& path) const;
+    template<typename Fn>
+    void waitForLoad(const Fn& found) const;
+    struct FileData;
+    // copy the maps for writing without the lock; 'journal': take the pending journal entries
+    void getFileData(FileData& data, bool journal);
+    void restoreJournal(FileData& data);
+    static void doWrite(const std::string& path,
+                        const std::unordered_map<std::string, PluginInfo::const_ptr>& plugins,
+                        const std::unordered_set<std::string>& exceptions,
+                        const std::unordered_map<std::string, FileInfo>& modules);
+    void doCompact(const std::string& cachePath, const std::string& iniPath,
+                   const std::string& journalPath);
+    void compactThreadFunction();
+    void doWriteJournal(std::ostream& file) const;
+    void replayRecord(std::istream& file);
+    void removeModule(const std::string& path);
+    void forgetModule(const std::string& path);
+    void publish();
+    bool loadModule(int index);
+    void setCache(PluginCache::ptr cache);
+    // plugins in modules which haven't been loaded from the binary cache
+    // and aren't shadowed by the writer maps; must be called with both locks held.
+    void getCachedPlugins(std::vector<int>& result) const;
+    // lookup path: materialize a module of 'cache' and add it to the snapshot
+    void loadCachedModule(const PluginCache::ptr& cache, int index);
+    // the following methods must be called with cacheMutex_ held
+    struct CachedModule;
+    bool materializeModule(int index);
+    void dropModule(const PluginCache::Module& module);
+    void publishModule(const CachedModule& module);
+    bool mergeModules();
+    void updateModule(const std::string& path, const FileInfo& info);
+    bool doCheckModule(const std::string& path, const FileInfo& info);
     std::unordered_map<std::string, IFactory::ptr> factories_;
     std::unordered_map<std::string, PluginInfo::const_ptr> plugins_;
     std::unordered_set<std::string> exceptions_;
+    std::unordered_map<std::string, FileInfo> modules_;
+    // binary cache; only modified with both mutex_ and cacheMutex_ held
+    PluginCache::ptr cache_;
+    // a module which has been materialized from the binary cache
+    struct CachedModule {
+        std::string path;
+        IFactory::ptr factory; // nullptr for black-listed modules
+        std::vector<std::pair<std::string, PluginInfo::const_ptr>> plugins; // key + plugin
+        bool exception = false;
+        bool haveInfo = false;
+        FileInfo info;
+    };
+    // the following members are protected by cacheMutex_
+    std::vector<bool> loaded_; // modules which have already been loaded from the cache
+    std::vector<CachedModule> loadedModules_; // not merged into the writer maps yet
+    std::vector<std::string> droppedKeys_; // keys of stale modules in the binary cache
+    std::mutex cacheMutex_;
+    // search index; reset whenever plugins are added or removed
+    std::shared_ptr<const PluginIndex> index_;
+    // keys of dropped cache plugins which haven't been published yet (see mergeModules())
+    std::vector<std::string> removedKeys_;
+    // change log
+    struct LogEntry {
+        uint64_t version;
+        Change::Op op;
+        std::string key;
+    };
+    static uint64_t firstVersion();
+    std::deque<LogEntry> changeLog_;
+    uint64_t version_ = firstVersion();
+    uint64_t logStart_ = version_; // older changes have been dropped
+    // Immutable map for lookups. Changes are stored in a small overlay on top of
+    // a shared base map, which is only copied when the overlay gets too large.
+    template<typename T>
+    class SnapshotMap {
+     public:
+        using Map = std::unordered_map<std::string, T>;
+        // returns nullptr if not found
+        const T* find(const std::string& key) const;
+        // returns a new version with the changed keys of 'current'
+        template<typename U>
+        SnapshotMap update(const U& current, const std::unordered_set<std::string>& changed) const;
+        // returns a new version with additional entries; existing keys are not overwritten.
+        SnapshotMap add(const std::vector<std::pair<std::string, T>>& values) const;
+     private:
+        static bool getValue(const std::unordered_map<std::string, T>& map,
+                             const std::string& key, T& value);
+        static bool getValue(const std::unordered_set<std::string>& set,
+                             const std::string& key, bool& value);
+        static void copyValues(const std::unordered_map<std::string, T>& map, Map& result);
+        static void copyValues(const std::unordered_set<std::string>& set, Map& result);
+        std::shared_ptr<const Map> base_;
+        std::unordered_map<std::string, std::pair<bool, T>> overlay_; // false: removed
+    };
+    // snapshot for lookups; only accessed with std::atomic_load(), std::atomic_store()
+    // and std::atomic_compare_exchange_strong()
+    struct Snapshot {
+        SnapshotMap<IFactory::ptr> factories;
+        SnapshotMap<PluginInfo::const_ptr> plugins;
+        SnapshotMap<bool> exceptions;
+        PluginCache::ptr cache; // for modules which haven't been loaded yet
+    };
+    std::shared_ptr<const Snapshot> snapshot_ = std::make_shared<Snapshot>();
+    // keys which have changed since the last snapshot
+    std::unordered_set<std::string> changedFactories_;
+    std::unordered_set<std::string> changedPlugins_;
+    std::unordered_set<std::string> changedExceptions_;
+    // journal
+    enum class JournalOp {
+        Add,
+        Ignore,
+        Remove
+    };
+    std::vector<std::pair<JournalOp, std::string>> journal_; // not written yet
+    std::mutex fileMutex_; // serializes journal writes and compaction
+    // copy of the maps which are written to the cache files
+    struct FileData {
+        std::unordered_map<std::string, PluginInfo::const_ptr> plugins;
+        std::unordered_set<std::string> exceptions;
+        std::unordered_map<std::string, FileInfo> modules;
+        std::vector<std::pair<JournalOp, std::string>> journal; // contained in the copy
+    };
+    // compaction thread (started on demand)
+    std::string compactCachePath_;
+    std::string compactIniPath_;
+    std::string compactJournalPath_;
+    bool compactPending_ = false;
+    bool compactQuit_ = false;
+    std::mutex compactMutex_;
+    std::condition_variable compactCond_;
+    std::thread compactThread_;
     mutable SharedMutex mutex_;
+    // background loading
+    std::atomic<bool> loading_{false};
+    mutable std::mutex loadMutex_;
+    mutable std::condition_variable loadCond_;
 };
 
 // implementation
 
+template<typename T>
+const T* PluginManager::SnapshotMap<T>::find(const std::string& key) const {
+    auto it = overlay_.find(key);
+    if (it != overlay_.end()){
+        return it->second.first ? &it->second.second : nullptr;
+    }
+    if (base_){
+        auto it = base_->find(key);
+        if (it != base_->end()){
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
+template<typename T>
+template<typename U>
+PluginManager::SnapshotMap<T> PluginManager::SnapshotMap<T>::update(
+        const U& current, const std::unordered_set<std::string>& changed) const
+{
+    SnapshotMap result;
+    // Copying the overlay is O(overlay size) and copying the base is O(N),
+    // so we merge once the overlay exceeds sqrt(N).
+    size_t limit = std::max<size_t>(32, std::sqrt((double)current.size()));
+    if (overlay_.size() + changed.size() > limit){
+        auto base = std::make_shared<Map>();
+        copyValues(current, *base);
+        result.base_ = std::move(base);
+    } else {
+        result.base_ = base_;
+        result.overlay_ = overlay_;
+        for (auto& key : changed){
+            auto& entry = result.overlay_[key];
+            entry.first = getValue(current, key, entry.second);
+        }
+    }
+    return result;
+}
+
+template<typename T>
+PluginManager::SnapshotMap<T> PluginManager::SnapshotMap<T>::add(
+        const std::vector<std::pair<std::string, T>>& values) const
+{
+    SnapshotMap result(*this);
+    for (auto& it : values){
+        if (!find(it.first)){
+            result.overlay_[it.first] = std::make_pair(true, it.second);
+        }
+    }
+    // see update()
+    size_t size = base_ ? base_->size() : 0;
+    size_t limit = std::max<size_t>(32, std::sqrt((double)size));
+    if (result.overlay_.size() > limit){
+        auto base = base_ ? std::make_shared<Map>(*base_) : std::make_shared<Map>();
+        for (auto& it : result.overlay_){
+            if (it.second.first){
+                (*base)[it.first] = it.second.second;
+            } else {
+                base->erase(it.first);
+            }
+        }
+        result.base_ = std::move(base);
+        result.overlay_.clear();
+    }
+    return result;
+}
+
+template<typename T>
+bool PluginManager::SnapshotMap<T>::getValue(const std::unordered_map<std::string, T>& map,
+                                              const std::string& key, T& value){
+    auto it = map.find(key);
+    if (it != map.end()){
+        value = it->second;
+        return true;
+    } else {
+        value = T{};
+        return false;
+    }
+}
+
+template<typename T>
+bool PluginManager::SnapshotMap<T>::getValue(const std::unordered_set<std::string>& set,
+                                              const std::string& key, bool& value){
+    value = set.count(key) != 0;
+    return value;
+}
+
+template<typename T>
+void PluginManager::SnapshotMap<T>::copyValues(const std::unordered_map<std::string, T>& map,
+                                                Map& result){
+    result = map;
+}
+
+template<typename T>
+void PluginManager::SnapshotMap<T>::copyValues(const std::unordered_set<std::string>& set,
+                                                Map& result){
+    result.reserve(set.size());
+    for (auto& key : set){
+        result.emplace(key, true);
+    }
+}
+
+PluginManager::~PluginManager(){
+    {
+        std::lock_guard<std::mutex> lock(compactMutex_);
+        compactQuit_ = true;
+    }
+    compactCond_.notify_one();
+    // finishes a pending compaction
+    if (compactThread_.joinable()){
+        compactThread_.join();
+    }
+}
+
 void PluginManager::addFactory(const std::string& path, IFactory::ptr factory) {
+    FileInfo info;
+    bool haveInfo = getFileInfo(path, info);
     Lock lock(mutex_);
     factories_[path] = std::move(factory);
+    changedFactories_.insert(path);
+    if (haveInfo){
+        updateModule(path, info);
+    }
+    journal_.emplace_back(JournalOp::Add, path);
+    publish();
 }
 
-IFactory::const_ptr PluginManager::findFactory(const std::string& path) const {
-    SharedLock lock(mutex_);
-    auto factory = factories_.find(path);
-    if (factory != factories_.end()){
-        return factory->second;
-    } else {
-        return nullptr;
+void PluginManager::beginLoad(){
+    loading_ = true;
+}
+
+void PluginManager::endLoad(){
+    {
+        std::lock_guard<std::mutex> lock(loadMutex_);
+        loading_ = false;
+    }
+    loadCond_.notify_all();
+}
+
+template<typename Fn>
+void PluginManager::waitForLoad(const Fn& found) const {
+    if (loading_){
+        std::unique_lock<std::mutex> lock(loadMutex_);
+        loadCond_.wait(lock, [&](){
+            return !loading_ || found(*std::atomic_load(&snapshot_));
+        });
+    }
+}
+
+IFactory::const_ptr PluginManager::findFactory(const std::string& path) {
+    waitForLoad([&](const Snapshot& s){
+        return s.factories.find(path) || (s.cache && s.cache->findModule(path) >= 0);
+    });
+    auto snapshot = std::atomic_load(&snapshot_);
+    auto factory = snapshot->factories.find(path);
+    if (factory){
+        return *factory;
+    }
+    // try to load from binary cache
+    if (snapshot->cache){
+        int index = snapshot->cache->findModule(path);
+        if (index >= 0){
+            loadCachedModule(snapshot->cache, index);
+            snapshot = std::atomic_load(&snapshot_);
+            factory = snapshot->factories.find(path);
+            if (factory){
+                return *factory;
+            }
+        }
     }
+    return nullptr;
 }
 
 void PluginManager::addException(const std::string &path){
+    FileInfo info;
+    bool haveInfo = getFileInfo(path, info);
     Lock lock(mutex_);
     exceptions_.insert(path);
+    changedExceptions_.insert(path);
+    if (haveInfo){
+        updateModule(path, info);
+    }
+    journal_.emplace_back(JournalOp::Ignore, path);
+    publish();
 }
 
 bool PluginManager::isException(const std::string& path) const {
-    SharedLock lock(mutex_);
-    return exceptions_.count(path) != 0;
+    waitForLoad([&](const Snapshot& s){
+        return s.exceptions.find(path) || (s.cache && s.cache->findModule(path) >= 0);
+    });
+    auto snapshot = std::atomic_load(&snapshot_);
+    return snapshot->exceptions.find(path) != nullptr;
+}
+
+void PluginManager::updateModule(const std::string& path, const FileInfo& info){
+    auto it = modules_.find(path);
+    // keep the content hash if the file hasn't changed
+    if (it == modules_.end() || !it->second.sameFile(info)){
+        modules_[path] = info;
+    }
+}
+
+bool PluginManager::checkModule(const std::string& path){
+    FileInfo info;
+    if (!getFileInfo(path, info)){
+        return false; // let IFactory::load() deal with it
+    }
+    Lock lock(mutex_);
+    bool changed = false;
+    if (cache_){
+        int index = cache_->findModule(path);
+        if (index >= 0){
+            changed = loadModule(index);
+        }
+    }
+    bool modified = doCheckModule(path, info);
+    if (changed || modified){
+        publish();
+    }
+    return modified;
+}
+
+bool PluginManager::doCheckModule(const std::string& path, const FileInfo& info){
+    auto it = modules_.find(path);
+    if (it == modules_.end()){
+        // no file info yet (e.g. from an old cache file), so we trust the existing entry
+        if (factories_.count(path) || exceptions_.count(path)){
+            modules_[path] = info;
+        }
+        return false;
+    }
+    if (it->second.sameFile(info)){
+        return false;
+    }
+    LOG_VERBOSE("module '" << path << "' has been modified");
+    removeModule(path);
+    journal_.emplace_back(JournalOp::Remove, path);
+    return true;
+}
+
+// remove the factory, plugins, black-list entry and file info of a module
+void PluginManager::removeModule(const std::string& path){
+    modules_.erase(path);
+    exceptions_.erase(path);
+    changedExceptions_.insert(path);
+    auto factory = factories_.find(path);
+    if (factory != factories_.end()){
+        // remove all keys referring to plugins of this module
+        std::unordered_set<PluginInfo::const_ptr> plugins;
+        for (int i = 0; i < factory->second->numPlugins(); ++i){
+            plugins.insert(factory->second->getPlugin(i));
+        }
+        for (auto p = plugins_.begin(); p != plugins_.end(); ){
+            if (plugins.count(p->second)){
+                changedPlugins_.insert(p->first);
+                p = plugins_.erase(p);
+            } else {
+                ++p;
+            }
+        }
+        factories_.erase(factory);
+        changedFactories_.insert(path);
+    }
+}
+
+// like removeModule(), but also make sure that the module won't be loaded from the binary cache
+void PluginManager::forgetModule(const std::string& path){
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        // the module might have been materialized by a lookup in the meantime
+        mergeModules();
+        if (cache_){
+            int index = cache_->findModule(path);
+            if (index >= 0 && !loaded_[index]){
+                loaded_[index] = true;
+                dropModule(cache_->getModule(index));
+            }
+        }
+    }
+    removeModule(path);
+}
+
+std::vector<std::string> PluginManager::removeModules(const std::string& path, bool missing){
+    auto match = [&](const std::string& module){
+        if (module.size() < path.size() || module.compare(0, path.size(), path)){
+            return false;
+        }
+        return module.size() == path.size()
+                || module[path.size()] == '/' || module[path.size()] == '\\';
+    };
+    std::unordered_set<std::string> found;
+    Lock lock(mutex_);
+    std::unique_lock<std::mutex> cacheLock(cacheMutex_);
+    mergeModules();
+    if (cache_){
+        int n = cache_->numModules();
+        for (int i = 0; i < n; ++i){
+            if (!loaded_[i]){
+                auto module = cache_->getModule(i);
+                if (match(module.path)) found.insert(module.path);
+            }
+        }
+    }
+    cacheLock.unlock();
+    for (auto& it : factories_){
+        if (match(it.first)) found.insert(it.first);
+    }
+    for (auto& it : exceptions_){
+        if (match(it)) found.insert(it);
+    }
+    for (auto& it : modules_){
+        if (match(it.first)) found.insert(it.first);
+    }
+    std::vector<std::string> result;
+    for (auto& module : found){
+        if (!missing || !pathExists(module)){
+            result.push_back(module);
+        }
+    }
+    std::sort(result.begin(), result.end());
+    for (auto& module : result){
+        LOG_VERBOSE("module '" << module << "' has been removed");
+        forgetModule(module);
+        journal_.emplace_back(JournalOp::Remove, module);
+    }
+    if (!result.empty()){
+        publish();
+    }
+    return result;
+}
+
+IFactory::ptr PluginManager::findDuplicate(const std::string& path){
+    FileInfo info;
+    if (!getFileInfo(path, info)){
+        return nullptr;
+    }
+    // collect valid modules of the same size
+    struct Candidate {
+        std::string path;
+        FileInfo info;
+        IFactory::ptr factory;
+    };
+    std::vector<Candidate> candidates;
+    {
+        Lock lock(mutex_);
+        // only load the cached modules which can be duplicates
+        if (cache_){
+            bool changed = false;
+            int n = cache_->numModules();
+            for (int i = 0; i < n; ++i){
+                auto module = cache_->getModule(i);
+                if (module.haveInfo && module.info.size == info.size && module.path != path){
+                    changed |= loadModule(i);
+                }
+            }
+            if (changed){
+                publish();
+            }
+        }
+        for (auto& it : modules_){
+            if (it.second.size == info.size && it.first != path){
+                auto factory = factories_.find(it.first);
+                if (factory != factories_.end() && factory->second->valid()){
+                    candidates.push_back({ it.first, it.second, factory->second });
+                }
+            }
+        }
+    }
+    if (candidates.empty()){
+        return nullptr;
+    }
+    // only now compare the content hashes (which might be expensive)
+    info.hash = hashFile(path);
+    if (!info.hash){
+        return nullptr;
+    }
+    for (auto& c : candidates){
+        if (!c.info.hash){
+            c.info.hash = hashFile(c.path);
+            // store hash
+            Lock lock(mutex_);
+            auto it = modules_.find(c.path);
+            if (it != modules_.end() && it->second.sameFile(c.info)){
+                it->second.hash = c.info.hash;
+            }
+        }
+        if (c.info.hash == info.hash){
+            LOG_DEBUG("'" << path << "' is identical to '" << c.path << "'");
+            // make new factory with copies of the plugin descriptions
+            IFactory::ptr factory;
+            try {
+                factory = IFactory::load(path);
+            } catch (const Error& e){
+                return nullptr;
+            }
+            for (int i = 0; i < c.factory->numPlugins(); ++i){
+                std::stringstream ss;
+                c.factory->getPlugin(i)->serialize(ss);
+                auto desc = std::make_shared<PluginInfo>(factory);
+                desc->deserialize(ss);
+                desc->path = factory->path();
+                factory->addPlugin(desc);
+            }
+            // store hash
+            Lock lock(mutex_);
+            modules_[path] = info;
+            return factory;
+        }
+    }
+    return nullptr;
 }
 
 void PluginManager::addPlugin(const std::string& key, PluginInfo::const_ptr plugin) {
     Lock lock(mutex_);
     plugins_[key] = std::move(plugin);
+    changedPlugins_.insert(key);
+    publish();
 }
 
-PluginInfo::const_ptr PluginManager::findPlugin(const std::string& key) const {
-    SharedLock lock(mutex_);
-    auto desc = plugins_.find(key);
-    if (desc != plugins_.end()){
-        return desc->second;
+PluginInfo::const_ptr PluginManager::findPlugin(const std::string& key) {
+    waitForLoad([&](const Snapshot& s){
+        return s.plugins.find(key) || (s.cache && s.cache->findKey(key) >= 0);
+    });
+    auto snapshot = std::atomic_load(&snapshot_);
+    auto desc = snapshot->plugins.find(key);
+    if (desc){
+        return *desc;
+    }
+    // try to load from binary cache
+    if (snapshot->cache){
+        int index = snapshot->cache->findKey(key);
+        int module = index >= 0 ? snapshot->cache->getPluginModule(index) : -1;
+        if (module >= 0){
+            loadCachedModule(snapshot->cache, module);
+            snapshot = std::atomic_load(&snapshot_);
+            desc = snapshot->plugins.find(key);
+            if (desc){
+                return *desc;
+            }
+        }
     }
     return nullptr;
 }
 
+PluginInfo::const_ptr PluginManager::probeFull(PluginInfo::const_ptr plugin){
+    findFactory(plugin->path); // make sure that the module has been loaded from the cache
+    IFactory::ptr factory;
+    {
+        Lock lock(mutex_);
+        {
+            std::lock_guard<std::mutex> cacheLock(cacheMutex_);
+            mergeModules();
+        }
+        auto it = factories_.find(plugin->path);
+        if (it == factories_.end()){
+            throw Error(Error::ModuleError, "couldn't find module '" + plugin->path.str() + "'");
+        }
+        factory = it->second;
+    }
+    // probe without holding the lock, this can take a while!
+    auto result = factory->probeFull(*plugin); // throws on error
+    Lock lock(mutex_);
+    factory->addPlugin(result);
+    for (auto& it : plugins_){
+        if (it.second == plugin){
+            it.second = result;
+            changedPlugins_.insert(it.first);
+        }
+    }
+    journal_.emplace_back(JournalOp::Add, plugin->path);
+    publish();
+    return result;
+}
+
+std::vector<PluginInfo::const_ptr> PluginManager::query(const PluginIndex::Query& q){
+    std::shared_ptr<const PluginIndex> index;
+    {
+        Lock lock(mutex_);
+        bool removed;
+        {
+            std::lock_guard<std::mutex> cacheLock(cacheMutex_);
+            mergeModules();
+            removed = !removedKeys_.empty();
+        }
+        if (removed){
+            publish(); // resets the index
+        }
+        if (!index_){
+            // a plugin can be stored under several keys
+            std::unordered_set<PluginInfo::const_ptr> unique;
+            for (auto& it : plugins_){
+                unique.insert(it.second);
+            }
+            std::vector<int> cached;
+            {
+                std::lock_guard<std::mutex> cacheLock(cacheMutex_);
+                getCachedPlugins(cached);
+            }
+            index_ = std::make_shared<const PluginIndex>(
+                std::vector<PluginInfo::const_ptr>(unique.begin(), unique.end()),
+                cache_, std::move(cached));
+            LOG_DEBUG("built plugin index (" << index_->size() << " plugins)");
+        }
+        index = index_;
+    }
+    // the index is immutable, so we can release the lock
+    return index->query(q);
+}
+
+uint64_t PluginManager::firstVersion(){
+    using namespace std::chrono;
+    return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+uint64_t PluginManager::version() const {
+    SharedLock lock(mutex_);
+    return version_;
+}
+
+uint64_t PluginManager::changes(uint64_t since, std::vector<Change>& result, bool& reset){
+    Lock lock(mutex_);
+    bool removed;
+    {
+        std::lock_guard<std::mutex> cacheLock(cacheMutex_);
+        mergeModules();
+        removed = !removedKeys_.empty();
+    }
+    if (removed){
+        publish(); // log the removals
+    }
+    result.clear();
+    reset = since < logStart_ || since > version_;
+    if (reset){
+        for (auto& it : plugins_){
+            result.push_back({ Change::Add, it.first, it.second });
+        }
+        // plugins in the binary cache
+        std::vector<int> cached;
+        {
+            std::lock_guard<std::mutex> cacheLock(cacheMutex_);
+            getCachedPlugins(cached);
+        }
+        std::vector<std::string> keys;
+        for (auto& index : cached){
+            PluginInfo::const_ptr plugin = cache_->makePlugin(index, nullptr, keys);
+            for (auto& key : keys){
+                result.push_back({ Change::Add, key, plugin });
+            }
+        }
+    } else {
+        // collapse the operations per key (in order of their first change)
+        std::unordered_map<std::string, std::pair<Change::Op, Change::Op>> ops;
+        std::vector<const std::string *> keys;
+        auto it = std::upper_bound(changeLog_.begin(), changeLog_.end(), since,
+                                   [](uint64_t v, const LogEntry& e){ return v < e.version; });
+        for (; it != changeLog_.end(); ++it){
+            auto found = ops.find(it->key);
+            if (found != ops.end()){
+                found->second.second = it->op;
+            } else {
+                auto entry = ops.emplace(it->key, std::make_pair(it->op, it->op)).first;
+                keys.push_back(&entry->first);
+            }
+        }
+        for (auto& key : keys){
+            auto& op = ops[*key];
+            if (op.second == Change::Remove){
+                if (op.first != Change::Add){
+                    result.push_back({ Change::Remove, *key, nullptr });
+                } // else: added and removed again
+            } else {
+                auto plugin = plugins_.find(*key);
+                if (plugin != plugins_.end()){
+                    result.push_back({ op.first == Change::Add ? Change::Add : Change::Modify,
+                                       *key, plugin->second });
+                }
+            }
+        }
+    }
+    return version_;
+}
+
+// publish a new snapshot of the current maps; must be called with the lock held.
+void PluginManager::publish(){
+    std::shared_ptr<const Snapshot> old;
+    while (true){
+        old = std::atomic_load(&snapshot_);
+        // lookups might add modules from the binary cache at any time (see publishModule()).
+        // NB: every module in 'old' must be merged, otherwise update() might drop it.
+        {
+            std::lock_guard<std::mutex> lock(cacheMutex_);
+            mergeModules();
+        }
+        auto snapshot = std::make_shared<Snapshot>();
+        snapshot->factories = old->factories.update(factories_, changedFactories_);
+        snapshot->plugins = old->plugins.update(plugins_, changedPlugins_);
+        snapshot->exceptions = old->exceptions.update(exceptions_, changedExceptions_);
+        snapshot->cache = cache_;
+        std::shared_ptr<const Snapshot> desired(std::move(snapshot));
+        if (std::atomic_compare_exchange_strong(&snapshot_, &old, desired)){
+            break;
+        }
+    }
+    if (!changedPlugins_.empty() || !removedKeys_.empty()){
+        index_ = nullptr;
+        // update change log
+        version_++;
+        for (auto& key : changedPlugins_){
+            bool existed = old->plugins.find(key) != nullptr;
+            bool exists = plugins_.count(key) > 0;
+            if (existed || exists){
+                auto op = !existed ? Change::Add : !exists ? Change::Remove : Change::Modify;
+                changeLog_.push_back({ version_, op, key });
+            }
+        }
+        // plugins from the binary cache which have never been loaded
+        for (auto& key : removedKeys_){
+            bool logged = changedPlugins_.count(key) && old->plugins.find(key);
+            if (!plugins_.count(key) && !logged){
+                changeLog_.push_back({ version_, Change::Remove, key });
+            }
+        }
+        while (changeLog_.size() > maxChangeLog){
+            logStart_ = changeLog_.front().version;
+            changeLog_.pop_front();
+        }
+    }
+    changedFactories_.clear();
+    changedPlugins_.clear();
+    changedExceptions_.clear();
+    removedKeys_.clear();
+    if (loading_){
+        // wake up waiting lookups
+        { std::lock_guard<std::mutex> lock(loadMutex_); }
+        loadCond_.notify_all();
+    }
+}
+
+// materialize a module from the binary cache and merge it into the maps;
+// returns true if any plugins or black-list entries have been added.
+bool PluginManager::loadModule(int index){
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    materializeModule(index);
+    return mergeModules();
+}
+
+// replace the binary cache; must be called with the lock held.
+void PluginManager::setCache(PluginCache::ptr cache){
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    mergeModules(); // modules of the old cache
+    cache_ = std::move(cache);
+    loaded_.assign(cache_ ? cache_->numModules() : 0, false);
+}
+
+void PluginManager::getCachedPlugins(std::vector<int>& result) const {
+    if (!cache_){
+        return;
+    }
+    std::vector<std::string> keys;
+    int n = cache_->numModules();
+    for (int i = 0; i < n; ++i){
+        if (loaded_[i]){
+            continue;
+        }
+        auto module = cache_->getModule(i);
+        if (factories_.count(module.path)){
+            continue; // probed again
+        }
+        for (int j = 0; j < module.numPlugins; ++j){
+            int index = module.firstPlugin + j;
+            cache_->getKeys(index, keys);
+            bool shadowed = std::any_of(keys.begin(), keys.end(),
+                [&](const std::string& key){ return plugins_.count(key) > 0; });
+            if (!shadowed){
+                result.push_back(index);
+            }
+        }
+    }
+}
+
+// a module in the binary cache won't be loaded, so its plugins must be
+// reported as removed (see publish()).
+void PluginManager::dropModule(const PluginCache::Module& module){
+    std::vector<std::string> keys;
+    for (int i = 0; i < module.numPlugins; ++i){
+        cache_->getKeys(module.firstPlugin + i, keys);
+        droppedKeys_.insert(droppedKeys_.end(), keys.begin(), keys.end());
+    }
+}
+
+void PluginManager::loadCachedModule(const PluginCache::ptr& cache, int index){
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    // the cache might have been replaced in the meantime
+    if (cache == cache_){
+        materializeModule(index);
+    }
+}
+
+// create the factory and plugin descriptions of a module in the binary cache and
+// add them to the snapshot; returns false if there is nothing to add.
+// NB: this only reads the (immutable) cache and snapshot, so we don't need the lock.
+bool PluginManager::materializeModule(int index){
+    if (loaded_[index]){
+        return false;
+    }
+    loaded_[index] = true;
+    auto module = cache_->getModule(index);
+    FileInfo info;
+    bool exists = getFileInfo(module.path, info);
+    if (module.haveInfo && exists && !module.info.sameFile(info)){
+        // will be probed again
+        LOG_VERBOSE("module '" << module.path << "' has been modified");
+        dropModule(module);
+        return false;
+    }
+    CachedModule result;
+    result.path = module.path;
+    result.exception = module.exception;
+    if (module.numPlugins > 0 && !std::atomic_load(&snapshot_)->factories.find(module.path)){
+        IFactory::ptr factory;
+        if (exists){
+            // unchanged modules have already been verified when they were probed
+            try {
+                factory = IFactory::load(module.path, !module.haveInfo);
+            } catch (const Error& e){
+                // this probably happens when the plugin has been (re)moved
+                LOG_ERROR("couldn't load '" << module.path << "': " << e.what());
+            }
+        } else {
+            // this probably happens when the plugin has been (re)moved
+            LOG_ERROR("couldn't load '" << module.path << "': No such file");
+        }
+        if (!factory){
+            dropModule(module);
+            if (!module.exception){
+                return false;
+            }
+        } else {
+            std::vector<std::string> keys;
+            for (int i = 0; i < module.numPlugins; ++i){
+                auto desc = cache_->makePlugin(module.firstPlugin + i, factory, keys);
+                factory->addPlugin(desc);
+                for (auto& key : keys){
+                    result.plugins.emplace_back(key, desc);
+                }
+            }
+            result.factory = std::move(factory);
+            result.haveInfo = module.haveInfo;
+            result.info = module.info;
+        }
+    } else if (!module.exception){
+        return false;
+    } else {
+        result.haveInfo = module.haveInfo;
+        result.info = module.info;
+    }
+    publishModule(result);
+    loadedModules_.push_back(std::move(result));
+    return true;
+}
+
+// add a materialized module to the snapshot without taking the lock.
+// if a writer publishes in the meantime, we just try again.
+void PluginManager::publishModule(const CachedModule& module){
+    std::vector<std::pair<std::string, IFactory::ptr>> factories;
+    std::vector<std::pair<std::string, bool>> exceptions;
+    if (module.factory){
+        factories.emplace_back(module.path, module.factory);
+    }
+    if (module.exception){
+        exceptions.emplace_back(module.path, true);
+    }
+    auto old = std::atomic_load(&snapshot_);
+    while (true){
+        auto snapshot = std::make_shared<Snapshot>();
+        // don't overwrite entries which have been added in the meantime
+        snapshot->factories = old->factories.add(factories);
+        snapshot->plugins = old->plugins.add(module.plugins);
+        snapshot->exceptions = old->exceptions.add(exceptions);
+        snapshot->cache = old->cache;
+        std::shared_ptr<const Snapshot> desired(std::move(snapshot));
+        if (std::atomic_compare_exchange_strong(&snapshot_, &old, desired)){
+            break;
+        }
+    }
+    if (loading_){
+        // wake up waiting lookups
+        { std::lock_guard<std::mutex> lock(loadMutex_); }
+        loadCond_.notify_all();
+    }
+}
+
+// merge the modules which have been materialized by lookups into the writer maps;
+// must be called with the lock held. returns true if any modules have been merged.
+// NB: the modules are already in the snapshot, so this is not a change.
+bool PluginManager::mergeModules(){
+    if (!droppedKeys_.empty()){
+        removedKeys_.insert(removedKeys_.end(), droppedKeys_.begin(), droppedKeys_.end());
+        droppedKeys_.clear();
+    }
+    if (loadedModules_.empty()){
+        return false;
+    }
+    for (auto& module : loadedModules_){
+        if (module.exception){
+            exceptions_.insert(module.path);
+        }
+        // don't overwrite modules and plugins which have been added in the meantime
+        if (module.factory && !factories_.count(module.path)){
+            factories_[module.path] = module.factory;
+            for (auto& it : module.plugins){
+                plugins_.emplace(it.first, it.second);
+            }
+        }
+        if (module.haveInfo && !modules_.count(module.path)){
+            modules_[module.path] = module.info;
+        }
+    }
+    loadedModules_.clear();
+    return true;
+}
+
 void PluginManager::clear() {
     Lock lock(mutex_);
+    {
+        std::lock_guard<std::mutex> cacheLock(cacheMutex_);
+        cache_ = nullptr;
+        loaded_.clear();
+        loadedModules_.clear();
+        droppedKeys_.clear();
+    }
+    index_ = nullptr;
+    removedKeys_.clear();
+    // clients have to start from scratch
+    changeLog_.clear();
+    logStart_ = ++version_;
     factories_.clear();
     plugins_.clear();
     exceptions_.clear();
+    modules_.clear();
+    journal_.clear();
+    changedFactories_.clear();
+    changedPlugins_.clear();
+    changedExceptions_.clear();
+    std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>(std::make_shared<Snapshot>()));
 }
 
 bool getLine(std::istream& stream, std::string& line);
@@ -94,6 +1125,8 @@ void PluginManager::read(const std::string& path, bool update){
     bool outdated = false;
     File file(path);
     std::string line;
+    // plugins are added after reading the module info (see below)
+    std::vector<std::pair<PluginInfo::ptr, std::vector<std::string>>> plugins;
     while (getLine(file, line)){
         if (line == "[plugins]"){
             std::getline(file, line);
@@ -116,44 +1149,101 @@ void PluginManager::read(const std::string& path, bool update){
                         throw Error("bad format");
                     }
                 }
-                // scan presets
-                desc->scanPresets();
-                // load the factory (if not loaded already) to verify that the plugin still exists
-                IFactory::ptr factory;
-                if (!factories_.count(desc->path)){
-                    try {
-                        factory = IFactory::load(desc->path);
-                        factories_[desc->path] = factory;
-                    } catch (const Error& e){
-                        // this probably happens when the plugin has been (re)moved
-                        LOG_ERROR("couldn't load '" << desc->name << "': " << e.what());
-                        outdated = true; // we need to update the cache
-                        continue; // skip plugin
-                    }
-                } else {
-                    factory = factories_[desc->path];
-                }
-                factory->addPlugin(desc);
-                desc->setFactory(factory);
-                for (auto& key : keys){
-                    plugins_[key] = desc;
-                }
+                plugins.emplace_back(std::move(desc), std::move(keys));
             }
         } else if (line == "[ignore]"){
             std::getline(file, line);
             int numExceptions = getCount(line);
             while (numExceptions-- && std::getline(file, line)){
                 exceptions_.insert(line);
+                changedExceptions_.insert(line);
+            }
+        } else if (line == "[modules]"){
+            // size, mtime, inode and hash (hex), followed by the module path
+            std::getline(file, line);
+            int numModules = getCount(line);
+            while (numModules-- && std::getline(file, line)){
+                FileInfo info;
+                int onset = 0;
+                if (sscanf(line.c_str(), "%" SCNx64 ",%" SCNx64 ",%" SCNx64 ",%" SCNx64 ",%n",
+                           &info.size, &info.mtime, &info.inode, &info.hash, &onset) < 4 || !onset){
+                    throw Error("bad module info: " + line);
+                }
+                modules_[line.substr(onset)] = info;
             }
         } else {
             throw Error("bad data: " + line);
         }
     }
+    // create the factories. We only stat the files; modules which haven't changed
+    // since they have been probed don't need to be verified again.
+    std::unordered_map<std::string, IFactory::ptr> factories;
+    int count = 0;
+    for (auto& it : plugins){
+        auto& desc = it.first;
+        IFactory::ptr factory;
+        auto f = factories.find(desc->path);
+        if (f != factories.end()){
+            factory = f->second;
+        } else if (factories_.count(desc->path)){
+            factory = factories_[desc->path];
+            factories.emplace(desc->path, factory);
+        } else {
+            FileInfo info;
+            if (!getFileInfo(desc->path, info)){
+                // this probably happens when the plugin has been (re)moved
+                LOG_ERROR("couldn't load '" << desc->name << "': No such file");
+                outdated = true; // we need to update the cache
+                continue; // skip plugin
+            }
+            auto m = modules_.find(desc->path);
+            if (m != modules_.end() && !m->second.sameFile(info)){
+                continue; // modified, see below
+            }
+            try {
+                factory = IFactory::load(desc->path, m == modules_.end());
+            } catch (const Error& e){
+                LOG_ERROR("couldn't load '" << desc->name << "': " << e.what());
+                outdated = true; // we need to update the cache
+                continue; // skip plugin
+            }
+            factories_[desc->path] = factory;
+            changedFactories_.insert(desc->path);
+            factories.emplace(desc->path, factory);
+        }
+        factory->addPlugin(desc);
+        desc->setFactory(factory);
+        for (auto& key : it.second){
+            plugins_[key] = desc;
+            changedPlugins_.insert(key);
+        }
+        // let waiting lookups proceed (see beginLoad())
+        if (loading_ && (++count % 64) == 0){
+            publish();
+        }
+    }
+    // remove modules which have been modified since the last search
+    // (they will be probed again) and forget about modules which don't exist anymore.
+    for (auto it = modules_.begin(); it != modules_.end(); ){
+        FileInfo info;
+        if (!factories_.count(it->first) && !exceptions_.count(it->first)){
+            it = modules_.erase(it);
+            outdated = true;
+        } else if (getFileInfo(it->first, info) && !it->second.sameFile(info)){
+            auto module = it->first;
+            ++it; // doCheckModule() erases the entry
+            doCheckModule(module, info);
+            outdated = true;
+        } else {
+            ++it;
+        }
+    }
+    publish();
     if (update && outdated){
         // overwrite file
         file.close();
         try {
-            doWrite(path);
+            doWrite(path, plugins_, exceptions_, modules_);
         } catch (const Error& e){
             throw Error("couldn't update cache file");
         }
@@ -162,19 +1252,417 @@ void PluginManager::read(const std::string& path, bool update){
     LOG_DEBUG("read cache file " << path);
 }
 
-void PluginManager::write(const std::string &path) const {
-    SharedLock lock(mutex_);
-    doWrite(path);
+void PluginManager::write(const std::string &path) {
+    FileData data;
+    getFileData(data, false);
+    doWrite(path, data.plugins, data.exceptions, data.modules);
 }
 
-void PluginManager::doWrite(const std::string& path) const {
-    File file(path, File::WRITE);
+void PluginManager::readBinary(const std::string& path){
+    auto cache = PluginCache::open(path);
+    Lock lock(mutex_);
+    setCache(std::move(cache));
+    // load black-listed modules right away, so that isException() works as expected.
+    // this is cheap because there is nothing to load.
+    for (int i = 0; i < cache_->numModules(); ++i){
+        auto module = cache_->getModule(i);
+        if (module.exception && module.numPlugins == 0){
+            loadModule(i);
+        }
+    }
+    // the plugins of the old cache are gone; clients have to start from scratch
+    removedKeys_.clear();
+    index_ = nullptr;
+    changeLog_.clear();
+    logStart_ = ++version_;
+    publish();
+    LOG_DEBUG("read binary cache file " << path);
+}
+
+void PluginManager::writeBinary(const std::string& path){
+    std::lock_guard<std::mutex> fileLock(fileMutex_);
+    // the cache file contains all changes
+    FileData data;
+    getFileData(data, true);
+    try {
+        // NB: the old file might still be mapped by lazily loaded parameter tables,
+        // but PluginCache::write() never modifies it in place.
+        PluginCache::write(path, data.plugins, data.exceptions, data.modules);
+    } catch (const Error& e){
+        restoreJournal(data);
+        throw;
+    }
+}
+
+void PluginManager::getFileData(FileData& data, bool journal){
+    Lock lock(mutex_);
+    bool removed;
+    {
+        std::lock_guard<std::mutex> cacheLock(cacheMutex_);
+        mergeModules();
+        removed = !removedKeys_.empty();
+    }
+    if (removed){
+        publish(); // log the removals
+    }
+    std::lock_guard<std::mutex> cacheLock(cacheMutex_);
+    mergeModules(); // in case a lookup has loaded a module in the meantime
+    data.plugins = plugins_;
+    data.exceptions = exceptions_;
+    data.modules = modules_;
+    // Modules which haven't been loaded from the binary cache yet are copied as they are,
+    // so we don't have to load all modules just to write the files. The plugin descriptions
+    // don't have a factory and only read their parameter tables when they are serialized.
+    // NB: stale modules are dropped when they are eventually loaded (see materializeModule()).
+    if (cache_){
+        std::vector<int> cached;
+        getCachedPlugins(cached);
+        std::vector<std::string> keys;
+        for (auto& index : cached){
+            PluginInfo::const_ptr plugin = cache_->makePlugin(index, nullptr, keys);
+            for (auto& key : keys){
+                data.plugins.emplace(key, plugin);
+            }
+        }
+        int n = cache_->numModules();
+        for (int i = 0; i < n; ++i){
+            if (loaded_[i]){
+                continue;
+            }
+            auto module = cache_->getModule(i);
+            if (factories_.count(module.path)){
+                continue; // probed again
+            }
+            if (module.exception){
+                data.exceptions.insert(module.path);
+            }
+            if (module.haveInfo){
+                data.modules.emplace(module.path, module.info);
+            }
+        }
+    }
+    if (journal){
+        // changes that come in while we're writing remain in journal_.
+        data.journal.swap(journal_);
+    }
+}
+
+void PluginManager::restoreJournal(FileData& data){
+    // the changes haven't been written, so they have to go before the new ones.
+    Lock lock(mutex_);
+    data.journal.insert(data.journal.end(), journal_.begin(), journal_.end());
+    journal_.swap(data.journal);
+}
+
+void PluginManager::readJournal(const std::string& path){
+    std::lock_guard<std::mutex> fileLock(fileMutex_);
+    File file(path);
+    if (!file.is_open()){
+        return;
+    }
+    // split into complete records
+    std::vector<std::string> records;
+    std::string record, line;
+    while (std::getline(file, line)){
+        record += line;
+        record += "\n";
+        if (line == "[end]"){
+            records.push_back(std::move(record));
+            record.clear();
+        }
+    }
+    file.close();
+
+    Lock lock(mutex_);
+    for (auto& r : records){
+        std::stringstream ss(r);
+        try {
+            replayRecord(ss);
+        } catch (const Error& e){
+            LOG_ERROR("bad journal record: " << e.what());
+        }
+    }
+    publish();
+    if (record.find_first_not_of(" \t\r\n") != std::string::npos){
+        // the last write has been interrupted; drop the partial record,
+        // so that we can safely append to the journal again.
+        LOG_WARNING("discarding incomplete journal record");
+        auto tmpPath = path + ".tmp";
+        {
+            File tmp(tmpPath, File::WRITE);
+            for (auto& r : records){
+                tmp << r;
+            }
+            tmp.close();
+            if (!tmp){
+                throw Error("couldn't write file " + tmpPath);
+            }
+        }
+        if (!renameFile(tmpPath, path)){
+            removeFile(tmpPath);
+            throw Error("couldn't replace file " + path);
+        }
+    }
+    LOG_DEBUG("replayed " << records.size() << " journal records from " << path);
+}
+
+// [add], [ignore] or [remove], followed by the module path, the (optional) file info
+// and - for [add] - the plugins with their keys. Every record ends with [end].
+void PluginManager::replayRecord(std::istream& file){
+    std::string type, line;
+    if (!getLine(file, type) || !getLine(file, line) || line.compare(0, 5, "path=") != 0){
+        throw Error("bad format");
+    }
+    auto path = line.substr(5);
+    if (type == "[remove]"){
+        forgetModule(path);
+        return;
+    }
+    FileInfo info;
+    bool haveInfo = false;
+    if (!getLine(file, line)){
+        throw Error("bad format");
+    }
+    if (line.compare(0, 5, "info=") == 0){
+        if (sscanf(line.c_str() + 5, "%" SCNx64 ",%" SCNx64 ",%" SCNx64 ",%" SCNx64,
+                   &info.size, &info.mtime, &info.inode, &info.hash) < 4){
+            throw Error("bad module info: " + line);
+        }
+        haveInfo = true;
+        if (!getLine(file, line)){
+            throw Error("bad format");
+        }
+    }
+    // skip modules which have been modified in the meantime (they will be probed again)
+    FileInfo current;
+    bool exists = getFileInfo(path, current);
+    if (haveInfo && exists && !info.sameFile(current)){
+        LOG_VERBOSE("module '" << path << "' has been modified");
+        forgetModule(path);
+        return;
+    }
+    if (type == "[ignore]"){
+        exceptions_.insert(path);
+        changedExceptions_.insert(path);
+    } else if (type == "[add]"){
+        int numPlugins = getCount(line);
+        std::vector<std::pair<PluginInfo::ptr, std::vector<std::string>>> plugins;
+        while (numPlugins--){
+            auto desc = std::make_shared<PluginInfo>();
+            desc->deserialize(file);
+            std::vector<std::string> keys;
+            if (!getLine(file, line) || line != "[keys]"){
+                throw Error("bad format");
+            }
+            std::getline(file, line);
+            int n = getCount(line);
+            while (n-- && std::getline(file, line)){
+                keys.push_back(std::move(line));
+            }
+            plugins.emplace_back(std::move(desc), std::move(keys));
+        }
+        // replace the old entry
+        forgetModule(path);
+        // this probably happens when the plugin has been (re)moved
+        if (!exists){
+            LOG_ERROR("couldn't load '" << path << "': No such file");
+            return;
+        }
+        // unchanged modules have already been verified when they were probed
+        IFactory::ptr factory;
+        try {
+            factory = IFactory::load(path, !haveInfo);
+        } catch (const Error& e){
+            // this probably happens when the plugin has been (re)moved
+            LOG_ERROR("couldn't load '" << path << "': " << e.what());
+            return;
+        }
+        for (auto& it : plugins){
+            auto& desc = it.first;
+            factory->addPlugin(desc);
+            desc->setFactory(factory);
+            for (auto& key : it.second){
+                plugins_[key] = desc;
+                changedPlugins_.insert(key);
+            }
+        }
+        factories_[path] = factory;
+        changedFactories_.insert(path);
+    } else {
+        throw Error("bad record type: " + type);
+    }
+    if (haveInfo){
+        modules_[path] = info;
+    }
+}
+
+uint64_t PluginManager::writeJournal(const std::string& path){
+    std::lock_guard<std::mutex> fileLock(fileMutex_);
+    std::stringstream ss;
+    {
+        Lock lock(mutex_);
+        if (journal_.empty()){
+            return 0;
+        }
+        doWriteJournal(ss);
+        journal_.clear();
+    }
+    auto data = ss.str();
+    if (data.empty()){
+        return 0;
+    }
+    File file(path, File::APPEND);
     if (!file.is_open()){
-        throw Error("couldn't create file " + path);
+        throw Error("couldn't open journal file " + path);
+    }
+    file << data;
+    file.flush();
+    if (!file){
+        throw Error("couldn't write journal file " + path);
+    }
+    uint64_t size = file.tellp();
+    LOG_DEBUG("wrote journal file: " << path);
+    return size;
+}
+
+void PluginManager::doWriteJournal(std::ostream& file) const {
+    // collect the keys of all plugins of added modules
+    std::unordered_map<PluginInfo::const_ptr, std::vector<std::string>> pluginMap;
+    for (auto& op : journal_){
+        if (op.first == JournalOp::Add){
+            auto factory = factories_.find(op.second);
+            if (factory != factories_.end()){
+                for (int i = 0; i < factory->second->numPlugins(); ++i){
+                    pluginMap[factory->second->getPlugin(i)];
+                }
+            }
+        }
+    }
+    if (!pluginMap.empty()){
+        for (auto& it : plugins_){
+            auto keys = pluginMap.find(it.second);
+            if (keys != pluginMap.end()){
+                keys->second.push_back(it.first);
+            }
+        }
+    }
+    auto writeHeader = [&](const char *type, const std::string& path){
+        file << type << "\n";
+        file << "path=" << path << "\n";
+        auto info = modules_.find(path);
+        if (info != modules_.end()){
+            auto& i = info->second;
+            file << std::hex << "info=" << i.size << "," << i.mtime << ","
+                 << i.inode << "," << i.hash << std::dec << "\n";
+        }
+    };
+    for (auto& op : journal_){
+        auto& path = op.second;
+        if (op.first == JournalOp::Add){
+            auto factory = factories_.find(path);
+            if (factory == factories_.end()){
+                continue; // removed in the meantime
+            }
+            writeHeader("[add]", path);
+            int numPlugins = factory->second->numPlugins();
+            file << "n=" << numPlugins << "\n";
+            for (int i = 0; i < numPlugins; ++i){
+                auto plugin = factory->second->getPlugin(i);
+                plugin->serialize(file);
+                file << "[keys]\n";
+                auto& keys = pluginMap[plugin];
+                file << "n=" << keys.size() << "\n";
+                for (auto& key : keys){
+                    file << key << "\n";
+                }
+            }
+        } else if (op.first == JournalOp::Ignore){
+            if (!exceptions_.count(path)){
+                continue; // removed in the meantime
+            }
+            writeHeader("[ignore]", path);
+        } else {
+            file << "[remove]\n";
+            file << "path=" << path << "\n";
+        }
+        file << "[end]\n";
+    }
+}
+
+void PluginManager::compact(const std::string& cachePath, const std::string& iniPath,
+                            const std::string& journalPath){
+    std::unique_lock<std::mutex> lock(compactMutex_);
+    // a running compaction only has to be repeated once
+    compactCachePath_ = cachePath;
+    compactIniPath_ = iniPath;
+    compactJournalPath_ = journalPath;
+    compactPending_ = true;
+    if (!compactThread_.joinable()){
+        compactThread_ = std::thread(&PluginManager::compactThreadFunction, this);
+    }
+    lock.unlock();
+    compactCond_.notify_one();
+}
+
+void PluginManager::compactThreadFunction(){
+    std::unique_lock<std::mutex> lock(compactMutex_);
+    while (true){
+        compactCond_.wait(lock, [&](){ return compactPending_ || compactQuit_; });
+        if (!compactPending_){
+            break; // quit
+        }
+        auto cachePath = compactCachePath_;
+        auto iniPath = compactIniPath_;
+        auto journalPath = compactJournalPath_;
+        compactPending_ = false;
+        lock.unlock();
+
+        doCompact(cachePath, iniPath, journalPath);
+
+        lock.lock();
+    }
+}
+
+void PluginManager::doCompact(const std::string& cachePath, const std::string& iniPath,
+                              const std::string& journalPath){
+    std::lock_guard<std::mutex> fileLock(fileMutex_);
+    // the binary cache file contains everything that has been written to the journal
+    // and the pending journal entries.
+    FileData data;
+    getFileData(data, true);
+    try {
+        PluginCache::write(cachePath, data.plugins, data.exceptions, data.modules);
+    } catch (const Error& e){
+        restoreJournal(data);
+        LOG_ERROR("couldn't compact cache files: " << e.what());
+        return;
+    }
+    try {
+        if (pathExists(journalPath) && !removeFile(journalPath)){
+            throw Error("couldn't remove journal file " + journalPath);
+        }
+        // the INI file is kept for backwards compatibility (and for humans)
+        doWrite(iniPath, data.plugins, data.exceptions, data.modules);
+        LOG_DEBUG("compacted cache files");
+    } catch (const Error& e){
+        LOG_ERROR("couldn't compact cache files: " << e.what());
+    }
+}
+
+void PluginManager::doWrite(const std::string& path,
+                            const std::unordered_map<std::string, PluginInfo::const_ptr>& plugins,
+                            const std::unordered_set<std::string>& exceptions,
+                            const std::unordered_map<std::string, FileInfo>& modules) {
+    // write to temporary file and then replace the actual file,
+    // so that a crash can't leave a partial file behind.
+    auto tmpPath = path + ".tmp";
+    File file(tmpPath, File::WRITE);
+    if (!file.is_open()){
+        throw Error("couldn't create file " + tmpPath);
     }
     // inverse mapping (plugin -> keys)
     std::unordered_map<PluginInfo::const_ptr, std::vector<std::string>> pluginMap;
-    for (auto& it : plugins_){
+    for (auto& it : plugins){
         pluginMap[it.second].push_back(it.first);
     }
 #if 0
@@ -215,10 +1703,29 @@ void PluginManager::doWrite(const std::string& path) const {
     }
     // serialize exceptions
     file << "[ignore]\n";
-    file << "n=" << exceptions_.size() << "\n";
-    for (auto& e : exceptions_){
+    file << "n=" << exceptions.size() << "\n";
+    for (auto& e : exceptions){
         file << e << "\n";
     }
+    // serialize module file info
+    file << "[modules]\n";
+    file << "n=" << modules.size() << "\n";
+    file << std::hex;
+    for (auto& it : modules){
+        auto& info = it.second;
+        file << info.size << "," << info.mtime << "," << info.inode << ","
+             << info.hash << "," << it.first << "\n";
+    }
+    file << std::dec;
+    file.close();
+    if (!file){
+        removeFile(tmpPath);
+        throw Error("couldn't write file " + tmpPath);
+    }
+    if (!renameFile(tmpPath, path)){
+        removeFile(tmpPath);
+        throw Error("couldn't replace file " + path);
+    }
     LOG_DEBUG("wrote cache file: " << path);
 }
 
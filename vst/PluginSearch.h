@@ -0,0 +1,406 @@
+#pragma once
+
+#include "Interface.h"
+#include "PluginManager.h"
+
+#include <string>
+#include <cstring>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+namespace vst {
+
+// plugin search and probe engine shared by the hosts
+//
+// A search runs as a pipeline of three stages:
+// 1) traversal: all search paths are walked concurrently (see vst::search()) and every
+//    module is passed to the search thread as soon as it is found. Modules which are
+//    already known (or black-listed) are answered by the PluginManager.
+// 2) probe: new modules are probed in separate processes with at most
+//    ProbeOptions::getNumParallelProbes() probes in flight. The probe processes are awaited
+//    on helper threads, so a slow plugin doesn't hold back the others.
+// 3) results: finished probes are collected on the search thread in the order of completion,
+//    registered with the PluginManager, logged and passed to the result callback.
+//
+// All callbacks are called on the thread which runs search() resp. probe(). The engine
+// formats the messages, the host only decides how (and whether) to post them.
+
+// VST2: plug-in name
+// VST3: plug-in name + ".vst3"
+std::string makeKey(const PluginInfo& desc);
+
+class PluginSearch {
+ public:
+    enum class LogLevel {
+        Error,
+        Normal,
+        Verbose // probe results, black-listed and known modules
+    };
+    // 'msg' is a complete message, but it might consist of several lines.
+    using LogFunction = std::function<void(LogLevel level, const std::string& msg)>;
+    // called after a new factory and its plugins have been added to the manager,
+    // e.g. to register additional keys.
+    using FactoryFunction = std::function<void(const IFactory& factory)>;
+    // called for every plugin which has been found
+    using PluginFunction = std::function<void(const PluginInfo::const_ptr& plugin)>;
+
+    PluginSearch(PluginManager& manager, LogFunction log, FactoryFunction added = nullptr);
+
+    // load the factory for a module which hasn't been probed yet.
+    // returns nullptr if the module is black-listed or can't be loaded (then it is black-listed).
+    IFactory::ptr loadFactory(const std::string& path);
+    // add a factory and all its plugins to the manager
+    void addFactory(const std::string& path, IFactory::ptr factory);
+    // probe a single module; 'options.quick': only scan the plugin metadata (see IFactory::probe()).
+    // returns nullptr on failure (then the module is black-listed).
+    IFactory::ptr probe(const std::string& path, const ProbeOptions& options = ProbeOptions());
+    // search directories for plugins; new modules are only scanned (see above).
+    // the search stops early if 'cancel' is set. returns the number of plugins found.
+    // 'options': probe timeout and concurrency for this search ('quick' is implied).
+    int search(const std::vector<std::string>& paths, bool parallel,
+               const PluginFunction& fn, const std::atomic<bool> *cancel = nullptr,
+               const ProbeOptions& options = ProbeOptions());
+    // e.g. "ok!" or "timed out! <reason>"; sub-plugins start on a new line.
+    static void formatResult(std::ostream& os, const ProbeResult& result);
+ private:
+    struct ProbeJob {
+        std::string path;
+        IFactory::ptr factory; // nullptr on failure
+        std::string log;
+    };
+    using ProbeFuture = std::function<ProbeJob()>;
+    class ProbeQueue;
+    ProbeFuture probeAsync(const std::string& path, const ProbeOptions& options);
+    IFactory::ptr finishProbe(ProbeJob& job);
+    PluginManager& manager_;
+    LogFunction log_;
+    FactoryFunction added_;
+};
+
+// implementation
+
+std::string makeKey(const PluginInfo& desc){
+    std::string key;
+    auto ext = ".vst3";
+    auto onset = std::max<size_t>(0, desc.path.size() - strlen(ext));
+    if (desc.path.str().find(ext, onset) != std::string::npos){
+        key = desc.name + ext;
+    } else {
+        key = desc.name;
+    }
+    return key;
+}
+
+// Runs probe futures on helper threads, so that we can collect the results
+// in the order of completion; a slow plugin doesn't hold back the others.
+class PluginSearch::ProbeQueue {
+ public:
+    ProbeQueue(const ProbeOptions& options) : options_(options) {}
+    ~ProbeQueue();
+    void push(ProbeFuture future);
+    // wait for the next finished probe
+    ProbeJob pop();
+    int numPending() const { return numPending_; }
+ private:
+    void threadFunction();
+    std::deque<ProbeFuture> jobs_;
+    std::deque<ProbeJob> results_;
+    std::vector<std::thread> threads_;
+    int numPending_ = 0; // only accessed by the owner
+    int numIdleThreads_ = 0;
+    ProbeOptions options_;
+    bool quit_ = false;
+    std::mutex mutex_;
+    std::condition_variable jobCondition_;
+    std::condition_variable resultCondition_;
+};
+
+PluginSearch::ProbeQueue::~ProbeQueue(){
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    jobCondition_.notify_all();
+    for (auto& thread : threads_){
+        thread.join();
+    }
+}
+
+void PluginSearch::ProbeQueue::push(ProbeFuture future){
+    std::unique_lock<std::mutex> lock(mutex_);
+    jobs_.push_back(std::move(future));
+    numPending_++;
+    // spawn a new thread if necessary
+    if ((int)jobs_.size() > numIdleThreads_ && (int)threads_.size() < options_.getNumParallelProbes()){
+        threads_.push_back(std::thread(&ProbeQueue::threadFunction, this));
+    }
+    lock.unlock();
+    jobCondition_.notify_one();
+}
+
+PluginSearch::ProbeJob PluginSearch::ProbeQueue::pop(){
+    std::unique_lock<std::mutex> lock(mutex_);
+    resultCondition_.wait(lock, [&](){ return !results_.empty(); });
+    auto job = std::move(results_.front());
+    results_.pop_front();
+    numPending_--;
+    return job;
+}
+
+void PluginSearch::ProbeQueue::threadFunction(){
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true){
+        numIdleThreads_++;
+        jobCondition_.wait(lock, [&](){ return !jobs_.empty() || quit_; });
+        numIdleThreads_--;
+        if (jobs_.empty()){
+            break; // quit
+        }
+        auto future = std::move(jobs_.front());
+        jobs_.pop_front();
+        lock.unlock();
+
+        auto job = future(); // wait for the probe process(es)
+
+        lock.lock();
+        results_.push_back(std::move(job));
+        resultCondition_.notify_one();
+    }
+}
+
+PluginSearch::PluginSearch(PluginManager& manager, LogFunction log, FactoryFunction added)
+    : manager_(manager), log_(std::move(log)), added_(std::move(added)) {}
+
+IFactory::ptr PluginSearch::loadFactory(const std::string& path){
+    if (manager_.findFactory(path)){
+        LOG_ERROR("bug in PluginSearch::loadFactory");
+        return nullptr;
+    }
+    if (manager_.isException(path)){
+        log_(LogLevel::Verbose, "'" + path + "' is black-listed");
+        return nullptr;
+    }
+    try {
+        return IFactory::load(path);
+    } catch (const Error& e){
+        log_(LogLevel::Error, "couldn't load '" + path + "': " + e.what());
+        manager_.addException(path);
+        return nullptr;
+    }
+}
+
+void PluginSearch::addFactory(const std::string& path, IFactory::ptr factory){
+    if (factory->numPlugins() == 1){
+        auto plugin = factory->getPlugin(0);
+        // factories with a single plugin can also be aliased by their file path(s)
+        manager_.addPlugin(plugin->path, plugin);
+        manager_.addPlugin(path, plugin);
+    }
+    manager_.addFactory(path, factory);
+    for (int i = 0; i < factory->numPlugins(); ++i){
+        auto plugin = factory->getPlugin(i);
+        manager_.addPlugin(makeKey(*plugin), plugin);
+    }
+    if (added_){
+        added_(*factory);
+    }
+}
+
+void PluginSearch::formatResult(std::ostream& os, const ProbeResult& result){
+    if (result.total > 1){
+        os << "\n\t[" << (result.index + 1) << "/" << result.total << "] ";
+        if (result.plugin && !result.plugin->name.empty()){
+            os << "'" << result.plugin->name << "' ";
+        }
+        os << "... ";
+    }
+    auto& e = result.error;
+    switch (e.code()){
+    case Error::NoError:
+        os << "ok!";
+        break;
+    case Error::Crash:
+        os << "crashed!";
+        break;
+    case Error::Timeout:
+        os << "timed out! " << e.what();
+        break;
+    case Error::SystemError:
+        os << "error! " << e.what();
+        break;
+    case Error::ModuleError:
+        os << "couldn't load! " << e.what();
+        break;
+    case Error::PluginError:
+        os << "failed! " << e.what();
+        break;
+    default:
+        os << "unexpected error! " << e.what();
+        break;
+    }
+}
+
+// result stage: register resp. black-list the module and post the log
+IFactory::ptr PluginSearch::finishProbe(ProbeJob& job){
+    if (job.factory && job.factory->valid()){
+        addFactory(job.path, job.factory);
+    } else {
+        manager_.addException(job.path);
+        job.factory = nullptr;
+    }
+    if (!job.log.empty()){
+        log_(LogLevel::Verbose, job.log);
+    }
+    return job.factory;
+}
+
+IFactory::ptr PluginSearch::probe(const std::string& path, const ProbeOptions& options){
+    ProbeJob job;
+    job.path = path;
+    job.factory = loadFactory(path);
+    if (!job.factory){
+        return nullptr;
+    }
+    std::stringstream log;
+    log << "probing '" << path << "'... ";
+    try {
+        job.factory->probe([&](const ProbeResult& result){
+            formatResult(log, result);
+        }, options);
+    } catch (const Error& e){
+        ProbeResult result;
+        result.error = e;
+        formatResult(log, result);
+        job.factory = nullptr;
+    }
+    job.log = log.str();
+    return finishProbe(job);
+}
+
+// probe stage: start the probe process(es) and return a future which waits for the results.
+// the future doesn't touch the manager, so it can run on any thread.
+PluginSearch::ProbeFuture PluginSearch::probeAsync(const std::string& path,
+                                                   const ProbeOptions& options){
+    auto factory = loadFactory(path);
+    if (!factory){
+        return [path](){ return ProbeJob { path, nullptr, "" }; };
+    }
+    try {
+        auto future = factory->probeAsync(options);
+        return [=](){
+            // several futures might run concurrently, so we collect the messages
+            std::stringstream log;
+            log << "probing '" << path << "'... ";
+            future([&](const ProbeResult& result){
+                formatResult(log, result);
+            });
+            return ProbeJob { path, factory, log.str() };
+        };
+    } catch (const Error& e){
+        // return future which reports the error
+        return [=](){
+            std::stringstream log;
+            log << "probing '" << path << "'... ";
+            ProbeResult result;
+            result.error = e;
+            formatResult(log, result);
+            return ProbeJob { path, nullptr, log.str() };
+        };
+    }
+}
+
+int PluginSearch::search(const std::vector<std::string>& paths, bool parallel,
+                         const PluginFunction& fn, const std::atomic<bool> *cancel,
+                         const ProbeOptions& _options){
+    for (auto& path : paths){
+        log_(LogLevel::Normal, "searching in '" + path + "'...");
+    }
+    int numResults = 0;
+    // new modules are only scanned
+    auto options = _options;
+    options.quick = true;
+
+    auto addResults = [&](const IFactory::ptr& factory){
+        if (factory){
+            int numPlugins = factory->numPlugins();
+            for (int i = 0; i < numPlugins; ++i){
+                fn(factory->getPlugin(i));
+                numResults++;
+            }
+        }
+    };
+
+    ProbeQueue probeQueue(options);
+
+    // traversal stage: all search paths are traversed concurrently; new paths are passed
+    // to the callback while the previous probes are still running.
+    vst::search(paths, [&](const std::string& absPath){
+        if (cancel && *cancel){
+            return;
+        }
+        std::string pluginPath = absPath;
+    #ifdef _WIN32
+        for (auto& c : pluginPath){
+            if (c == '\\') c = '/';
+        }
+    #endif
+        // re-probe modules which have been modified since the last search
+        manager_.checkModule(pluginPath);
+        // check if module has already been loaded
+        auto factory = manager_.findFactory(pluginPath);
+        if (!factory && !manager_.isException(pluginPath)){
+            // the same module might be installed in several places
+            auto duplicate = manager_.findDuplicate(pluginPath);
+            if (duplicate){
+                addFactory(pluginPath, duplicate);
+                factory = duplicate;
+            }
+        }
+        if (factory){
+            // just post the names of valid plugins
+            std::stringstream log;
+            log << pluginPath;
+            auto numPlugins = factory->numPlugins();
+            if (numPlugins > 1){
+                for (int i = 0; i < numPlugins; ++i){
+                    log << "\n\t[" << (i + 1) << "/" << numPlugins << "] "
+                        << factory->getPlugin(i)->name;
+                }
+            }
+            log_(LogLevel::Verbose, log.str());
+            for (int i = 0; i < numPlugins; ++i){
+                fn(factory->getPlugin(i));
+                numResults++;
+            }
+        } else if (parallel){
+            // probe stage
+            probeQueue.push(probeAsync(pluginPath, options));
+            // result stage: wait for *any* probe to finish
+            while (probeQueue.numPending() >= options.getNumParallelProbes()){
+                auto job = probeQueue.pop();
+                addResults(finishProbe(job));
+            }
+        } else {
+            addResults(probe(pluginPath, options));
+        }
+    });
+    while (probeQueue.numPending() > 0){
+        auto job = probeQueue.pop();
+        addResults(finishProbe(job));
+    }
+
+    if (numResults == 1){
+        log_(LogLevel::Normal, "found 1 plugin");
+    } else {
+        log_(LogLevel::Normal, "found " + std::to_string(numResults) + " plugins");
+    }
+    return numResults;
+}
+
+} // vst
@@ -37,10 +37,16 @@
 #error No byte order defined
 #endif
 
+#include "Interface.h"
+
 #include <iostream>
 #include <fstream>
 #include <atomic>
 #include <array>
+#include <cstdint>
+#include <chrono>
+#include <vector>
+#include <algorithm>
 
 	// log level: 0 (error), 1 (warning), 2 (verbose), 3 (debug)
 #ifndef LOGLEVEL
@@ -127,6 +133,23 @@ std::string fileBaseName(const std::string& path);
 
 std::string errorMessage(int err);
 
+// file identity, used to detect modified plugin modules.
+// for bundles, the info refers to the actual binary.
+struct FileInfo {
+    uint64_t size = 0;
+    uint64_t mtime = 0; // platform specific resolution
+    uint64_t inode = 0; // file index on Windows
+    uint64_t hash = 0; // optional content hash (0: not computed)
+    bool sameFile(const FileInfo& other) const {
+        return size == other.size && mtime == other.mtime && inode == other.inode;
+    }
+};
+
+bool getFileInfo(const std::string& path, FileInfo& info);
+
+// returns 0 on failure
+uint64_t hashFile(const std::string& path);
+
 //--------------------------------------------------------------------------------------------------------
 
 // cross platform fstream, taking UTF-8 file paths.
@@ -135,7 +158,8 @@ class File : public std::fstream {
 public:
     enum Mode {
         READ,
-        WRITE
+        WRITE,
+        APPEND
     };
     File(const std::string& path, Mode mode = READ)
 #if defined(_WIN32) && (defined(_MSC_VER) || __GNUC__ >= 9)
@@ -146,7 +170,9 @@ public:
         : std::fstream(path,
 #endif
                        ios_base::binary |
-                       (mode == READ ? ios_base::in : (ios_base::out | ios_base::trunc))),
+                       (mode == READ ? ios_base::in :
+                        mode == APPEND ? (ios_base::out | ios_base::app) :
+                            (ios_base::out | ios_base::trunc))),
           path_(path){}
 protected:
     std::string path_;
@@ -154,6 +180,82 @@ protected:
 
 //--------------------------------------------------------------------------------------------------------
 
+// measures the DSP load of a single plugin instance and reports it with addDspLoad(),
+// so that probing can be throttled while the host is busy.
+// begin() and end() are called in the audio thread around the actual processing.
+class DspLoadMeter {
+ public:
+    ~DspLoadMeter(){
+        addDspLoad(-load_);
+    }
+    void begin(){
+        start_ = std::chrono::steady_clock::now();
+    }
+    void end(int numSamples, double sampleRate){
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+        double period = numSamples / sampleRate;
+        if (period > 0){
+            // smooth over several blocks
+            double load = load_ + (elapsed / period - load_) * 0.05;
+            addDspLoad(load - load_);
+            load_ = load;
+        }
+    }
+ private:
+    std::chrono::steady_clock::time_point start_;
+    double load_ = 0;
+};
+
+//--------------------------------------------------------------------------------------------------------
+
+// preallocated scratch memory for the process routines, so they don't need alloca.
+// one 64-byte aligned block holds a zero buffer, a discard buffer (both large enough
+// for 'blockSize' double precision samples) and a table of 'numPointers' channel pointers.
+// The zero buffer is only cleared in reset(), so it must never be used as an output!
+// reset() allocates memory and must not be called concurrently with the process routine.
+class ScratchArena {
+ public:
+    static const size_t alignment = 64;
+
+    void reset(int blockSize, int numPointers){
+        auto bufsize = align(sizeof(double) * blockSize);
+        auto size = bufsize * 2 + sizeof(void *) * numPointers;
+        if (size + alignment > memory_.size()){
+            memory_.assign(size + alignment, 0);
+        } else {
+            std::fill(memory_.begin(), memory_.end(), 0);
+        }
+        auto addr = reinterpret_cast<uintptr_t>(memory_.data());
+        zeros_ = memory_.data() + (align(addr) - addr);
+        discard_ = zeros_ + bufsize;
+        pointers_ = reinterpret_cast<void **>(discard_ + bufsize);
+        blockSize_ = blockSize;
+        numPointers_ = numPointers;
+    }
+    // largest number of samples per block
+    int blockSize() const { return blockSize_; }
+    int numPointers() const { return numPointers_; }
+    // NOTE: not const because plugins expect non-const input arrays
+    template<typename T>
+    T * zeros() { return reinterpret_cast<T *>(zeros_); }
+    template<typename T>
+    T * discard() { return reinterpret_cast<T *>(discard_); }
+    template<typename T>
+    T ** pointers(int offset = 0) { return reinterpret_cast<T **>(pointers_ + offset); }
+ private:
+    static size_t align(size_t n){
+        return (n + alignment - 1) & ~(alignment - 1);
+    }
+    std::vector<char> memory_;
+    char *zeros_ = nullptr;
+    char *discard_ = nullptr;
+    void **pointers_ = nullptr;
+    int blockSize_ = 0;
+    int numPointers_ = 0;
+};
+
+//--------------------------------------------------------------------------------------------------------
+
 template<typename T, size_t N>
 class LockfreeFifo {
  public:
@@ -1,6 +1,7 @@
 #include "Interface.h"
 #include "VST2Plugin.h"
 #include "Utility.h"
+#include "AudioKernels.h"
 
 #include <fstream>
 #include <cmath>
@@ -105,36 +106,35 @@ VST2Factory::~VST2Factory(){
     // LOG_DEBUG("freed VST2 module " << path_);
 }
 
+// NB: the plugin list might be read concurrently (see PluginList),
+// but calls to addPlugin() must be serialized.
 void VST2Factory::addPlugin(PluginInfo::ptr desc){
-    if (!pluginMap_.count(desc->name)){
-        plugins_.push_back(desc);
-        pluginMap_[desc->name] = desc;
-    }
+    setPlugins(plugins()->add(std::move(desc)));
 }
 
 PluginInfo::const_ptr VST2Factory::getPlugin(int index) const {
-    if (index >= 0 && index < (int)plugins_.size()){
-        return plugins_[index];
+    auto list = plugins();
+    if (index >= 0 && index < (int)list->plugins.size()){
+        return list->plugins[index];
     } else {
         return nullptr;
     }
 }
 
 int VST2Factory::numPlugins() const {
-    return plugins_.size();
+    return plugins()->plugins.size();
 }
 
-IFactory::ProbeFuture VST2Factory::probeAsync() {
-    plugins_.clear();
-    pluginMap_.clear();
-    auto f = probePlugin(""); // don't need a name
+IFactory::ProbeFuture VST2Factory::probeAsync(const ProbeOptions& options) {
+    setPlugins(PluginList::make());
+    auto f = probePlugin("", 0, options); // don't need a name
     /// LOG_DEBUG("got probePlugin future");
     auto self = shared_from_this();
-    return [this, self=std::move(self), f=std::move(f)](ProbeCallback callback){
+    return [this, self=std::move(self), f=std::move(f), options](ProbeCallback callback){
         auto result = f(); // call future
         if (result.plugin->shellPlugins.empty()){
             if (result.valid()) {
-                plugins_ = { result.plugin };
+                setPlugins(PluginList::make({ result.plugin }));
             }
             if (callback){
                 callback(result);
@@ -144,10 +144,7 @@ IFactory::ProbeFuture VST2Factory::probeAsync() {
             for (auto& shell : result.plugin->shellPlugins){
                 pluginList.emplace_back(shell.name, shell.id);
             }
-            plugins_ = probePlugins(pluginList, callback);
-        }
-        for (auto& desc : plugins_) {
-            pluginMap_[desc->name] = desc;
+            setPlugins(PluginList::make(probePlugins(pluginList, callback, options)));
         }
     };
 }
@@ -174,18 +171,27 @@ void VST2Factory::doLoad(){
 }
 
 IPlugin::ptr VST2Factory::create(const std::string& name, bool probe) const {
+    return doCreate(name, probe, false);
+}
+
+PluginInfo::const_ptr VST2Factory::scan(const std::string& name) const {
+    auto plugin = doCreate(name, true, true);
+    return static_cast<VST2Plugin&>(*plugin).info_;
+}
+
+IPlugin::ptr VST2Factory::doCreate(const std::string& name, bool probe, bool quick) const {
     const_cast<VST2Factory *>(this)->doLoad(); // lazy loading
 
     PluginInfo::ptr desc = nullptr; // will stay nullptr when probing!
     if (!probe){
-        if (plugins_.empty()){
+        auto list = plugins();
+        if (list->plugins.empty()){
             throw Error(Error::ModuleError, "Factory doesn't have any plugin(s)");
         }
-        auto it = pluginMap_.find(name);
-        if (it == pluginMap_.end()){
+        desc = list->find(name);
+        if (!desc){
             throw Error(Error::ModuleError, "can't find (sub)plugin '" + name + "'");
         }
-        desc = it->second;
         // only for shell plugins:
         // set (global) current plugin ID (used in hostCallback)
         shellPluginID = desc->getUniqueID();
@@ -207,16 +213,20 @@ IPlugin::ptr VST2Factory::create(const std::string& name, bool probe) const {
     if (plugin->magic != kEffectMagic){
         throw Error(Error::PluginError, "not a valid VST2.x plugin!");
     }
-    return std::make_unique<VST2Plugin>(plugin, shared_from_this(), desc);
+    return std::make_unique<VST2Plugin>(plugin, shared_from_this(), desc, quick);
 }
 
 
 /*/////////////////////// VST2Plugin /////////////////////////////*/
 
-// initial size of VstEvents queue (can grow later as needed)
-#define DEFAULT_EVENT_QUEUE_SIZE 64
+// fixed size event queues, so that sending events never allocates memory.
+// events which don't fit into the current block are dropped and counted (see takeNumDroppedEvents()).
+#define MIDI_EVENT_QUEUE_SIZE 1024
+#define SYSEX_EVENT_QUEUE_SIZE 64
+#define SYSEX_DATA_SIZE 65536 // total number of sysex bytes per block
 
-VST2Plugin::VST2Plugin(AEffect *plugin, IFactory::const_ptr f, PluginInfo::const_ptr desc)
+VST2Plugin::VST2Plugin(AEffect *plugin, IFactory::const_ptr f, PluginInfo::const_ptr desc,
+                       bool quick)
     : plugin_(plugin), info_(std::move(desc))
 {
     memset(&timeInfo_, 0, sizeof(timeInfo_));
@@ -229,11 +239,13 @@ VST2Plugin::VST2Plugin(AEffect *plugin, IFactory::const_ptr f, PluginInfo::const
             | kVstTransportChanged;
 
         // create VstEvents structure holding VstEvent pointers
-    vstEvents_ = (VstEvents *)malloc(sizeof(VstEvents) + DEFAULT_EVENT_QUEUE_SIZE * sizeof(VstEvent *));
+    vstEvents_ = (VstEvents *)malloc(sizeof(VstEvents)
+        + (MIDI_EVENT_QUEUE_SIZE + SYSEX_EVENT_QUEUE_SIZE) * sizeof(VstEvent *));
     memset(vstEvents_, 0, sizeof(VstEvents)); // zeroing class fields is enough
-    vstEventBufferSize_ = DEFAULT_EVENT_QUEUE_SIZE;
-        // pre-allocate midi queue
-    midiQueue_.reserve(DEFAULT_EVENT_QUEUE_SIZE);
+        // pre-allocate event queues and sysex data
+    midiQueue_.reserve(MIDI_EVENT_QUEUE_SIZE);
+    sysexQueue_.reserve(SYSEX_EVENT_QUEUE_SIZE);
+    sysexData_.resize(SYSEX_DATA_SIZE);
 
     plugin_->user = this;
     dispatch(effOpen);
@@ -245,7 +257,7 @@ VST2Plugin::VST2Plugin(AEffect *plugin, IFactory::const_ptr f, PluginInfo::const
         info->name = getPluginName();
         if (info->name.empty()){
             // get from file path
-            auto& path = info->path;
+            const std::string& path = info->path;
             auto sep = path.find_last_of("\\/");
             auto dot = path.find_last_of('.');
             if (sep == std::string::npos){
@@ -270,20 +282,23 @@ VST2Plugin::VST2Plugin(AEffect *plugin, IFactory::const_ptr f, PluginInfo::const
         flags |= hasPrecision(ProcessPrecision::Double) * PluginInfo::DoublePrecision;
         flags |= hasMidiInput() * PluginInfo::MidiInput;
         flags |= hasMidiOutput() * PluginInfo::MidiOutput;
+        flags |= quick * PluginInfo::Partial;
         info->flags = flags;
-        // get parameters
-        int numParameters = getNumParameters();
-        for (int i = 0; i < numParameters; ++i){
-            PluginInfo::Param p;
-            p.name = getParameterName(i);
-            p.label = getParameterLabel(i);
-            p.id = i;
-            info->addParameter(std::move(p));
-        }
-        // programs
-        int numPrograms = getNumPrograms();
-        for (int i = 0; i < numPrograms; ++i){
-            info->programs.push_back(getProgramNameIndexed(i));
+        if (!quick){
+            // get parameters
+            int numParameters = getNumParameters();
+            for (int i = 0; i < numParameters; ++i){
+                PluginInfo::Param p;
+                p.name = getParameterName(i);
+                p.label = getParameterLabel(i);
+                p.id = i;
+                info->addParameter(std::move(p));
+            }
+            // programs
+            int numPrograms = getNumPrograms();
+            for (int i = 0; i < numPrograms; ++i){
+                info->addProgram(getProgramNameIndexed(i));
+            }
         }
         // VST2 shell plugins only: get sub plugins
         if (dispatch(effGetPlugCategory) == kPlugCategShell){
@@ -298,6 +313,8 @@ VST2Plugin::VST2Plugin(AEffect *plugin, IFactory::const_ptr f, PluginInfo::const
         }
         info_ = info;
     }
+    // keep parameter and program tables resident as long as the plugin is alive
+    paramTables_ = info_->pinTables();
     numInputChannels_ = getNumInputs();
     numOutputChannels_ = getNumOutputs();
     haveBypass_ = hasBypass(); // cache for performance
@@ -310,10 +327,6 @@ VST2Plugin::~VST2Plugin(){
 
     dispatch(effClose);
 
-        // clear sysex events
-    for (auto& sysex : sysexQueue_){
-        free(sysex.sysexDump);
-    }
     free(vstEvents_);
     LOG_DEBUG("destroyed VST2 plugin");
 }
@@ -340,6 +353,13 @@ void VST2Plugin::setupProcessing(double sampleRate, int maxBlockSize, ProcessPre
     dispatch(effSetBlockSize, 0, maxBlockSize);
     dispatch(effSetProcessPrecision, 0,
              precision == ProcessPrecision::Double ?  kVstProcessPrecision64 : kVstProcessPrecision32);
+    maxBlockSize_ = maxBlockSize;
+    updateScratchArena();
+}
+
+void VST2Plugin::updateScratchArena(){
+    // input and output channel pointers
+    scratch_.reset(maxBlockSize_, numInputChannels_ + numOutputChannels_);
 }
 
 template<typename T>
@@ -362,6 +382,10 @@ void VST2Plugin::doProcessing(ProcessData<T>& data, TProc processRoutine){
         LOG_ERROR("VST2Plugin::process: no process routine!");
         return; // should never happen!
     }
+    if (data.numSamples > scratch_.blockSize()){
+        LOG_ERROR("VST2Plugin::process: block size exceeds maxBlockSize!");
+        return; // should never happen!
+    }
 
     auto bypassState = bypass_; // do we have to care about bypass?
     bool bypassRamp = (bypass_ != lastBypass_);
@@ -391,9 +415,8 @@ void VST2Plugin::doProcessing(ProcessData<T>& data, TProc processRoutine){
 
     // prepare input
     int nin = numInputChannels_;
-    auto input = (T **)alloca(sizeof(T *) * nin); // array of buffers
-    auto indummy = (T *)alloca(sizeof(T) * data.numSamples); // dummy input buffer
-    std::fill(indummy, indummy + data.numSamples, 0); // zero!
+    auto input = scratch_.pointers<T>(); // array of buffers
+    auto indummy = scratch_.zeros<T>(); // dummy input buffer (always zero)
 
     for (int i = 0; i < nin; ++i){
         if (i < data.numInputs){
@@ -403,12 +426,8 @@ void VST2Plugin::doProcessing(ProcessData<T>& data, TProc processRoutine){
                 if (bypassRamp && i < data.numOutputs){
                     // write fade in/fade out to *output buffer* and use it as an input.
                     // this works because VST plugins actually work in "replacing" mode.
-                    auto src = data.input[i];
-                    auto dst = input[i] = data.output[i];
-                    T mix = rampDir;
-                    for (int j = 0; j < data.numSamples; ++j, mix += rampAdvance){
-                        dst[j] = src[j] * mix;
-                    }
+                    input[i] = data.output[i];
+                    audio::rampCopy(data.input[i], input[i], data.numSamples, (T)rampDir, rampAdvance);
                 } else {
                     input[i] = indummy; // silence
                 }
@@ -434,8 +453,8 @@ void VST2Plugin::doProcessing(ProcessData<T>& data, TProc processRoutine){
 
     // prepare output
     int nout = numOutputChannels_;
-    auto output = (T **)alloca(sizeof(T *) * nout);
-    auto outdummy = (T *)alloca(sizeof(T) * data.numSamples); // dummy output buffer (don't have to zero)
+    auto output = scratch_.pointers<T>(nin);
+    auto outdummy = scratch_.discard<T>(); // dummy output buffer (don't have to zero)
     for (int i = 0; i < nout; ++i){
         if (i < data.numOutputs){
             output[i] = data.output[i];
@@ -455,19 +474,12 @@ void VST2Plugin::doProcessing(ProcessData<T>& data, TProc processRoutine){
         if (bypassState == Bypass::Soft){
             // soft bypass
             for (int i = 0; i < nout; ++i){
-                T mix = rampDir;
-                auto out = output[i];
                 if (i < data.numInputs){
                     // fade in/out unprocessed input
-                    auto in = data.input[i];
-                    for (int j = 0; j < data.numSamples; ++j, mix += rampAdvance){
-                        out[j] += in[j] * (1.f - mix);
-                    }
+                    audio::rampAdd(data.input[i], output[i], data.numSamples, (T)rampDir, rampAdvance);
                 } else {
                     // just fade in/out
-                    for (int j = 0; j < data.numSamples; ++j, mix += rampAdvance){
-                        out[j] *= mix;
-                    }
+                    audio::rampScale(output[i], data.numSamples, (T)rampDir, rampAdvance);
                 }
             }
             if (rampDir){
@@ -478,19 +490,12 @@ void VST2Plugin::doProcessing(ProcessData<T>& data, TProc processRoutine){
         } else {
             // hard bypass
             for (int i = 0; i < nout; ++i){
-               T mix = rampDir;
-               auto out = output[i];
                if (i < data.numInputs){
                    // cross fade between plugin output and unprocessed input
-                   auto in = data.input[i];
-                   for (int j = 0; j < data.numSamples; ++j, mix += rampAdvance){
-                       out[j] = out[j] * mix + in[j] * (1.f - mix);
-                   }
+                   audio::crossfade(data.input[i], output[i], data.numSamples, (T)rampDir, rampAdvance);
                } else {
                    // just fade out
-                   for (int j = 0; j < data.numSamples; ++j, mix += rampAdvance){
-                       out[j] *= mix;
-                   }
+                   audio::rampScale(output[i], data.numSamples, (T)rampDir, rampAdvance);
                }
             }
             if (rampDir){
@@ -503,18 +508,10 @@ void VST2Plugin::doProcessing(ProcessData<T>& data, TProc processRoutine){
         // continue to process with empty input till the output is silent
         processRoutine(plugin_, input, output, data.numSamples);
         // check for silence (RMS < ca. -80dB)
-        auto isSilent = [](auto buf, auto n){
-            const T threshold = 0.0001;
-            T sum = 0;
-            for (int i = 0; i < n; ++i){
-                T f = buf[i];
-                sum += f * f;
-            }
-            return (sum / n) < (threshold * threshold); // sqrt(sum/n) < threshold
-        };
+        const T threshold = 0.0001;
         bool silent = true;
         for (int i = 0; i < nout; ++i){
-            if (!isSilent(output[i], data.numSamples)){
+            if (!audio::isSilent(output[i], data.numSamples, threshold)){
                 silent = false;
                 break;
             }
@@ -525,14 +522,8 @@ void VST2Plugin::doProcessing(ProcessData<T>& data, TProc processRoutine){
         bypassSilent_ = silent;
         if (bypassState == Bypass::Soft){
             // mix output with unprocessed input
-            for (int i = 0; i < nout; ++i){
-                auto out = output[i];
-                if (i < data.numInputs){
-                    auto in = data.input[i];
-                    for (int j = 0; j < data.numSamples; ++j){
-                        out[j] += in[j];
-                    }
-                }
+            for (int i = 0; i < nout && i < data.numInputs; ++i){
+                audio::add(data.input[i], output[i], data.numSamples);
             }
         } else {
             // overwrite output
@@ -687,6 +678,7 @@ void VST2Plugin::setNumSpeakers(int in, int out, int auxin, int auxout){
     if (!input || !output){
         LOG_DEBUG("(effGetSpeakerArrangement not supported)");
     }
+    updateScratchArena();
 }
 
 void VST2Plugin::setTempoBPM(double tempo){
@@ -789,23 +781,32 @@ void VST2Plugin::sendMidiEvent(const MidiEvent &event){
     midievent.deltaFrames = event.delta;
     midievent.detune = event.detune;
 
-    midiQueue_.push_back(midievent);
-
-    vstEvents_->numEvents++;
+    if (midiQueue_.size() < MIDI_EVENT_QUEUE_SIZE){
+        midiQueue_.push_back(midievent); // never reallocates
+        vstEvents_->numEvents++;
+    } else {
+        numDroppedEvents_.fetch_add(1, std::memory_order_relaxed);
+    }
 }
 
 void VST2Plugin::sendSysexEvent(const SysexEvent &event){
+    if (sysexQueue_.size() >= SYSEX_EVENT_QUEUE_SIZE
+            || event.size > sysexData_.size() - sysexDataSize_){
+        numDroppedEvents_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
     VstMidiSysexEvent sysexevent;
     memset(&sysexevent, 0, sizeof(VstMidiSysexEvent));
     sysexevent.type = kVstSysExType;
     sysexevent.byteSize = sizeof(VstMidiSysexEvent);
     sysexevent.deltaFrames = event.delta;
     sysexevent.dumpBytes = event.size;
-    sysexevent.sysexDump = (char *)malloc(sysexevent.dumpBytes);
-        // copy the sysex data (LATER figure out how to avoid this)
+        // copy the sysex data to the arena (valid until postProcess())
+    sysexevent.sysexDump = sysexData_.data() + sysexDataSize_;
     memcpy(sysexevent.sysexDump, event.data, sysexevent.dumpBytes);
+    sysexDataSize_ += event.size;
 
-    sysexQueue_.push_back(std::move(sysexevent));
+    sysexQueue_.push_back(sysexevent); // never reallocates
 
     vstEvents_->numEvents++;
 }
@@ -1361,19 +1362,13 @@ VstTimeInfo * VST2Plugin::getTimeInfo(VstInt32 flags){
     return &timeInfo_;
 }
 
+int VST2Plugin::takeNumDroppedEvents(){
+    return numDroppedEvents_.exchange(0, std::memory_order_relaxed);
+}
+
 void VST2Plugin::preProcess(int nsamples){
         // send MIDI events:
     int numEvents = vstEvents_->numEvents;
-        // resize buffer if needed
-    while (numEvents > vstEventBufferSize_){
-        LOG_DEBUG("vstEvents: grow (numEvents " << numEvents << ", old size " << vstEventBufferSize_<< ")");
-            // always grow (doubling the memory), never shrink
-        int newSize = vstEventBufferSize_ * 2;
-        vstEvents_ = (VstEvents *)realloc(vstEvents_, sizeof(VstEvents) + newSize * sizeof(VstEvent *));
-        vstEventBufferSize_ = newSize;
-        memset(vstEvents_, 0, sizeof(VstEvents)); // zeroing class fields is enough
-        vstEvents_->numEvents = numEvents;
-    }
         // set VstEvent pointers (do it right here to ensure they are all valid)
     int n = 0;
     for (auto& midi : midiQueue_){
@@ -1394,10 +1389,8 @@ void VST2Plugin::postProcess(int nsamples){
         // clear midi events
     midiQueue_.clear();
         // clear sysex events
-    for (auto& sysex : sysexQueue_){
-        free(sysex.sysexDump);
-    }
     sysexQueue_.clear();
+    sysexDataSize_ = 0;
         // 'clear' VstEvents array
     vstEvents_->numEvents = 0;
 
@@ -2,6 +2,7 @@
 #pragma once
 
 #include "Interface.h"
+#include "Utility.h"
 
 #if USE_FST
 #include "fst.h"
@@ -23,9 +24,9 @@ class VST2Factory : public IFactory {
     PluginInfo::const_ptr getPlugin(int index) const override;
     int numPlugins() const override;
     // probe plugins (in a seperate process)
-    ProbeFuture probeAsync() override;
+    ProbeFuture probeAsync(const ProbeOptions& options = ProbeOptions()) override;
     bool isProbed() const override {
-        return !plugins_.empty();
+        return numPlugins() > 0;
     }
     bool valid() const override {
         return numPlugins() > 0;
@@ -35,14 +36,24 @@ class VST2Factory : public IFactory {
     }
     // create a new plugin instance
     IPlugin::ptr create(const std::string& name, bool probe = false) const override;
+    // VST2 plugins can't be queried without creating them, but at least
+    // we can skip the parameters and programs.
+    PluginInfo::const_ptr scan(const std::string& name) const override;
  private:
     void doLoad();
+    IPlugin::ptr doCreate(const std::string& name, bool probe, bool quick) const;
     using EntryPoint = AEffect *(*)(audioMasterCallback);
     std::string path_;
     std::unique_ptr<IModule> module_;
     EntryPoint entry_;
-    std::vector<PluginInfo::ptr> plugins_;
-    std::unordered_map<std::string, PluginInfo::ptr> pluginMap_;
+    // immutable, always use plugins() resp. setPlugins()
+    PluginList::const_ptr plugins_ = PluginList::make();
+    PluginList::const_ptr plugins() const {
+        return std::atomic_load(&plugins_);
+    }
+    void setPlugins(PluginList::const_ptr plugins){
+        std::atomic_store(&plugins_, std::move(plugins));
+    }
 };
 
 //-----------------------------------------------------------------------------
@@ -53,7 +64,9 @@ class VST2Plugin final : public IPlugin {
     static VstIntPtr VSTCALLBACK hostCallback(AEffect *plugin, VstInt32 opcode,
         VstInt32 index, VstIntPtr value, void *p, float opt);
 
-    VST2Plugin(AEffect* plugin, IFactory::const_ptr f, PluginInfo::const_ptr desc);
+    // 'quick': don't get parameters and programs when probing (see VST2Factory::scan())
+    VST2Plugin(AEffect* plugin, IFactory::const_ptr f, PluginInfo::const_ptr desc,
+               bool quick = false);
     ~VST2Plugin();
 
     PluginType getType() const override { return PluginType::VST2; }
@@ -90,6 +103,7 @@ class VST2Plugin final : public IPlugin {
     }
     void sendMidiEvent(const MidiEvent& event) override;
     void sendSysexEvent(const SysexEvent& event) override;
+    int takeNumDroppedEvents() override;
 
     void setParameter(int index, float value, int sampleOffset = 0) override;
     bool setParameter(int index, const std::string& str, int sampleOffset = 0) override;
@@ -158,6 +172,7 @@ class VST2Plugin final : public IPlugin {
     void setBankChunkData(const void *data, size_t size);
     void getBankChunkData(void **data, size_t *size) const;
         // processing
+    void updateScratchArena();
     void preProcess(int nsamples);
     template<typename T, typename TProc>
     void doProcessing(ProcessData<T>& data, TProc processRoutine);
@@ -172,21 +187,26 @@ class VST2Plugin final : public IPlugin {
                            VstIntPtr value, void *ptr, float opt);
     AEffect *plugin_ = nullptr;
     PluginInfo::const_ptr info_;
+    PluginInfo::TablePtr paramTables_;
     IWindow::ptr window_;
     std::weak_ptr<IPluginListener> listener_;
         // processing
     int numInputChannels_ = 0;
     int numOutputChannels_ = 0;
+    int maxBlockSize_ = 0;
+    ScratchArena scratch_; // dummy buffers and channel pointers for doProcessing()
     VstTimeInfo timeInfo_;
     Bypass bypass_ = Bypass::Off;
     Bypass lastBypass_ = Bypass::Off;
     bool haveBypass_ = false;
     bool bypassSilent_ = false; // check if we can stop processing
-        // buffers for incoming MIDI and SysEx events
+        // fixed size buffers for incoming MIDI and SysEx events (preallocated in the constructor)
     std::vector<VstMidiEvent> midiQueue_;
     std::vector<VstMidiSysexEvent> sysexQueue_;
+    std::vector<char> sysexData_; // arena for the sysex dumps
+    size_t sysexDataSize_ = 0;
+    std::atomic<int> numDroppedEvents_{0};
     VstEvents *vstEvents_; // VstEvents is basically an array of VstEvent pointers
-    int vstEventBufferSize_ = 0;
     bool vstTimeWarned_ = false;
     bool editor_ = false;
 };
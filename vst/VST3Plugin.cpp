@@ -1,8 +1,11 @@
 #include "VST3Plugin.h"
+#include "AudioKernels.h"
+#include "JsonReader.h"
 
 #include <cstring>
 #include <algorithm>
 #include <set>
+#include <sstream>
 #include <codecvt>
 #include <locale>
 
@@ -117,52 +120,67 @@ VST3Factory::~VST3Factory(){
     // LOG_DEBUG("freed VST3 module " << path_);
 }
 
+// NB: the plugin list might be read concurrently (see PluginList),
+// but calls to addPlugin() must be serialized.
 void VST3Factory::addPlugin(PluginInfo::ptr desc){
-    if (!pluginMap_.count(desc->name)){
-        plugins_.push_back(desc);
-        pluginMap_[desc->name] = desc;
-    }
+    setPlugins(plugins()->add(std::move(desc)));
 }
 
 PluginInfo::const_ptr VST3Factory::getPlugin(int index) const {
-    if (index >= 0 && index < (int)plugins_.size()){
-        return plugins_[index];
+    auto list = plugins();
+    if (index >= 0 && index < (int)list->plugins.size()){
+        return list->plugins[index];
     } else {
         return nullptr;
     }
 }
 
 int VST3Factory::numPlugins() const {
-    return plugins_.size();
-}
-
-IFactory::ProbeFuture VST3Factory::probeAsync() {
+    return plugins()->plugins.size();
+}
+
+IFactory::ProbeFuture VST3Factory::probeAsync(const ProbeOptions& options) {
+    if (options.quick){
+        // newer plugins ship with a moduleinfo.json file, so we
+        // don't even have to load the module.
+        std::vector<PluginInfo::ptr> plugins;
+        if (readModuleInfo(plugins)){
+            setPlugins(PluginList::make(plugins));
+            return [plugins=std::move(plugins)](ProbeCallback callback){
+                if (callback){
+                    int total = plugins.size();
+                    for (int i = 0; i < total; ++i){
+                        ProbeResult result;
+                        result.plugin = plugins[i];
+                        result.index = i;
+                        result.total = total;
+                        callback(result);
+                    }
+                }
+            };
+        }
+    }
     doLoad(); // lazy loading
 
     if (pluginList_.empty()){
         throw Error(Error::ModuleError, "Factory doesn't have any plugin(s)");
     }
-    plugins_.clear();
-    pluginMap_.clear();
+    setPlugins(PluginList::make());
     auto self(shared_from_this());
     if (pluginList_.size() > 1){
-        return [this, self=std::move(self)](ProbeCallback callback){
+        return [this, self=std::move(self), options](ProbeCallback callback){
             ProbeList pluginList;
             for (auto& name : pluginList_){
                 pluginList.emplace_back(name, 0);
             }
-            plugins_ = probePlugins(pluginList, callback);
-            for (auto& desc : plugins_) {
-                pluginMap_[desc->name] = desc;
-            }
+            setPlugins(PluginList::make(probePlugins(pluginList, callback, options)));
         };
     } else {
-        auto f = probePlugin(pluginList_[0]);
+        auto f = probePlugin(pluginList_[0], 0, options);
         return [this, self=std::move(self), f=std::move(f)](ProbeCallback callback){
             auto result = f();
             if (result.valid()) {
-                plugins_ = { result.plugin };
-                pluginMap_[result.plugin->name] = result.plugin;
+                setPlugins(PluginList::make({ result.plugin }));
             }
             /// LOG_DEBUG("probed plugin " << result.plugin->name);
             if (callback){
@@ -224,18 +242,131 @@ std::unique_ptr<IPlugin> VST3Factory::create(const std::string& name, bool probe
 
     PluginInfo::ptr desc = nullptr; // will stay nullptr when probing!
     if (!probe){
-        if (plugins_.empty()){
+        auto list = plugins();
+        if (list->plugins.empty()){
             throw Error(Error::ModuleError, "Factory doesn't have any plugin(s)");
         }
-        auto it = pluginMap_.find(name);
-        if (it == pluginMap_.end()){
+        desc = list->find(name);
+        if (!desc){
             throw Error(Error::ModuleError, "Can't find (sub)plugin '" + name + "'");
         }
-        desc = it->second;
     }
     return std::make_unique<VST3Plugin>(factory_, pluginIndexMap_[name], shared_from_this(), desc);
 }
 
+static void setPartialInfo(PluginInfo& info, const std::string& name,
+                           const std::string& category, const std::string& vendor,
+                           const std::string& version, const std::string& sdkVersion)
+{
+    info.name = name;
+    info.category = category;
+    info.vendor = vendor;
+    info.version = version;
+    info.sdkVersion = sdkVersion;
+    info.flags = PluginInfo::Partial;
+    if (category.find(Vst::PlugType::kInstrument) != std::string::npos){
+        info.flags |= PluginInfo::IsSynth;
+    }
+}
+
+PluginInfo::const_ptr VST3Factory::scan(const std::string& name) const {
+    const_cast<VST3Factory *>(this)->doLoad(); // lazy loading
+
+    auto it = pluginIndexMap_.find(name);
+    if (it == pluginIndexMap_.end()){
+        throw Error(Error::ModuleError, "Can't find (sub)plugin '" + name + "'");
+    }
+    int which = it->second;
+    auto info = std::make_shared<PluginInfo>(shared_from_this());
+    TUID uid;
+    PClassInfo2 ci2;
+    auto factory2 = FUnknownPtr<IPluginFactory2> (factory_);
+    if (factory2 && factory2->getClassInfo2(which, &ci2) == kResultTrue){
+        memcpy(uid, ci2.cid, sizeof(TUID));
+        setPartialInfo(*info, ci2.name, ci2.subCategories, ci2.vendor,
+                       ci2.version, ci2.sdkVersion);
+    } else {
+        Steinberg::PClassInfo ci;
+        if (factory_->getClassInfo(which, &ci) == kResultTrue){
+            memcpy(uid, ci.cid, sizeof(TUID));
+            setPartialInfo(*info, ci.name, "Uncategorized", "", "0.0.0", "VST 3");
+        } else {
+            throw Error(Error::PluginError, "Couldn't get class info!");
+        }
+    }
+    info->setUID(uid);
+    // vendor name (if still empty)
+    if (info->vendor.empty()){
+        PFactoryInfo i;
+        if (factory_->getFactoryInfo(&i) == kResultTrue){
+            info->vendor = i.vendor;
+        } else {
+            info->vendor = "Unknown";
+        }
+    }
+    return info;
+}
+
+// get the plugin metadata from "Contents/Resources/moduleinfo.json" (VST SDK 3.7.5+)
+bool VST3Factory::readModuleInfo(std::vector<PluginInfo::ptr>& plugins) const {
+    if (!isDirectory(path_)){
+        return false;
+    }
+    std::string path = path_ + "/Contents/Resources/moduleinfo.json";
+    File file(path);
+    if (!file.is_open()){
+        return false;
+    }
+    std::stringstream ss;
+    ss << file.rdbuf();
+    JsonValue json;
+    if (!parseJson(ss.str(), json) || json.type != JsonValue::Object){
+        LOG_WARNING("couldn't parse " << path);
+        return false;
+    }
+    auto classes = json.find("Classes");
+    if (!classes || classes->type != JsonValue::Array){
+        return false;
+    }
+    std::string factoryVendor;
+    if (auto factoryInfo = json.find("Factory Info")){
+        factoryVendor = factoryInfo->get("Vendor");
+    }
+    for (auto& c : classes->array){
+        if (c.get("Category") != kVstAudioEffectClass){
+            continue;
+        }
+        FUID fuid;
+        if (!fuid.fromString(c.get("CID").c_str())){
+            LOG_WARNING(path << ": bad class ID");
+            return false;
+        }
+        TUID uid;
+        fuid.toTUID(uid);
+        // sub categories are stored as an array
+        std::string category;
+        if (auto subCategories = c.find("Sub Categories")){
+            for (auto& sub : subCategories->array){
+                if (!category.empty()){
+                    category += "|";
+                }
+                category += sub.string;
+            }
+        }
+        auto vendor = c.get("Vendor");
+        auto info = std::make_shared<PluginInfo>(shared_from_this());
+        setPartialInfo(*info, c.get("Name"),
+                       !category.empty() ? category : "Uncategorized",
+                       !vendor.empty() ? vendor :
+                           (!factoryVendor.empty() ? factoryVendor : "Unknown"),
+                       c.get("Version"), c.get("SDKVersion"));
+        info->setUID(uid);
+        info->path = path_;
+        plugins.push_back(info);
+    }
+    return !plugins.empty();
+}
+
 /*///////////////////// ParamValueQeue /////////////////////*/
 
 ParamValueQueue::ParamValueQueue() {
@@ -245,9 +376,20 @@ ParamValueQueue::ParamValueQueue() {
 void ParamValueQueue::setParameterId(Vst::ParamID id){
     values_.clear();
     id_ = id;
+    sorted_ = true;
+}
+
+int32 PLUGIN_API ParamValueQueue::getPointCount() {
+    if (!sorted_){
+        sort();
+    }
+    return values_.size();
 }
 
 tresult PLUGIN_API ParamValueQueue::getPoint(int32 index, int32& sampleOffset, Vst::ParamValue& value) {
+    if (!sorted_){
+        sort();
+    }
     if (index >= 0 && index < (int32)values_.size()){
         auto& v = values_[index];
         value = v.value;
@@ -256,42 +398,91 @@ tresult PLUGIN_API ParamValueQueue::getPoint(int32 index, int32& sampleOffset, V
     }
     return kResultFalse;
 }
+
 tresult PLUGIN_API ParamValueQueue::addPoint (int32 sampleOffset, Vst::ParamValue value, int32& index) {
-    // iterate in reverse because we likely add values in "chronological" order
-    for (auto it = values_.end(); it-- != values_.begin(); ){
-        if (sampleOffset > it->sampleOffset){
-            // higher sample offset -> insert *after* this point (might actually append)
-            if (values_.size() < maxNumPoints){
-                // insert
-                it = values_.emplace(it + 1, value, sampleOffset);
-                index = it - values_.begin();
-            } else {
-                // replace
-                values_.back() = Value(value, sampleOffset);
-                index = values_.size() - 1;
-            }
-            return kResultOk;
-        } else if (sampleOffset == it->sampleOffset){
-            // equal sample offset -> replace point
-            it->value = value;
-            index = it - values_.begin();
-            return kResultOk;
-        }
-    }
-    // empty queue or smallest sample offset:
-    if (values_.size() < maxNumPoints){
-        // prepend point
-        values_.emplace(values_.begin(), value, sampleOffset);
+    if (values_.empty() || sampleOffset > values_.back().sampleOffset){
+        // append (the common case)
+        if (values_.size() < maxNumPoints){
+            values_.emplace_back(value, sampleOffset);
+        } else {
+            // replace last point
+            values_.back() = Value(value, sampleOffset);
+        }
+    } else if (sampleOffset == values_.back().sampleOffset){
+        // equal sample offset -> replace point
+        values_.back().value = value;
+    } else if (values_.size() < maxNumPoints){
+        // out of order -> append and sort later.
+        // NOTE: the returned index is only valid until the queue is sorted.
+        values_.emplace_back(value, sampleOffset);
+        sorted_ = false;
     } else {
-        // replace first point
-        values_.front() = Value(value, sampleOffset);
+        // queue is full -> replace the point at or after the sample offset.
+        // this is very rare, so we can afford to sort here.
+        if (!sorted_){
+            sort();
+        }
+        auto it = std::lower_bound(values_.begin(), values_.end(), sampleOffset,
+            [](const Value& v, int32 offset){ return v.sampleOffset < offset; });
+        *it = Value(value, sampleOffset);
+        index = it - values_.begin();
+        return kResultOk;
     }
-    index = 0;
+    index = values_.size() - 1;
     return kResultOk;
 }
 
+void ParamValueQueue::sort(){
+    // insertion sort: stable, doesn't allocate and fast for (mostly) sorted input.
+    auto n = values_.size();
+    for (size_t i = 1; i < n; ++i){
+        auto v = values_[i];
+        auto j = i;
+        for (; j > 0 && values_[j - 1].sampleOffset > v.sampleOffset; --j){
+            values_[j] = values_[j - 1];
+        }
+        values_[j] = v;
+    }
+    // remove duplicate sample offsets; the point which has been added last wins.
+    size_t k = 0;
+    for (size_t i = 0; i < n; ++i){
+        if (k > 0 && values_[k - 1].sampleOffset == values_[i].sampleOffset){
+            values_[k - 1] = values_[i];
+        } else {
+            values_[k++] = values_[i];
+        }
+    }
+    values_.erase(values_.begin() + k, values_.end());
+    sorted_ = true;
+}
+
 /*///////////////////// ParameterChanges /////////////////////*/
 
+void ParameterChanges::setMaxNumParameters(int n){
+    parameterChanges_.resize(n);
+    // at most 50% load
+    size_t size = 16;
+    shift_ = 28;
+    while (size < (size_t)n * 2){
+        size *= 2;
+        shift_--;
+    }
+    slots_.assign(size, Slot{});
+    generation_ = 1;
+    useCount_ = 0;
+}
+
+void ParameterChanges::clear(){
+    if (useCount_ > 0){
+        if (++generation_ == 0){
+            // wrapped around (after 4 billion blocks...)
+            std::fill(slots_.begin(), slots_.end(), Slot{});
+            generation_ = 1;
+        }
+        useCount_ = 0;
+    }
+}
+
 Vst::IParamValueQueue* PLUGIN_API ParameterChanges::getParameterData(int32 index) {
     if (index >= 0 && index < useCount_){
         return &parameterChanges_[index];
@@ -299,17 +490,33 @@ Vst::IParamValueQueue* PLUGIN_API ParameterChanges::getParameterData(int32 index
         return nullptr;
     }
 }
+
 Vst::IParamValueQueue* PLUGIN_API ParameterChanges::addParameterData(const Vst::ParamID& id, int32& index) {
-    for (int i = 0; i < useCount_; ++i){
-        auto& param = parameterChanges_[i];
-        if (param.getParameterId() == id){
-            index = i;
-            return &param;
+    if (slots_.empty()){
+        LOG_ERROR("bug addParameterData");
+        index = 0;
+        return nullptr;
+    }
+    // parameter IDs are often hashes, but can also be consecutive numbers,
+    // so we mix the bits (Fibonacci hashing) and probe linearly.
+    auto mask = slots_.size() - 1;
+    size_t i = ((uint32_t)id * 2654435769u) >> shift_;
+    for (;; i = (i + 1) & mask){
+        auto& slot = slots_[i];
+        if (slot.generation != generation_){
+            // empty slot -> new parameter
+            break;
+        } else if (slot.id == id){
+            index = slot.index;
+            return &parameterChanges_[index];
         }
     }
     if (useCount_ < (int)parameterChanges_.size()){
         index = useCount_++;
         parameterChanges_[index].setParameterId(id);
+        slots_[i].id = id;
+        slots_[i].generation = generation_;
+        slots_[i].index = index;
         return &parameterChanges_[index];
     } else {
         LOG_ERROR("bug addParameterData");
@@ -320,18 +527,19 @@ Vst::IParamValueQueue* PLUGIN_API ParameterChanges::addParameterData(const Vst::
 
 /*///////////////////// EventList /////////////////////*/
 
-EventList::EventList(){
-    events_.reserve(maxNumEvents);
+EventList::EventList(size_t sysexSize){
+    events_.resize(maxNumEvents);
+    sysexData_.resize(sysexSize);
 }
 
 EventList::~EventList() {}
 
 int32 PLUGIN_API EventList::getEventCount() {
-    return events_.size();
+    return numEvents_;
 }
 
 tresult PLUGIN_API EventList::getEvent(int32 index, Vst::Event& e) {
-    if (index >= 0 && index < (int32)events_.size()){
+    if (index >= 0 && index < numEvents_){
         e = events_[index];
         return kResultOk;
     } else {
@@ -340,28 +548,43 @@ tresult PLUGIN_API EventList::getEvent(int32 index, Vst::Event& e) {
 }
 
 tresult PLUGIN_API EventList::addEvent (Vst::Event& e) {
-    // let's grow the queue beyond the limit...
-    // LATER use a realtime allocator
-    events_.push_back(e);
-    return kResultOk;
+    if (numEvents_ < maxNumEvents){
+        events_[numEvents_++] = e;
+        return kResultOk;
+    } else {
+        numDropped_++;
+        return kResultFalse;
+    }
 }
 
 void EventList::addSysexEvent(const SysexEvent& event){
-    // this will allocate memory anyway...
-    sysexEvents_.emplace_back(event.data, event.size);
-    auto& last = sysexEvents_.back();
+    if (numEvents_ >= maxNumEvents
+            || event.size > sysexData_.size() - sysexDataSize_){
+        numDropped_++;
+        return;
+    }
+    // copy the data to the arena (valid until clear())
+    auto data = sysexData_.data() + sysexDataSize_;
+    memcpy(data, event.data, event.size);
+    sysexDataSize_ += event.size;
     Vst::Event e;
     memset(&e, 0, sizeof(Vst::Event));
     e.type = Vst::Event::kDataEvent;
     e.data.type = Vst::DataEvent::kMidiSysEx;
-    e.data.bytes = (const uint8 *)last.data();
-    e.data.size = last.size();
+    e.data.bytes = (const uint8 *)data;
+    e.data.size = event.size;
     addEvent(e);
 }
 
 void EventList::clear(){
-    events_.clear();
-    sysexEvents_.clear();
+    numEvents_ = 0;
+    sysexDataSize_ = 0;
+}
+
+int EventList::takeNumDropped(){
+    auto n = numDropped_;
+    numDropped_ = 0;
+    return n;
 }
 
 /*/////////////////////// VST3Plugin ///////////////////////*/
@@ -518,7 +741,7 @@ VST3Plugin::VST3Plugin(IPtr<IPluginFactory> factory, int which, IFactory::const_
         uint32_t flags = 0;
         LOG_DEBUG("has editor: " << hasEditor());
         flags |= hasEditor();
-        flags |= (info->category.find(Vst::PlugType::kInstrument) != std::string::npos) * PluginInfo::IsSynth;
+        flags |= (info->category.str().find(Vst::PlugType::kInstrument) != std::string::npos) * PluginInfo::IsSynth;
         flags |= hasPrecision(ProcessPrecision::Single) * PluginInfo::SinglePrecision;
         flags |= hasPrecision(ProcessPrecision::Double) * PluginInfo::DoublePrecision;
         flags |= hasMidiInput() * PluginInfo::MidiInput;
@@ -547,7 +770,7 @@ VST3Plugin::VST3Plugin(IPtr<IPluginFactory> factory, int which, IFactory::const_
                     // Some JUCE plugins add thousands of (automatable) MIDI CC parameters,
                     // e.g. "MIDI CC 0|0" etc., so we need the following hack:
                     if ((pi.flags & Vst::ParameterInfo::kCanAutomate) &&
-                            param.name.find("MIDI CC ") == std::string::npos)
+                            param.name.str().find("MIDI CC ") == std::string::npos)
                     {
                         params.insert(param.id);
                         info->addParameter(std::move(param));
@@ -570,10 +793,10 @@ VST3Plugin::VST3Plugin(IPtr<IPluginFactory> factory, int which, IFactory::const_
                     for (int i = 0; i < pli.programCount; ++i){
                         Vst::String128 name;
                         if (ui->getProgramName(pli.id, i, name) == kResultTrue){
-                            info->programs.push_back(convertString(name));
+                            info->addProgram(convertString(name));
                         } else {
                             LOG_ERROR("couldn't get program name!");
-                            info->programs.push_back("");
+                            info->addProgram("");
                         }
                     }
                     LOG_DEBUG("num programs: " << pli.programCount);
@@ -588,6 +811,8 @@ VST3Plugin::VST3Plugin(IPtr<IPluginFactory> factory, int which, IFactory::const_
         }
         info_ = info;
     }
+    // keep parameter and program tables resident as long as the plugin is alive
+    paramTables_ = info_->pinTables();
     numMidiInChannels_ = getChannelCount(Vst::kEvent, Vst::kInput, Vst::kMain);
     numMidiOutChannels_ = getChannelCount(Vst::kEvent, Vst::kOutput, Vst::kMain);
     numInputBusses_ = std::min<int>(2, component_->getBusCount(Vst::kAudio, Vst::kInput));
@@ -705,6 +930,29 @@ void VST3Plugin::setupProcessing(double sampleRate, int maxBlockSize, ProcessPre
     // update project time in samples (assumes the tempo is valid for the whole project)
     double time = context_.projectTimeMusic / context_.tempo * 60.f;
     context_.projectTimeSamples = time * sampleRate;
+
+    maxBlockSize_ = maxBlockSize;
+    updateScratchArena();
+}
+
+void VST3Plugin::updateScratchArena(){
+    int nin = numInputChannels_[Main];
+    int nauxin = numInputChannels_[Aux];
+    int nout = numOutputChannels_[Main];
+    int nauxout = numOutputChannels_[Aux];
+    scratch_.reset(maxBlockSize_, nin + nauxin + nout + nauxout);
+    // let the bus buffers point to the channel pointer tables;
+    // doProcess() only has to fill in the actual channel buffers.
+    auto setupBus = [](Vst::AudioBusBuffers& bus, int numChannels, void **vec){
+        bus.numChannels = numChannels;
+        bus.silenceFlags = 0;
+        bus.channelBuffers32 = (Vst::Sample32 **)vec; // union with channelBuffers64
+    };
+    auto vec = scratch_.pointers<void>();
+    setupBus(inputBusBuffers_[Main], nin, vec);
+    setupBus(inputBusBuffers_[Aux], nauxin, vec + nin);
+    setupBus(outputBusBuffers_[Main], nout, vec + nin + nauxin);
+    setupBus(outputBusBuffers_[Aux], nauxout, vec + nin + nauxin + nout);
 }
 
 void VST3Plugin::process(ProcessData<float>& data){
@@ -715,12 +963,17 @@ void VST3Plugin::process(ProcessData<double>& data){
     doProcess(data);
 }
 
-void setAudioBusBuffers(Vst::AudioBusBuffers& bus, float ** vec){
-    bus.channelBuffers32 = vec;
+template<typename T>
+T ** getChannelBuffers(Vst::AudioBusBuffers& bus);
+
+template<>
+float ** getChannelBuffers<float>(Vst::AudioBusBuffers& bus){
+    return bus.channelBuffers32;
 }
 
-void setAudioBusBuffers(Vst::AudioBusBuffers& bus, double ** vec){
-    bus.channelBuffers64 = vec;
+template<>
+double ** getChannelBuffers<double>(Vst::AudioBusBuffers& bus){
+    return bus.channelBuffers64;
 }
 
 template<typename T>
@@ -749,17 +1002,19 @@ void doBypassProcessing(IPlugin::ProcessData<T>& data, T** output, int numOut, T
 
 template<typename T>
 void VST3Plugin::doProcess(ProcessData<T>& inData){
+    if (inData.numSamples > scratch_.blockSize()){
+        LOG_ERROR("VST3Plugin::process: block size exceeds maxBlockSize!");
+        return; // should never happen!
+    }
     // process data
     Vst::ProcessData data;
-    Vst::AudioBusBuffers input[2];
-    Vst::AudioBusBuffers output[2];
     data.numSamples = inData.numSamples;
     data.symbolicSampleSize = std::is_same<T, double>::value ? Vst::kSample64 : Vst::kSample32;
     // we send data for all busses (max. 2 per direction); some might have been deactivated in 'setNumSpeakers'
     data.numInputs = numInputBusses_;
     data.numOutputs = numOutputBusses_;
-    data.inputs = input;
-    data.outputs = output;
+    data.inputs = inputBusBuffers_;
+    data.outputs = outputBusBuffers_;
     data.processContext = &context_;
     data.inputEvents = &inputEvents_;
     data.outputEvents = &outputEvents_;
@@ -792,16 +1047,14 @@ void VST3Plugin::doProcess(ProcessData<T>& inData){
     }
     lastBypass_ = bypass_;
 
-    // create dummy buffers
-    auto indummy = (T *)alloca(sizeof(T) * data.numSamples); // dummy input buffer
-    std::fill(indummy, indummy + data.numSamples, 0); // zero!
-    auto outdummy = (T *)alloca(sizeof(T) * data.numSamples); // (don't have to zero)
+    // dummy buffers
+    auto indummy = scratch_.zeros<T>(); // dummy input buffer (always zero)
+    auto outdummy = scratch_.discard<T>(); // (don't have to zero)
 
     // prepare input buffers
     auto setInputBuffers = [&](Vst::AudioBusBuffers& bus, auto **vec, int numChannels,
                             auto** inputs, int numIn, auto** outputs, int numOut, auto* dummy){
         bus.silenceFlags = 0;
-        bus.numChannels = numChannels;
         for (int i = 0; i < numChannels; ++i){
             if (i < numIn){
                 switch (bypassState){
@@ -810,12 +1063,8 @@ void VST3Plugin::doProcess(ProcessData<T>& inData){
                     if (bypassRamp && i < numOut){
                         // write fade in/fade out to *output buffer* and use it as the plugin input.
                         // this works because VST plugins actually work in "replacing" mode.
-                        auto src = inputs[i];
-                        auto dst = vec[i] = outputs[i];
-                        T mix = rampDir;
-                        for (int j = 0; j < inData.numSamples; ++j, mix += rampAdvance){
-                            dst[j] = src[j] * mix;
-                        }
+                        vec[i] = outputs[i];
+                        audio::rampCopy(inputs[i], vec[i], inData.numSamples, (T)rampDir, rampAdvance);
                     } else {
                         vec[i] = dummy; // silence
                     }
@@ -837,13 +1086,11 @@ void VST3Plugin::doProcess(ProcessData<T>& inData){
                 vec[i] = dummy; // silence
             }
         }
-        setAudioBusBuffers(bus, vec);
     };
     // prepare output buffers
     auto setOutputBuffers = [](Vst::AudioBusBuffers& bus, auto **vec, int numChannels,
                             auto** outputs, int numOut, auto* dummy){
         bus.silenceFlags = 0;
-        bus.numChannels = numChannels;
         for (int i = 0; i < numChannels; ++i){
             if (i < numOut){
                 vec[i] = outputs[i];
@@ -851,26 +1098,25 @@ void VST3Plugin::doProcess(ProcessData<T>& inData){
                 vec[i] = dummy; // point to dummy buffer
             }
         }
-        setAudioBusBuffers(bus, vec);
     };
     // input:
     auto nin = numInputChannels_[Main];
-    auto invec = (T **)alloca(sizeof(T*) * nin);
-    setInputBuffers(input[Main], invec, nin, (T **)inData.input, inData.numInputs,
+    auto invec = getChannelBuffers<T>(inputBusBuffers_[Main]);
+    setInputBuffers(inputBusBuffers_[Main], invec, nin, (T **)inData.input, inData.numInputs,
             inData.output, inData.numOutputs, indummy);
     // aux input:
     auto nauxin = numInputChannels_[Aux];
-    auto auxinvec = (T **)alloca(sizeof(T*) * nauxin);
-    setInputBuffers(input[Aux], auxinvec, nauxin, (T **)inData.auxInput, inData.numAuxInputs,
+    auto auxinvec = getChannelBuffers<T>(inputBusBuffers_[Aux]);
+    setInputBuffers(inputBusBuffers_[Aux], auxinvec, nauxin, (T **)inData.auxInput, inData.numAuxInputs,
             inData.auxOutput, inData.numAuxOutputs, indummy);
     // output:
     auto nout = numOutputChannels_[Main];
-    auto outvec = (T **)alloca(sizeof(T*) * nout);
-    setOutputBuffers(output[Main], outvec, nout, (T **)inData.output, inData.numOutputs, outdummy);
+    auto outvec = getChannelBuffers<T>(outputBusBuffers_[Main]);
+    setOutputBuffers(outputBusBuffers_[Main], outvec, nout, (T **)inData.output, inData.numOutputs, outdummy);
     // aux output:
     auto nauxout = numOutputChannels_[Aux];
-    auto auxoutvec = (T **)alloca(sizeof(T*) * nauxout);
-    setOutputBuffers(output[Aux], auxoutvec, nauxout, (T **)inData.auxOutput, inData.numAuxOutputs, outdummy);
+    auto auxoutvec = getChannelBuffers<T>(outputBusBuffers_[Aux]);
+    setOutputBuffers(outputBusBuffers_[Aux], auxoutvec, nauxout, (T **)inData.auxOutput, inData.numAuxOutputs, outdummy);
 
     // send parameter changes from editor to processor
     ParamChange paramChange;
@@ -892,19 +1138,12 @@ void VST3Plugin::doProcess(ProcessData<T>& inData){
             // soft bypass
             auto softRamp = [&](auto inputs, auto numIn, auto outputs, auto numOut){
                 for (int i = 0; i < numOut; ++i){
-                    T mix = rampDir;
-                    auto out = outputs[i];
                     if (i < numIn){
                         // fade in/out unprocessed input
-                        auto in = inputs[i];
-                        for (int j = 0; j < data.numSamples; ++j, mix += rampAdvance){
-                            out[j] += in[j] * (1.f - mix);
-                        }
+                        audio::rampAdd(inputs[i], outputs[i], data.numSamples, (T)rampDir, rampAdvance);
                     } else {
                         // just fade in/out
-                        for (int j = 0; j < data.numSamples; ++j, mix += rampAdvance){
-                            out[j] *= mix;
-                        }
+                        audio::rampScale(outputs[i], data.numSamples, (T)rampDir, rampAdvance);
                     }
                 }
             };
@@ -919,19 +1158,12 @@ void VST3Plugin::doProcess(ProcessData<T>& inData){
             // hard bypass
             auto hardRamp = [&](auto inputs, auto numIn, auto outputs, auto numOut){
                 for (int i = 0; i < numOut; ++i){
-                   T mix = rampDir;
-                   auto out = outputs[i];
                    if (i < numIn){
                        // cross fade between plugin output and unprocessed input
-                       auto in = inputs[i];
-                       for (int j = 0; j < data.numSamples; ++j, mix += rampAdvance){
-                           out[j] = out[j] * mix + in[j] * (1.f - mix);
-                       }
+                       audio::crossfade(inputs[i], outputs[i], data.numSamples, (T)rampDir, rampAdvance);
                    } else {
                        // just fade out
-                       for (int j = 0; j < data.numSamples; ++j, mix += rampAdvance){
-                           out[j] *= mix;
-                       }
+                       audio::rampScale(outputs[i], data.numSamples, (T)rampDir, rampAdvance);
                    }
                 }
             };
@@ -947,19 +1179,11 @@ void VST3Plugin::doProcess(ProcessData<T>& inData){
         // continue to process with empty input till the output is silent
         processor_->process(data);
         // check for silence (RMS < ca. -80dB)
-        auto isChannelSilent = [](auto buf, auto n){
-            const T threshold = 0.0001;
-            T sum = 0;
-            for (int i = 0; i < n; ++i){
-                T f = buf[i];
-                sum += f * f;
-            }
-            return (sum / n) < (threshold * threshold); // sqrt(sum/n) < threshold
-        };
+        const T threshold = 0.0001;
         bool silent = true;
         auto checkBusSilent = [&](auto bus, auto count, auto n){
-            for (int i = 0; i < count; ++i){
-                if (!isChannelSilent(bus[i], n)){
+            for (int i = 0; i < count && silent; ++i){
+                if (!audio::isSilent(bus[i], n, threshold)){
                     silent = false;
                     break;
                 }
@@ -974,14 +1198,8 @@ void VST3Plugin::doProcess(ProcessData<T>& inData){
         if (bypassState == Bypass::Soft){
             auto mix = [](auto** inputs, auto numIn, auto** outputs, auto numOut, auto n){
                 // mix output with unprocessed input
-                for (int i = 0; i < numOut; ++i){
-                    auto out = outputs[i];
-                    if (i < numIn){
-                        auto in = inputs[i];
-                        for (int j = 0; j < n; ++j){
-                            out[j] += in[j];
-                        }
-                    }
+                for (int i = 0; i < numOut && i < numIn; ++i){
+                    audio::add(inputs[i], outputs[i], n);
                 }
             };
             mix(inData.input, inData.numInputs, outvec, nout, inData.numSamples);
@@ -1008,6 +1226,11 @@ void VST3Plugin::doProcess(ProcessData<T>& inData){
     // clear input queues
     inputEvents_.clear();
     inputParamChanges_.clear();
+    // no logging on the audio thread; the host reports the count
+    auto dropped = inputEvents_.takeNumDropped() + outputEvents_.takeNumDropped();
+    if (dropped > 0){
+        numDroppedEvents_.fetch_add(dropped, std::memory_order_relaxed);
+    }
 
     // handle outgoing events
     handleEvents();
@@ -1093,8 +1316,8 @@ void VST3Plugin::handleEvents(){
                 }
             }
         }
-        outputEvents_.clear();
     }
+    outputEvents_.clear(); // even without listener!
 }
 
 void VST3Plugin::handleOutputParameterChanges(){
@@ -1260,6 +1483,7 @@ void VST3Plugin::setNumSpeakers(int in, int out, int auxIn, int auxOut){
               << ", auxin " << numInputChannels_[Aux]
               << ", out " << numOutputChannels_[Main]
               << ", auxout " << numOutputChannels_[Aux]);
+    updateScratchArena();
 }
 
 void VST3Plugin::setTempoBPM(double tempo){
@@ -1457,6 +1681,10 @@ void VST3Plugin::sendSysexEvent(const SysexEvent &event){
     inputEvents_.addSysexEvent(event);
 }
 
+int VST3Plugin::takeNumDroppedEvents(){
+    return numDroppedEvents_.exchange(0, std::memory_order_relaxed);
+}
+
 void VST3Plugin::setParameter(int index, float value, int sampleOffset){
     auto id = info().getParamID(index);
     doSetParameter(id, value, sampleOffset);
@@ -1559,7 +1787,7 @@ std::string VST3Plugin::getProgramName() const {
 
 std::string VST3Plugin::getProgramNameIndexed(int index) const {
     if (index >= 0 && index < info().numPrograms()){
-        return info().programs[index];
+        return info().getProgram(index);
     } else {
         return "";
     }
@@ -75,33 +75,46 @@ class VST3Factory : public IFactory {
     PluginInfo::const_ptr getPlugin(int index) const override;
     int numPlugins() const override;
     // probe plugins (in a seperate process)
-    ProbeFuture probeAsync() override;
+    // 'quick' tries to read the plugin metadata from moduleinfo.json first
+    ProbeFuture probeAsync(const ProbeOptions& options = ProbeOptions()) override;
     bool isProbed() const override {
-        return !plugins_.empty();
+        return numPlugins() > 0;
     }
     bool valid() const override {
-        return plugins_.size() > 0;
+        return numPlugins() > 0;
     }
     std::string path() const override {
         return path_;
     }
     // create a new plugin instance
     IPlugin::ptr create(const std::string& name, bool probe = false) const override;
+    // only get the class info from the plugin factory
+    PluginInfo::const_ptr scan(const std::string& name) const override;
  private:
     void doLoad();
+    bool readModuleInfo(std::vector<PluginInfo::ptr>& plugins) const;
     std::string path_;
     std::unique_ptr<IModule> module_;
     IPtr<IPluginFactory> factory_;
     // TODO dllExit
     // probed plugins:
-    std::vector<PluginInfo::ptr> plugins_;
-    std::unordered_map<std::string, PluginInfo::ptr> pluginMap_;
+    // immutable, always use plugins() resp. setPlugins()
+    PluginList::const_ptr plugins_ = PluginList::make();
+    PluginList::const_ptr plugins() const {
+        return std::atomic_load(&plugins_);
+    }
+    void setPlugins(PluginList::const_ptr plugins){
+        std::atomic_store(&plugins_, std::move(plugins));
+    }
     // factory plugins:
     std::vector<std::string> pluginList_;
     mutable std::unordered_map<std::string, int> pluginIndexMap_;
 };
 
 //----------------------------------------------------------------------
+// Points are appended in O(1) if they arrive in chronological order (the usual case).
+// Out-of-order points are appended as well and the queue is only sorted (and duplicate
+// sample offsets removed) the next time the plugin reads it.
 class ParamValueQueue: public Vst::IParamValueQueue {
  public:
     static const int maxNumPoints = 64;
@@ -113,7 +126,7 @@ class ParamValueQueue: public Vst::IParamValueQueue {
 
     void setParameterId(Vst::ParamID id);
     Vst::ParamID PLUGIN_API getParameterId() override { return id_; }
-    int32 PLUGIN_API getPointCount() override { return values_.size(); }
+    int32 PLUGIN_API getPointCount() override;
     tresult PLUGIN_API getPoint(int32 index, int32& sampleOffset, Vst::ParamValue& value) override;
     tresult PLUGIN_API addPoint (int32 sampleOffset, Vst::ParamValue value, int32& index) override;
  protected:
@@ -122,39 +135,52 @@ class ParamValueQueue: public Vst::IParamValueQueue {
         Vst::ParamValue value;
         int32 sampleOffset;
     };
+    void sort();
     std::vector<Value> values_;
     Vst::ParamID id_ = Vst::kNoParamId;
+    bool sorted_ = true;
 };
 
 //----------------------------------------------------------------------
+// The parameter queues are found with a small open addressing hash table (ID -> slot).
+// Instead of clearing the table, clear() simply bumps the generation counter,
+// so that all entries from the previous block count as empty.
 class ParameterChanges: public Vst::IParameterChanges {
  public:
     MY_IMPLEMENT_QUERYINTERFACE(Vst::IParameterChanges)
     DUMMY_REFCOUNT_METHODS
 
-    void setMaxNumParameters(int n){
-        parameterChanges_.resize(n);
-    }
+    void setMaxNumParameters(int n);
     int32 PLUGIN_API getParameterCount() override {
         return useCount_;
     }
     Vst::IParamValueQueue* PLUGIN_API getParameterData(int32 index) override;
     Vst::IParamValueQueue* PLUGIN_API addParameterData(const Vst::ParamID& id, int32& index) override;
-    void clear(){
-        useCount_ = 0;
-    }
+    void clear();
  protected:
+    struct Slot {
+        Vst::ParamID id = Vst::kNoParamId;
+        uint32_t generation = 0; // 0: never used
+        int32 index = 0;
+    };
     std::vector<ParamValueQueue> parameterChanges_;
+    std::vector<Slot> slots_; // size is a power of 2
+    int shift_ = 28; // 32 - log2(size)
+    uint32_t generation_ = 1;
     int useCount_ = 0;
 };
 
 //--------------------------------------------------------------------------------
 
+// fixed size event list; all memory is allocated in the constructor.
+// events which don't fit are dropped and counted (see takeNumDropped()).
 class EventList : public Vst::IEventList {
  public:
-    static const int maxNumEvents = 64;
+    static const int maxNumEvents = 1024;
+    static const size_t defaultSysexSize = 65536; // sysex bytes per block
 
-    EventList();
+    // 'sysexSize': size of the arena for addSysexEvent()
+    EventList(size_t sysexSize = 0);
     ~EventList();
 
     MY_IMPLEMENT_QUERYINTERFACE(Vst::IEventList)
@@ -165,9 +191,14 @@ class EventList : public Vst::IEventList {
     tresult PLUGIN_API addEvent (Vst::Event& e) override;
     void addSysexEvent(const SysexEvent& event);
     void clear();
+    // returns and resets the number of dropped events
+    int takeNumDropped();
  protected:
     std::vector<Vst::Event> events_;
-    std::vector<std::string> sysexEvents_;
+    int numEvents_ = 0;
+    std::vector<char> sysexData_; // arena for the sysex data
+    size_t sysexDataSize_ = 0;
+    int numDropped_ = 0;
 };
 
 //--------------------------------------------------------------------------------------------------------
@@ -229,6 +260,7 @@ class VST3Plugin final :
 
     void sendMidiEvent(const MidiEvent& event) override;
     void sendSysexEvent(const SysexEvent& event) override;
+    int takeNumDroppedEvents() override;
 
     void setParameter(int index, float value, int sampleOffset = 0) override;
     bool setParameter(int index, const std::string& str, int sampleOffset = 0) override;
@@ -290,6 +322,7 @@ class VST3Plugin final :
      int getNumMidiOutputChannels() const;
      bool hasMidiInput() const;
      bool hasMidiOutput() const;
+    void updateScratchArena();
     template<typename T>
     void doProcess(ProcessData<T>& inData);
     void handleEvents();
@@ -303,6 +336,7 @@ class VST3Plugin final :
     mutable IPlugView *view_ = nullptr;
     FUnknownPtr<Vst::IAudioProcessor> processor_;
     PluginInfo::const_ptr info_;
+    PluginInfo::TablePtr paramTables_;
     IWindow::ptr window_;
     std::weak_ptr<IPluginListener> listener_;
     // audio
@@ -314,6 +348,10 @@ class VST3Plugin final :
     int numInputChannels_[2]; // main + aux
     int numOutputBusses_ = 0;
     int numOutputChannels_[2]; // main + aux
+    int maxBlockSize_ = 0;
+    ScratchArena scratch_; // dummy buffers and channel pointers for doProcess()
+    Vst::AudioBusBuffers inputBusBuffers_[2]; // point into scratch_
+    Vst::AudioBusBuffers outputBusBuffers_[2];
     Vst::ProcessContext context_;
     // automation
     int32 automationState_ = 0; // should better be atomic as well...
@@ -323,8 +361,9 @@ class VST3Plugin final :
     Bypass lastBypass_ = Bypass::Off;
     bool bypassSilent_ = false; // check if we can stop processing
     // midi
-    EventList inputEvents_;
-    EventList outputEvents_;
+    EventList inputEvents_{EventList::defaultSysexSize};
+    EventList outputEvents_; // sysex data is owned by the plugin
+    std::atomic<int> numDroppedEvents_{0}; // see takeNumDroppedEvents()
     int numMidiInChannels_ = 0;
     int numMidiOutChannels_ = 0;
     // parameters
@@ -1,6 +1,19 @@
 #include "Interface.h"
 #include "Utility.h"
 #include <stdlib.h>
+#include <string.h>
+#include <sstream>
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <unistd.h>
+# include <errno.h>
+# include <sys/resource.h>
+#endif
+#ifdef __linux__
+# include <sched.h>
+# include <sys/syscall.h>
+#endif
 
 using namespace vst;
 
@@ -10,53 +23,213 @@ using namespace vst;
 
 namespace {
 
-void writeErrorMsg(Error::ErrorCode code, const char* msg, const std::string& path){
-    if (!path.empty()){
-        vst::File file(path, File::WRITE);
+// probing runs in the background, so it shouldn't compete with the host,
+// especially not with the audio thread(s).
+void lowerPriority(){
+#if defined(_WIN32)
+    // lowers CPU, I/O and memory priority
+    if (!SetPriorityClass(GetCurrentProcess(), PROCESS_MODE_BACKGROUND_BEGIN)){
+        SetPriorityClass(GetCurrentProcess(), IDLE_PRIORITY_CLASS);
+    }
+#else
+ #ifdef __linux__
+    sched_param param;
+    param.sched_priority = 0;
+    if (sched_setscheduler(0, SCHED_IDLE, &param) != 0){
+        LOG_DEBUG("couldn't set SCHED_IDLE: " << strerror(errno));
+    }
+  #ifdef SYS_ioprio_set
+    // idle I/O priority (see linux/ioprio.h)
+    const int IOPRIO_WHO_PROCESS = 1;
+    const int IOPRIO_CLASS_IDLE = 3;
+    const int IOPRIO_CLASS_SHIFT = 13;
+    if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+                IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) != 0){
+        LOG_DEBUG("couldn't set idle I/O priority: " << strerror(errno));
+    }
+  #endif
+ #endif
+ #ifdef __APPLE__
+    // throttled disk I/O
+    setiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_PROCESS, IOPOL_THROTTLE);
+ #endif
+    // lowest nice value (also for the case that SCHED_IDLE is not available)
+    if (setpriority(PRIO_PROCESS, 0, 19) != 0){
+        LOG_DEBUG("couldn't set nice value: " << strerror(errno));
+    }
+#endif
+}
+
+void writeErrorMsg(Error::ErrorCode code, const char* msg, std::ostream& out){
+    out << static_cast<int>(code) << "\n";
+    out << msg << "\n";
+}
+
+// load a plugin module; on failure, the error message is written to 'out'
+IFactory::ptr loadFactory(const std::string& pluginPath, std::ostream& out){
+    try {
+        return vst::IFactory::load(pluginPath);
+    } catch (const Error& e){
+        writeErrorMsg(e.code(), e.what(), out);
+        LOG_ERROR("couldn't load module: " << e.what());
+    } catch (const std::exception& e) {
+        writeErrorMsg(Error::UnknownError, e.what(), out);
+        LOG_ERROR("couldn't load module: " << e.what());
+    }
+    return nullptr;
+}
+
+// probe a plugin of an already loaded module and write the plugin info
+// resp. the error message to 'out'.
+// 'quick': only scan the metadata (see IFactory::scan())
+int probe(IFactory& factory, const std::string& pluginName, std::ostream& out,
+          bool quick){
+    int status = EXIT_FAILURE;
+    LOG_DEBUG((quick ? "scanning " : "probing ") << factory.path() << " " << pluginName);
+    try {
+        if (quick){
+            factory.scan(pluginName)->serialize(out);
+        } else {
+            auto plugin = factory.create(pluginName, true);
+            plugin->info().serialize(out);
+        }
+        status = EXIT_SUCCESS;
+        LOG_VERBOSE("probe succeeded");
+    } catch (const Error& e){
+        writeErrorMsg(e.code(), e.what(), out);
+        LOG_ERROR("probe failed: " << e.what());
+    } catch (const std::exception& e) {
+        writeErrorMsg(Error::UnknownError, e.what(), out);
+        LOG_ERROR("probe failed: " << e.what());
+    }
+    return status;
+}
+
+// probe a plugin and write the plugin info resp. the error message to 'out'
+int probe(const std::string& pluginPath, const std::string& pluginName,
+          std::ostream& out, bool quick)
+{
+    auto factory = loadFactory(pluginPath, out);
+    if (factory){
+        return probe(*factory, pluginName, out, quick);
+    } else {
+        return EXIT_FAILURE;
+    }
+}
+
+// probe a plugin and write result to file
+int probe(const std::string& pluginPath, const std::string& pluginName,
+          const std::string& filePath, bool quick)
+{
+    std::stringstream ss;
+    int status = probe(pluginPath, pluginName, ss, quick);
+    if (!filePath.empty()) {
+        vst::File file(filePath, File::WRITE);
         if (file.is_open()) {
-            file << static_cast<int>(code) << "\n";
-            file << msg << "\n";
+            file << ss.rdbuf();
         } else {
-            LOG_ERROR("ERROR: couldn't write error message");
+            LOG_ERROR("ERROR: couldn't write info file");
         }
     }
+    return status;
+}
+
+#ifndef _WIN32
+bool readLine(int fd, std::string& line){
+    line.clear();
+    char c;
+    while (read(fd, &c, 1) == 1){
+        if (c == '\n'){
+            return true;
+        }
+        line.push_back(c);
+    }
+    return false; // EOF or error
+}
+
+bool writeAll(int fd, const char *data, size_t size){
+    while (size > 0){
+        auto n = write(fd, data, size);
+        if (n > 0){
+            data += n;
+            size -= n;
+        } else if (n < 0 && errno == EINTR){
+            continue;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool sendReply(int fd, int32_t status, const std::string& data){
+    uint32_t size = data.size();
+    std::string reply;
+    reply.reserve(sizeof(size) + sizeof(status) + size);
+    reply.append((const char *)&size, sizeof(size));
+    reply.append((const char *)&status, sizeof(status));
+    reply.append(data);
+    return writeAll(fd, reply.data(), reply.size());
 }
 
+// worker mode: read probe jobs from the socket until it is closed by the host.
+// a job consists of the number of plugins (optionally followed by "quick", see probe()),
+// the module path and the plugin names (resp. shell plugin IDs). the module is only loaded once and each plugin is answered
+// with a single frame: data size (uint32_t), exit status (int32_t) and the plugin info
+// resp. error message (see ProbeWorkerPool in Plugin.cpp).
+int worker(int fd){
+    LOG_DEBUG("probe worker started");
+    std::string count, pluginPath, pluginName;
+    while (readLine(fd, count) && readLine(fd, pluginPath)){
+        int numPlugins = atoi(count.c_str());
+        bool quick = count.find("quick") != std::string::npos;
+        std::stringstream error;
+        auto factory = loadFactory(pluginPath, error);
+        for (int i = 0; i < numPlugins; ++i){
+            if (!readLine(fd, pluginName)){
+                LOG_ERROR("ERROR: incomplete job");
+                return EXIT_FAILURE;
+            }
+            std::stringstream ss;
+            int32_t status = factory ? probe(*factory, pluginName, ss, quick) : EXIT_FAILURE;
+            if (!sendReply(fd, status, factory ? ss.str() : error.str())){
+                LOG_ERROR("ERROR: couldn't send reply");
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    LOG_DEBUG("probe worker finished");
+    return EXIT_SUCCESS;
+}
+#endif
+
 } // namespace
 
 // probe a plugin and write info to file
 // returns EXIT_SUCCESS on success, EXIT_FAILURE on fail and everything else on error/crash :-)
+// 'probe -w <fd>' runs as a persistent worker (Unix only), see ProbeWorkerPool in Plugin.cpp
+// 'probe -q ...' only scans the plugin metadata
 #ifdef _WIN32
 int wmain(int argc, const wchar_t *argv[]){
+    lowerPriority();
+    bool quick = argc >= 2 && !wcscmp(argv[1], L"-q");
 #else
 int main(int argc, const char *argv[]) {
+    lowerPriority();
+    if (argc >= 3 && !strcmp(argv[1], "-w")){
+        return worker(atoi(argv[2]));
+    }
+    bool quick = argc >= 2 && !strcmp(argv[1], "-q");
 #endif
-    int status = EXIT_FAILURE;
+    if (quick){
+        argc--;
+        argv++;
+    }
     if (argc >= 2){
         std::string pluginPath = shorten(argv[1]);
         std::string pluginName = argc > 2 ? shorten(argv[2]) : "";
         std::string filePath = argc > 3 ? shorten(argv[3]) : "";
-        LOG_DEBUG("probing " << pluginPath << " " << pluginName);
-        try {
-            auto factory = vst::IFactory::load(pluginPath);
-            auto plugin = factory->create(pluginName, true);
-            if (!filePath.empty()) {
-                vst::File file(filePath, File::WRITE);
-                if (file.is_open()) {
-                    plugin->info().serialize(file);
-                } else {
-                    LOG_ERROR("ERROR: couldn't write info file");
-                }
-            }
-            status = EXIT_SUCCESS;
-            LOG_VERBOSE("probe succeeded");
-        } catch (const Error& e){
-            writeErrorMsg(e.code(), e.what(), filePath);
-            LOG_ERROR("probe failed: " << e.what());
-        } catch (const std::exception& e) {
-            writeErrorMsg(Error::UnknownError, e.what(), filePath);
-            LOG_ERROR("probe failed: " << e.what());
-        }
+        return probe(pluginPath, pluginName, filePath, quick);
     }
-    return status;
+    return EXIT_FAILURE;
 }